@@ -82,21 +82,26 @@ static void on_session_event(const copilot_session_event_t *event, void *user_da
     (void)user_data;
 
     if (strcmp(event->type, "assistant.message") == 0) {
-        printf("\n[Assistant] %s\n", event->content ? event->content : "(no content)");
+        const char *content = copilot_session_event_content(event);
+        printf("\n[Assistant] %s\n", content ? content : "(no content)");
     } else if (strcmp(event->type, "assistant.message_delta") == 0) {
         /* Streaming delta - print incrementally */
-        if (event->delta_content) {
-            printf("%s", event->delta_content);
+        const char *delta = copilot_session_event_delta_content(event);
+        if (delta) {
+            printf("%s", delta);
             fflush(stdout);
         }
     } else if (strcmp(event->type, "tool.executing") == 0) {
-        printf("[Event] Executing tool: %s\n", event->tool_name ? event->tool_name : "?");
+        const char *tool_name = copilot_session_event_tool_name(event);
+        printf("[Event] Executing tool: %s\n", tool_name ? tool_name : "?");
     } else if (strcmp(event->type, "tool.executed") == 0) {
-        printf("[Event] Tool executed: %s\n", event->tool_name ? event->tool_name : "?");
+        const char *tool_name = copilot_session_event_tool_name(event);
+        printf("[Event] Tool executed: %s\n", tool_name ? tool_name : "?");
     } else if (strcmp(event->type, "session.idle") == 0) {
         printf("[Event] Session is idle\n");
     } else if (strcmp(event->type, "session.error") == 0) {
-        fprintf(stderr, "[Error] %s\n", event->message ? event->message : "Unknown error");
+        const char *message = copilot_session_event_message(event);
+        fprintf(stderr, "[Error] %s\n", message ? message : "Unknown error");
     } else {
         printf("[Event] %s\n", event->type);
     }
@@ -56,6 +56,7 @@ typedef enum {
     COPILOT_ERROR_IO = -12,
     COPILOT_ERROR_ALREADY_STARTED = -13,
     COPILOT_ERROR_SESSION_ERROR = -14,
+    COPILOT_ERROR_CANCELLED = -15,
 } copilot_error_t;
 
 /**
@@ -84,6 +85,12 @@ typedef struct copilot_client copilot_client_t;
 /** Opaque session handle. */
 typedef struct copilot_session copilot_session_t;
 
+/** Opaque handle for one in-flight message turn (see copilot_session_send_async()). */
+typedef struct copilot_turn copilot_turn_t;
+
+/** Opaque handle for one non-blocking RPC call (see copilot_client_request_async()). */
+typedef struct copilot_request copilot_request_t;
+
 /* ============================================================================
  * Tool types
  * ============================================================================ */
@@ -149,20 +156,18 @@ typedef struct {
  * Session event types
  * ============================================================================ */
 
+/* Opaque view of the parsed event, resolved by the accessors below */
+typedef struct copilot_session_event_source copilot_session_event_source_t;
+
 /**
- * Session event. The type field determines which data fields are populated.
- * String fields are owned by the SDK and valid only for the duration of the callback.
+ * Session event. Only the type is resolved up front; other fields are read
+ * on demand through the copilot_session_event_* accessors.
+ * The event and every string returned for it are owned by the SDK and valid
+ * only for the duration of the callback.
  */
 typedef struct {
     const char *type;       /**< Event type string (e.g., "assistant.message", "session.idle") */
-    const char *raw_json;   /**< Full raw JSON of the event data */
-
-    /* Convenience fields populated for common event types */
-    const char *content;           /**< For assistant.message: message content */
-    const char *message;           /**< For session.error: error message */
-    const char *delta_content;     /**< For assistant.message_delta: incremental content */
-    const char *tool_name;         /**< For tool.executing/tool.executed: tool name */
-    const char *tool_call_id;      /**< For tool events: tool call ID */
+    copilot_session_event_source_t *source;  /**< Private; use the accessors */
 } copilot_session_event_t;
 
 /**
@@ -176,6 +181,34 @@ typedef void (*copilot_session_event_handler_fn)(
     void *user_data
 );
 
+/**
+ * Returns the full event serialized as JSON. It is produced on the first
+ * call and cached for the rest of the callback.
+ */
+const char *copilot_session_event_raw_json(const copilot_session_event_t *event);
+
+/**
+ * Returns a string field of the event's data object, or NULL if it is
+ * absent or not a string.
+ */
+const char *copilot_session_event_get_string(const copilot_session_event_t *event,
+                                             const char *field);
+
+/** For assistant.message: message content, or NULL. */
+const char *copilot_session_event_content(const copilot_session_event_t *event);
+
+/** For session.error: error message, or NULL. */
+const char *copilot_session_event_message(const copilot_session_event_t *event);
+
+/** For assistant.message_delta: incremental content, or NULL. */
+const char *copilot_session_event_delta_content(const copilot_session_event_t *event);
+
+/** For tool.executing/tool.executed: tool name, or NULL. */
+const char *copilot_session_event_tool_name(const copilot_session_event_t *event);
+
+/** For tool events: tool call ID, or NULL. */
+const char *copilot_session_event_tool_call_id(const copilot_session_event_t *event);
+
 /* ============================================================================
  * Permission types
  * ============================================================================ */
@@ -321,6 +354,22 @@ typedef struct {
     const char *github_token;  /**< GitHub token (NULL = none) */
     bool use_logged_in_user;   /**< Use stored OAuth tokens (default: true) */
     const char **extra_args;   /**< NULL-terminated array of extra CLI args, or NULL */
+
+    /* Server request handling (tool calls, permission/user input requests, hooks) */
+    size_t request_worker_threads;  /**< Worker threads for server requests (default: 4, 0 = reader thread) */
+    size_t request_queue_capacity;  /**< Max queued server requests before rejecting (default: 64) */
+
+    /* JSON memory. cJSON allocator hooks are process-wide: the first client
+     * that sets any of these installs them, and later clients must pass the
+     * same pair. Trees allocated before that cannot be freed through the
+     * hooks, so set them on the first client created, before the
+     * application builds cJSON trees of its own. */
+    void *(*json_malloc)(size_t size);  /**< Allocator for JSON trees and arena blocks (NULL = malloc) */
+    void (*json_free)(void *ptr);       /**< Matching free; set both or neither (NULL = free) */
+    size_t message_arena_size;          /**< Arena block size for parsing inbound messages, e.g. 64 KiB (default: 0 = heap) */
+
+    /* Timeouts */
+    bool abort_on_timeout;     /**< Send session.abort when send_and_wait times out (default: false) */
 } copilot_client_options_t;
 
 /**
@@ -567,6 +616,97 @@ copilot_error_t copilot_client_delete_session(
     const char *session_id
 );
 
+/* ============================================================================
+ * Non-blocking API
+ *
+ * For single-threaded event loops: watch copilot_client_get_fd() for
+ * readability and call copilot_client_process() when it fires. Completion
+ * callbacks run inside copilot_client_process(), on the caller's thread.
+ * The fd also becomes readable when a turn completes, so loops can poll
+ * copilot_turn_is_done() instead of blocking in copilot_turn_wait().
+ * Request handles belong to the thread that processes completions.
+ * ============================================================================ */
+
+/**
+ * Completion callback for copilot_client_request_async(). The request stays
+ * valid until copilot_request_free(), which may be called from the callback.
+ */
+typedef void (*copilot_request_callback_fn)(copilot_request_t *request, void *user_data);
+
+/**
+ * Sends a raw JSON-RPC request without waiting for the response.
+ *
+ * @param client       The client (must be started).
+ * @param method       The RPC method name.
+ * @param params_json  JSON object with the parameters, or NULL for none.
+ * @param callback     Called from copilot_client_process() once the call completes.
+ * @param user_data    Context pointer passed to the callback.
+ * @param out_request  Output: the request handle. Free with copilot_request_free().
+ * @return COPILOT_OK if the request was sent.
+ */
+copilot_error_t copilot_client_request_async(
+    copilot_client_t *client,
+    const char *method,
+    const char *params_json,
+    copilot_request_callback_fn callback,
+    void *user_data,
+    copilot_request_t **out_request
+);
+
+/**
+ * Returns a file descriptor that is readable while completions are pending,
+ * or -1 if the client is not started (or on Windows). The fd changes if the
+ * client is restarted. Do not read from or close it.
+ */
+int copilot_client_get_fd(const copilot_client_t *client);
+
+/**
+ * Runs the callbacks of every completed request and resets the fd. Never
+ * blocks; returns immediately when nothing is pending.
+ *
+ * @return COPILOT_OK, or COPILOT_ERROR_NOT_CONNECTED if the client is not started.
+ */
+copilot_error_t copilot_client_process(copilot_client_t *client);
+
+/**
+ * Returns true once the request's callback has been invoked.
+ */
+bool copilot_request_is_done(const copilot_request_t *request);
+
+/**
+ * Returns the response result as JSON, or NULL if the request is not done or failed.
+ * Valid until copilot_request_free().
+ */
+const char *copilot_request_get_result(copilot_request_t *request);
+
+/**
+ * Returns the outcome of a completed request.
+ *
+ * @param request      The request.
+ * @param out_message  Optional output: the server's error message, or NULL.
+ *                     Valid until copilot_request_free().
+ * @return COPILOT_OK, COPILOT_ERROR_RPC if the server returned an error or the
+ *         connection closed, COPILOT_ERROR_CANCELLED after copilot_request_cancel(),
+ *         or COPILOT_ERROR_TIMEOUT if it is not done yet.
+ */
+copilot_error_t copilot_request_get_error(const copilot_request_t *request,
+                                          const char **out_message);
+
+/**
+ * Cancels an in-flight request. The server is sent $/cancelRequest for it and
+ * the callback runs on the next copilot_client_process() with
+ * COPILOT_ERROR_CANCELLED. Does nothing if the request already completed.
+ *
+ * @return COPILOT_OK if the request was cancelled.
+ */
+copilot_error_t copilot_request_cancel(copilot_request_t *request);
+
+/**
+ * Frees a request. If it is still in flight its callback will not run and
+ * the response is discarded when it arrives.
+ */
+void copilot_request_free(copilot_request_t *request);
+
 /* ============================================================================
  * Session API
  * ============================================================================ */
@@ -627,7 +767,11 @@ copilot_error_t copilot_session_send(
 );
 
 /**
- * Sends a message and blocks until the session becomes idle or timeout.
+ * Sends a message and blocks until the session becomes idle or timeout. The
+ * timeout includes any wait for earlier turns of the session. On timeout the
+ * turn keeps running on the server unless the client was created with
+ * abort_on_timeout, and later turns of the session are held back until the
+ * server reports it idle.
  *
  * @param session      The session.
  * @param options      Message options.
@@ -643,8 +787,103 @@ copilot_error_t copilot_session_send_and_wait(
     char **out_content
 );
 
+/**
+ * Sends a message and returns a turn handle that completes when the session
+ * goes idle after it (or reports an error for it). The waiter is registered
+ * before the message is sent, so no events are missed. Never waits on the
+ * server.
+ *
+ * Turns are serialized per session, because the server's events do not say
+ * which message they answer: if the session already has a turn in flight,
+ * the message is queued and sent once the server reports the session idle
+ * after the turns ahead of it, including ones that were cancelled or freed.
+ * A queued message that fails to send completes its turn with
+ * COPILOT_ERROR_RPC. Turns on different sessions run concurrently.
+ *
+ * @param session   The session.
+ * @param options   Message options.
+ * @param out_turn  Output: the turn. Free with copilot_turn_free().
+ * @return COPILOT_OK on success.
+ */
+copilot_error_t copilot_session_send_async(
+    copilot_session_t *session,
+    const copilot_message_options_t *options,
+    copilot_turn_t **out_turn
+);
+
+/**
+ * Blocks until the turn completes or the timeout expires. May be called
+ * again after COPILOT_ERROR_TIMEOUT.
+ *
+ * @param turn         The turn.
+ * @param timeout_ms   Timeout in milliseconds (0 = 60000ms default).
+ * @param out_content  Output: final assistant message content (caller must free), or NULL.
+ * @return COPILOT_OK, COPILOT_ERROR_TIMEOUT, COPILOT_ERROR_SESSION_ERROR,
+ *         or COPILOT_ERROR_NOT_CONNECTED if the session or client went away.
+ */
+copilot_error_t copilot_turn_wait(copilot_turn_t *turn, int timeout_ms, char **out_content);
+
+/**
+ * Waits until at least one of the turns completes. All turns must belong to
+ * sessions of the same client.
+ *
+ * @param turns       Array of turns.
+ * @param count       Number of turns.
+ * @param timeout_ms  Timeout in milliseconds (0 = 60000ms default).
+ * @param out_index   Output: index of a completed turn.
+ * @return COPILOT_OK when a turn completed (check it with copilot_turn_wait()),
+ *         or COPILOT_ERROR_TIMEOUT.
+ */
+copilot_error_t copilot_turns_wait_any(
+    copilot_turn_t *const *turns,
+    size_t count,
+    int timeout_ms,
+    size_t *out_index
+);
+
+/**
+ * Waits until all of the turns complete. All turns must belong to sessions
+ * of the same client.
+ *
+ * @return COPILOT_OK when every turn completed, or COPILOT_ERROR_TIMEOUT.
+ */
+copilot_error_t copilot_turns_wait_all(
+    copilot_turn_t *const *turns,
+    size_t count,
+    int timeout_ms
+);
+
+/**
+ * Returns true if the turn has completed (successfully or not).
+ */
+bool copilot_turn_is_done(const copilot_turn_t *turn);
+
+/**
+ * Returns the message ID assigned by the server, or NULL before it is known.
+ */
+const char *copilot_turn_get_message_id(const copilot_turn_t *turn);
+
+/**
+ * Cancels an in-flight turn: sends session.abort for its session without
+ * waiting for the reply, and completes the turn with COPILOT_ERROR_CANCELLED.
+ * A turn still queued behind others is dropped without contacting the
+ * server. Does nothing if the turn already completed.
+ *
+ * @return COPILOT_OK if the turn was cancelled.
+ */
+copilot_error_t copilot_turn_cancel(copilot_turn_t *turn);
+
+/**
+ * Frees a turn. A queued turn is dropped; a turn already sent keeps
+ * processing on the server (see copilot_turn_cancel()) and holds back later
+ * turns of its session until the server reports the session idle.
+ */
+void copilot_turn_free(copilot_turn_t *turn);
+
 /**
  * Registers an event handler for this session. Multiple handlers can be registered.
+ * Handlers run without SDK locks held, in registration order, and may register or
+ * unregister handlers themselves.
  *
  * @param session    The session.
  * @param handler    The callback function.
@@ -674,7 +913,9 @@ int copilot_session_on_type(
 );
 
 /**
- * Unregisters an event handler.
+ * Unregisters an event handler. Once this returns the handler is not invoked
+ * again, although a call already running on another thread may still finish.
+ * Safe to call from inside an event handler.
  *
  * @param session     The session.
  * @param handler_id  The handler ID returned by copilot_session_on().
@@ -10,10 +10,15 @@
 #include "copilot/copilot.h"
 #include "copilot/sdk_protocol_version.h"
 #include "json_rpc_client.h"
+#include "json_arena.h"
+#include "session_event.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <stdatomic.h>
 #include <cjson/cJSON.h>
 
 #ifdef _WIN32
@@ -31,15 +36,35 @@
  * Internal session structure (forward declared in copilot.h as opaque)
  * ============================================================================ */
 
-/* Session event handler entry */
+/* Session event handler entry. Refcounted: the registration list and every
+ * dispatch snapshot list containing it each hold one reference. */
 typedef struct session_handler_entry {
     int id;
-    const char *event_type_filter;  /* NULL = wildcard */
+    char *event_type_filter;        /* NULL = wildcard (owned copy) */
     copilot_session_event_handler_fn handler;
     void *user_data;
-    struct session_handler_entry *next;
+    atomic_int refcount;
+    atomic_bool removed;            /* Set by copilot_session_off(); never invoked again */
+    struct session_handler_entry *next;  /* Registration list, oldest first */
 } session_handler_entry_t;
 
+/* Handlers receiving one event type: its typed handlers plus all wildcards,
+ * in registration order */
+typedef struct {
+    const char *event_type;         /* Borrowed from an entry; NULL = empty slot */
+    session_handler_entry_t **entries;
+    size_t count;
+} session_dispatch_list_t;
+
+/* Immutable snapshot of a session's handlers. Rebuilt and swapped on every
+ * on/off, so dispatch never holds handlers_mutex while calling out. */
+typedef struct {
+    atomic_int refcount;
+    session_dispatch_list_t wildcard;    /* Types without typed handlers */
+    session_dispatch_list_t *by_type;    /* Open-addressed by event type */
+    size_t by_type_count;                /* Power of two, 0 if no typed handlers */
+} session_dispatch_t;
+
 struct copilot_session {
     char *session_id;
     char *workspace_path;
@@ -47,9 +72,10 @@ struct copilot_session {
     struct copilot_client *owner;
 
     /* Event handlers */
-    session_handler_entry_t *handlers;
+    session_handler_entry_t *handlers;   /* Registration list (handlers_mutex) */
+    session_dispatch_t *dispatch;        /* Current snapshot, NULL if no handlers */
     int next_handler_id;
-    pthread_mutex_t handlers_mutex;
+    pthread_mutex_t handlers_mutex;      /* Guards the list and the snapshot pointer only */
 
     /* Tools */
     copilot_tool_t *tools;
@@ -67,16 +93,47 @@ struct copilot_session {
     copilot_hook_handler_fn hook_handler;
     void *hook_user_data;
 
-    /* SendAndWait synchronization */
-    pthread_mutex_t idle_mutex;
-    pthread_cond_t idle_cond;
-    bool idle_signaled;
-    bool error_signaled;
-    char *error_message;
-    char *last_assistant_content;
+    /* Turns, oldest first (guarded by owner->turns_mutex). Only the head has
+     * been sent; the rest wait in copilot_session_send_async() for it to end */
+    copilot_turn_t *turns;
 
     /* Linked list for client's session tracking */
     struct copilot_session *next;
+    /* Chain within the client's session_buckets index */
+    struct copilot_session *bucket_next;
+};
+
+/* ============================================================================
+ * Internal turn structure (forward declared in copilot.h as opaque)
+ * ============================================================================ */
+
+struct copilot_turn {
+    struct copilot_client *client;
+    copilot_session_t *session;  /* NULL once no longer tracked by the session */
+    cJSON *params;               /* session.send params until the turn is sent */
+    char *message_id;            /* Set on the reader thread when session.send is acknowledged */
+    bool sent;                   /* session.send issued; the turn holds the session until idle */
+    bool send_pending;           /* The session.send response hook has not run yet */
+    bool acked;                  /* Sent and acknowledged; events from here on belong to it */
+    bool released;               /* Freed by the caller while still tracked; freed when retired */
+    bool done;
+    copilot_error_t status;
+    char *content;               /* Latest assistant message content */
+    struct copilot_turn *next;   /* Session's queue; the head is the turn in flight */
+};
+
+/* ============================================================================
+ * Internal request structure (forward declared in copilot.h as opaque)
+ * ============================================================================ */
+
+struct copilot_request {
+    struct copilot_client *client;
+    pending_request_t *call;     /* Owned by the RPC client until done */
+    copilot_request_callback_fn callback;
+    void *user_data;
+    bool done;
+    bool abandoned;              /* Freed by the caller while in flight */
+    char *result_json;           /* Printed on first access, release with cJSON_free() */
 };
 
 /* ============================================================================
@@ -95,6 +152,10 @@ struct copilot_client {
     bool use_logged_in_user;
     char **extra_args;
     int extra_args_count;
+    size_t request_worker_threads;
+    size_t request_queue_capacity;
+    size_t message_arena_size;
+    bool abort_on_timeout;
 
     /* State */
     copilot_connection_state_t state;
@@ -113,11 +174,21 @@ struct copilot_client {
     /* JSON-RPC client */
     json_rpc_client_t *rpc;
 
-    /* Sessions */
+    /* Turn completion, shared by every session so one thread can wait on many */
+    pthread_mutex_t turns_mutex;
+    pthread_cond_t turns_cond;
+
+    /* Sessions: list for iteration, plus a hash index by session ID */
     copilot_session_t *sessions;
+    copilot_session_t **session_buckets;
+    size_t session_bucket_count;     /* Power of two, 0 until the first session */
+    size_t session_count;
     pthread_mutex_t sessions_mutex;
 };
 
+/** Initial number of session index buckets (power of two). */
+#define COPILOT_SESSION_INITIAL_BUCKETS 16
+
 /* ============================================================================
  * Error strings
  * ============================================================================ */
@@ -140,6 +211,7 @@ const char *copilot_error_string(copilot_error_t err)
     case COPILOT_ERROR_IO:               return "I/O error";
     case COPILOT_ERROR_ALREADY_STARTED:  return "Already started";
     case COPILOT_ERROR_SESSION_ERROR:    return "Session error";
+    case COPILOT_ERROR_CANCELLED:        return "Cancelled";
     default:                             return "Unknown error";
     }
 }
@@ -161,6 +233,11 @@ copilot_client_options_t copilot_client_options_default(void)
     opts.github_token = NULL;
     opts.use_logged_in_user = true;
     opts.extra_args = NULL;
+    opts.request_worker_threads = JSON_RPC_DEFAULT_WORKER_THREADS;
+    opts.request_queue_capacity = JSON_RPC_DEFAULT_QUEUE_CAPACITY;
+    opts.json_malloc = NULL;
+    opts.json_free = NULL;
+    opts.message_arena_size = 0;
     return opts;
 }
 
@@ -178,16 +255,36 @@ copilot_session_config_t copilot_session_config_default(void)
 static copilot_session_t *find_session(copilot_client_t *client, const char *session_id)
 {
     pthread_mutex_lock(&client->sessions_mutex);
-    copilot_session_t *s = client->sessions;
-    while (s) {
-        if (strcmp(s->session_id, session_id) == 0) {
-            pthread_mutex_unlock(&client->sessions_mutex);
-            return s;
+    copilot_session_t *s = NULL;
+    if (client->session_bucket_count > 0) {
+        size_t bucket = json_rpc_hash_string(session_id) & (client->session_bucket_count - 1);
+        s = client->session_buckets[bucket];
+        while (s && strcmp(s->session_id, session_id) != 0) {
+            s = s->bucket_next;
         }
-        s = s->next;
     }
     pthread_mutex_unlock(&client->sessions_mutex);
-    return NULL;
+    return s;
+}
+
+/**
+ * Resize the session index to 'bucket_count' buckets. Caller holds sessions_mutex.
+ * On allocation failure the old index is kept.
+ */
+static void resize_session_index(copilot_client_t *client, size_t bucket_count)
+{
+    copilot_session_t **buckets = calloc(bucket_count, sizeof(copilot_session_t *));
+    if (!buckets) return;
+
+    for (copilot_session_t *s = client->sessions; s; s = s->next) {
+        size_t bucket = json_rpc_hash_string(s->session_id) & (bucket_count - 1);
+        s->bucket_next = buckets[bucket];
+        buckets[bucket] = s;
+    }
+
+    free(client->session_buckets);
+    client->session_buckets = buckets;
+    client->session_bucket_count = bucket_count;
 }
 
 static void add_session(copilot_client_t *client, copilot_session_t *session)
@@ -195,6 +292,19 @@ static void add_session(copilot_client_t *client, copilot_session_t *session)
     pthread_mutex_lock(&client->sessions_mutex);
     session->next = client->sessions;
     client->sessions = session;
+    client->session_count++;
+
+    if (client->session_count > client->session_bucket_count) {
+        /* Rehash rebuilds every chain from the list, including this session */
+        resize_session_index(client, client->session_bucket_count
+                                         ? client->session_bucket_count * 2
+                                         : COPILOT_SESSION_INITIAL_BUCKETS);
+    } else {
+        size_t bucket = json_rpc_hash_string(session->session_id)
+                        & (client->session_bucket_count - 1);
+        session->bucket_next = client->session_buckets[bucket];
+        client->session_buckets[bucket] = session;
+    }
     pthread_mutex_unlock(&client->sessions_mutex);
 }
 
@@ -205,10 +315,24 @@ static void remove_session(copilot_client_t *client, copilot_session_t *session)
     while (*pp) {
         if (*pp == session) {
             *pp = session->next;
+            client->session_count--;
             break;
         }
         pp = &(*pp)->next;
     }
+
+    if (client->session_bucket_count > 0) {
+        size_t bucket = json_rpc_hash_string(session->session_id)
+                        & (client->session_bucket_count - 1);
+        pp = &client->session_buckets[bucket];
+        while (*pp) {
+            if (*pp == session) {
+                *pp = session->bucket_next;
+                break;
+            }
+            pp = &(*pp)->bucket_next;
+        }
+    }
     pthread_mutex_unlock(&client->sessions_mutex);
 }
 
@@ -216,18 +340,413 @@ static void remove_session(copilot_client_t *client, copilot_session_t *session)
  * Internal: dispatch session event
  * ============================================================================ */
 
-static void dispatch_session_event(copilot_session_t *session,
+static void handler_entry_retain(session_handler_entry_t *entry)
+{
+    atomic_fetch_add_explicit(&entry->refcount, 1, memory_order_relaxed);
+}
+
+static void handler_entry_release(session_handler_entry_t *entry)
+{
+    if (atomic_fetch_sub_explicit(&entry->refcount, 1, memory_order_acq_rel) == 1) {
+        free(entry->event_type_filter);
+        free(entry);
+    }
+}
+
+static void dispatch_list_clear(session_dispatch_list_t *list)
+{
+    for (size_t i = 0; i < list->count; i++) {
+        handler_entry_release(list->entries[i]);
+    }
+    free(list->entries);
+}
+
+static void dispatch_release(session_dispatch_t *dispatch)
+{
+    if (!dispatch) return;
+    if (atomic_fetch_sub_explicit(&dispatch->refcount, 1, memory_order_acq_rel) != 1) return;
+
+    dispatch_list_clear(&dispatch->wildcard);
+    for (size_t i = 0; i < dispatch->by_type_count; i++) {
+        dispatch_list_clear(&dispatch->by_type[i]);
+    }
+    free(dispatch->by_type);
+    free(dispatch);
+}
+
+/**
+ * Fill 'list' with every handler in 'handlers' that receives 'event_type'
+ * (NULL selects wildcards only), retaining each one.
+ */
+static int dispatch_list_fill(session_dispatch_list_t *list,
+                              session_handler_entry_t *handlers,
+                              const char *event_type)
+{
+    size_t count = 0;
+    for (session_handler_entry_t *h = handlers; h; h = h->next) {
+        if (!h->event_type_filter ||
+            (event_type && strcmp(h->event_type_filter, event_type) == 0)) {
+            count++;
+        }
+    }
+    if (count == 0) return 0;
+
+    list->entries = calloc(count, sizeof(session_handler_entry_t *));
+    if (!list->entries) return -1;
+
+    for (session_handler_entry_t *h = handlers; h; h = h->next) {
+        if (!h->event_type_filter ||
+            (event_type && strcmp(h->event_type_filter, event_type) == 0)) {
+            handler_entry_retain(h);
+            list->entries[list->count++] = h;
+        }
+    }
+    return 0;
+}
+
+static session_dispatch_list_t *dispatch_slot(session_dispatch_t *dispatch, const char *event_type)
+{
+    size_t mask = dispatch->by_type_count - 1;
+    size_t i = json_rpc_hash_string(event_type) & mask;
+    while (dispatch->by_type[i].event_type &&
+           strcmp(dispatch->by_type[i].event_type, event_type) != 0) {
+        i = (i + 1) & mask;
+    }
+    return &dispatch->by_type[i];
+}
+
+/**
+ * Build a snapshot of the session's registration list. Caller holds
+ * handlers_mutex. Sets *out to NULL when there are no handlers.
+ */
+static int dispatch_build(copilot_session_t *session, session_dispatch_t **out)
+{
+    *out = NULL;
+
+    size_t total = 0, typed = 0;
+    for (session_handler_entry_t *h = session->handlers; h; h = h->next) {
+        total++;
+        if (h->event_type_filter) typed++;
+    }
+    if (total == 0) return 0;
+
+    session_dispatch_t *dispatch = calloc(1, sizeof(session_dispatch_t));
+    if (!dispatch) return -1;
+    atomic_init(&dispatch->refcount, 1);
+
+    if (typed > 0) {
+        /* Keep the load factor at or below one half */
+        dispatch->by_type_count = 2;
+        while (dispatch->by_type_count < typed * 2) {
+            dispatch->by_type_count *= 2;
+        }
+        dispatch->by_type = calloc(dispatch->by_type_count, sizeof(session_dispatch_list_t));
+        if (!dispatch->by_type) {
+            free(dispatch);
+            return -1;
+        }
+    }
+
+    int rc = dispatch_list_fill(&dispatch->wildcard, session->handlers, NULL);
+    for (session_handler_entry_t *h = session->handlers; h && rc == 0; h = h->next) {
+        if (!h->event_type_filter) continue;
+        session_dispatch_list_t *slot = dispatch_slot(dispatch, h->event_type_filter);
+        if (slot->event_type) continue;  /* Already built for this type */
+        slot->event_type = h->event_type_filter;
+        rc = dispatch_list_fill(slot, session->handlers, h->event_type_filter);
+    }
+
+    if (rc != 0) {
+        dispatch_release(dispatch);
+        return -1;
+    }
+    *out = dispatch;
+    return 0;
+}
+
+/**
+ * Replace the session's snapshot after the registration list changed.
+ * Caller holds handlers_mutex. On failure the old snapshot stays in place.
+ */
+static int dispatch_rebuild(copilot_session_t *session)
+{
+    session_dispatch_t *dispatch;
+    if (dispatch_build(session, &dispatch) != 0) return -1;
+
+    session_dispatch_t *old = session->dispatch;
+    session->dispatch = dispatch;
+    dispatch_release(old);
+    return 0;
+}
+
+static session_dispatch_t *dispatch_acquire(copilot_session_t *session)
+{
+    pthread_mutex_lock(&session->handlers_mutex);
+    session_dispatch_t *dispatch = session->dispatch;
+    if (dispatch) {
+        atomic_fetch_add_explicit(&dispatch->refcount, 1, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&session->handlers_mutex);
+    return dispatch;
+}
+
+/**
+ * Returns the handlers receiving 'event_type', or NULL if there are none.
+ */
+static const session_dispatch_list_t *dispatch_lookup(session_dispatch_t *dispatch,
+                                                      const char *event_type)
+{
+    if (!dispatch) return NULL;
+
+    const session_dispatch_list_t *list = &dispatch->wildcard;
+    if (dispatch->by_type_count > 0) {
+        session_dispatch_list_t *slot = dispatch_slot(dispatch, event_type);
+        if (slot->event_type) list = slot;
+    }
+    return list->count > 0 ? list : NULL;
+}
+
+/**
+ * Invoke handlers without holding any lock; handlers may call
+ * copilot_session_on()/copilot_session_off() freely.
+ */
+static void dispatch_session_event(const session_dispatch_list_t *list,
                                    const copilot_session_event_t *event)
+{
+    for (size_t i = 0; i < list->count; i++) {
+        session_handler_entry_t *h = list->entries[i];
+        if (!atomic_load_explicit(&h->removed, memory_order_acquire)) {
+            h->handler(event, h->user_data);
+        }
+    }
+}
+
+/**
+ * Unregister every handler and drop the session's snapshot.
+ */
+static void clear_session_handlers(copilot_session_t *session)
 {
     pthread_mutex_lock(&session->handlers_mutex);
     session_handler_entry_t *h = session->handlers;
     while (h) {
-        if (!h->event_type_filter || strcmp(h->event_type_filter, event->type) == 0) {
-            h->handler(event, h->user_data);
-        }
-        h = h->next;
+        session_handler_entry_t *next = h->next;
+        atomic_store_explicit(&h->removed, true, memory_order_release);
+        handler_entry_release(h);
+        h = next;
     }
+    session->handlers = NULL;
+    session_dispatch_t *old = session->dispatch;
+    session->dispatch = NULL;
     pthread_mutex_unlock(&session->handlers_mutex);
+
+    dispatch_release(old);
+}
+
+/* ============================================================================
+ * Internal: turn tracking
+ * ============================================================================ */
+
+/**
+ * Release a turn's memory.
+ */
+static void turn_destroy(copilot_turn_t *turn)
+{
+    cJSON_Delete(turn->params);
+    free(turn->message_id);
+    free(turn->content);
+    free(turn);
+}
+
+/**
+ * Stop tracking a turn in its session. Caller holds turns_mutex.
+ */
+static void detach_turn_locked(copilot_turn_t *turn)
+{
+    if (!turn->session) return;
+
+    copilot_turn_t **pp = &turn->session->turns;
+    while (*pp && *pp != turn) {
+        pp = &(*pp)->next;
+    }
+    if (*pp) {
+        *pp = turn->next;
+    }
+    turn->next = NULL;
+    turn->session = NULL;
+}
+
+/**
+ * Complete a turn and wake every waiter. Caller holds turns_mutex.
+ */
+static void complete_turn_locked(copilot_turn_t *turn, copilot_error_t status)
+{
+    if (turn->done) return;
+
+    turn->done = true;
+    turn->status = status;
+    pthread_cond_broadcast(&turn->client->turns_cond);
+    if (turn->client->rpc) {
+        json_rpc_client_wake(turn->client->rpc);
+    }
+}
+
+/**
+ * Drop a turn the server is finished with from its session. Returns the turn
+ * if its caller already freed it and nothing else refers to it, so it can be
+ * destroyed after unlocking. Caller holds turns_mutex.
+ */
+static copilot_turn_t *retire_turn_locked(copilot_turn_t *turn)
+{
+    detach_turn_locked(turn);
+    return turn->released && !turn->send_pending ? turn : NULL;
+}
+
+/**
+ * Take the session's head turn for sending if it has not been sent yet.
+ * Caller holds turns_mutex; pass the result to send_turns() after unlocking.
+ */
+static copilot_turn_t *next_turn_locked(copilot_session_t *session)
+{
+    copilot_turn_t *turn = session->turns;
+    if (!turn || turn->sent) return NULL;
+
+    turn->sent = true;
+    turn->send_pending = true;
+    return turn;
+}
+
+static void on_turn_sent(cJSON *result, void *user_data);
+
+/**
+ * Issue session.send for a turn taken with next_turn_locked(). A turn whose
+ * send fails completes with an error and the turn queued behind it is tried.
+ */
+static void send_turns(copilot_client_t *client, copilot_turn_t *turn)
+{
+    while (turn) {
+        cJSON *params = turn->params;
+        turn->params = NULL;
+        if (client->rpc && json_rpc_client_request_detached_with_hook(
+                client->rpc, "session.send", params, on_turn_sent, turn) == 0) {
+            return;
+        }
+        if (!client->rpc) {
+            cJSON_Delete(params);
+        }
+
+        pthread_mutex_lock(&client->turns_mutex);
+        copilot_session_t *session = turn->session;
+        turn->send_pending = false;
+        complete_turn_locked(turn, COPILOT_ERROR_RPC);
+        copilot_turn_t *dead = retire_turn_locked(turn);
+        turn = session ? next_turn_locked(session) : NULL;
+        pthread_mutex_unlock(&client->turns_mutex);
+
+        if (dead) turn_destroy(dead);
+    }
+}
+
+/**
+ * session.send response hook: runs on the reader thread before any event
+ * that follows the response, so ordering against session.idle is exact.
+ * Without a result the send failed and the next queued turn goes out.
+ */
+static void on_turn_sent(cJSON *result, void *user_data)
+{
+    copilot_turn_t *turn = (copilot_turn_t *)user_data;
+    copilot_client_t *client = turn->client;
+    copilot_turn_t *dead = NULL;
+    copilot_turn_t *next = NULL;
+
+    pthread_mutex_lock(&client->turns_mutex);
+    copilot_session_t *session = turn->session;
+    turn->send_pending = false;
+    if (!session) {
+        /* Already retired; the caller may have freed it meanwhile */
+        dead = turn->released ? turn : NULL;
+    } else if (result) {
+        cJSON *mid = cJSON_GetObjectItem(result, "messageId");
+        turn->acked = true;
+        if (mid && cJSON_IsString(mid)) {
+            turn->message_id = strdup(mid->valuestring);
+        }
+    } else {
+        complete_turn_locked(turn, COPILOT_ERROR_RPC);
+        dead = retire_turn_locked(turn);
+        next = next_turn_locked(session);
+    }
+    pthread_mutex_unlock(&client->turns_mutex);
+
+    if (dead) turn_destroy(dead);
+    send_turns(client, next);
+}
+
+/**
+ * Apply a session event to the session's in-flight turn. Neither
+ * assistant.message nor session.idle names the message it answers, so turns
+ * are serialized per session and every event belongs to the head turn. A
+ * head that timed out or was cancelled stays there until the server reports
+ * the session idle, so its late events cannot reach the turn behind it.
+ */
+static void update_session_turns(copilot_session_t *session, const char *type, cJSON *data)
+{
+    bool is_message = strcmp(type, "assistant.message") == 0;
+    bool is_idle = !is_message && strcmp(type, "session.idle") == 0;
+    bool is_error = !is_message && !is_idle && strcmp(type, "session.error") == 0;
+    if (!is_message && !is_idle && !is_error) return;
+
+    cJSON *content = is_message && data ? cJSON_GetObjectItem(data, "content") : NULL;
+    if (is_message && !(content && cJSON_IsString(content))) return;
+
+    copilot_client_t *client = session->owner;
+    copilot_turn_t *dead = NULL;
+    copilot_turn_t *next = NULL;
+    pthread_mutex_lock(&client->turns_mutex);
+
+    copilot_turn_t *t = session->turns;
+    if (t && t->acked) {
+        if (is_message) {
+            if (!t->done) {
+                free(t->content);
+                t->content = strdup(content->valuestring);
+            }
+        } else {
+            complete_turn_locked(t, is_idle ? COPILOT_OK : COPILOT_ERROR_SESSION_ERROR);
+            dead = retire_turn_locked(t);
+            next = next_turn_locked(session);
+        }
+    }
+
+    pthread_mutex_unlock(&client->turns_mutex);
+
+    if (dead) turn_destroy(dead);
+    send_turns(client, next);
+}
+
+/**
+ * Complete every queued and in-flight turn of a session with the given status.
+ */
+static void fail_session_turns(copilot_session_t *session, copilot_error_t status)
+{
+    if (!session->owner) return;
+
+    copilot_turn_t *dead = NULL;
+    pthread_mutex_lock(&session->owner->turns_mutex);
+    while (session->turns) {
+        copilot_turn_t *t = session->turns;
+        complete_turn_locked(t, status);
+        if (retire_turn_locked(t)) {
+            t->next = dead;
+            dead = t;
+        }
+    }
+    pthread_mutex_unlock(&session->owner->turns_mutex);
+
+    while (dead) {
+        copilot_turn_t *next = dead->next;
+        turn_destroy(dead);
+        dead = next;
+    }
 }
 
 /* ============================================================================
@@ -246,69 +765,43 @@ static void on_session_event_notification(const char *method, cJSON *params, voi
     copilot_session_t *session = find_session(client, session_id);
     if (!session) return;
 
-    /* Build event struct */
-    copilot_session_event_t event;
-    memset(&event, 0, sizeof(event));
-
     cJSON *type_item = cJSON_GetObjectItem(event_item, "type");
-    if (type_item && cJSON_IsString(type_item)) {
-        event.type = type_item->valuestring;
-    } else {
-        event.type = "unknown";
-    }
+    const char *type = type_item && cJSON_IsString(type_item) ? type_item->valuestring
+                                                                : "unknown";
+    cJSON *data = cJSON_GetObjectItem(event_item, "data");
 
-    char *raw = cJSON_PrintUnformatted(event_item);
-    event.raw_json = raw;
+    /* Build the event view and dispatch only if someone is listening.
+     * Fields and raw JSON are resolved by the accessors on demand. */
+    session_dispatch_t *dispatch = dispatch_acquire(session);
+    const session_dispatch_list_t *list = dispatch_lookup(dispatch, type);
+    if (list) {
+        copilot_session_event_source_t source = { event_item, data, NULL };
+        copilot_session_event_t event = { type, &source };
 
-    /* Parse convenience fields */
-    cJSON *data = cJSON_GetObjectItem(event_item, "data");
-    if (data) {
-        cJSON *content = cJSON_GetObjectItem(data, "content");
-        if (content && cJSON_IsString(content)) {
-            event.content = content->valuestring;
-        }
-        cJSON *message = cJSON_GetObjectItem(data, "message");
-        if (message && cJSON_IsString(message)) {
-            event.message = message->valuestring;
-        }
-        cJSON *delta_content = cJSON_GetObjectItem(data, "deltaContent");
-        if (delta_content && cJSON_IsString(delta_content)) {
-            event.delta_content = delta_content->valuestring;
-        }
-        cJSON *tool_name = cJSON_GetObjectItem(data, "toolName");
-        if (tool_name && cJSON_IsString(tool_name)) {
-            event.tool_name = tool_name->valuestring;
-        }
-        cJSON *tool_call_id = cJSON_GetObjectItem(data, "toolCallId");
-        if (tool_call_id && cJSON_IsString(tool_call_id)) {
-            event.tool_call_id = tool_call_id->valuestring;
-        }
+        dispatch_session_event(list, &event);
+        cJSON_free(source.raw_json);
     }
+    dispatch_release(dispatch);
 
-    /* Dispatch to handlers */
-    dispatch_session_event(session, &event);
+    /* Update in-flight turns */
+    update_session_turns(session, type, data);
+}
 
-    /* Update SendAndWait state */
-    if (strcmp(event.type, "assistant.message") == 0 && event.content) {
-        pthread_mutex_lock(&session->idle_mutex);
-        free(session->last_assistant_content);
-        session->last_assistant_content = strdup(event.content);
-        pthread_mutex_unlock(&session->idle_mutex);
-    } else if (strcmp(event.type, "session.idle") == 0) {
-        pthread_mutex_lock(&session->idle_mutex);
-        session->idle_signaled = true;
-        pthread_cond_signal(&session->idle_cond);
-        pthread_mutex_unlock(&session->idle_mutex);
-    } else if (strcmp(event.type, "session.error") == 0) {
-        pthread_mutex_lock(&session->idle_mutex);
-        session->error_signaled = true;
-        free(session->error_message);
-        session->error_message = event.message ? strdup(event.message) : strdup("Session error");
-        pthread_cond_signal(&session->idle_cond);
-        pthread_mutex_unlock(&session->idle_mutex);
-    }
+/* ============================================================================
+ * Internal: JSON helpers
+ * ============================================================================ */
 
-    free(raw);
+/**
+ * Serializes 'item', or "{}" if it is NULL. Release with cJSON_free().
+ */
+static char *print_json_or_empty(const cJSON *item)
+{
+    if (item) {
+        return cJSON_PrintUnformatted(item);
+    }
+    char *empty = cJSON_malloc(3);
+    if (empty) memcpy(empty, "{}", 3);
+    return empty;
 }
 
 /* ============================================================================
@@ -364,7 +857,7 @@ static cJSON *on_tool_call_request(const char *method, cJSON *params, void *user
         snprintf(msg, sizeof(msg), "tool '%s' not supported", tool_name);
         cJSON_AddStringToObject(result_inner, "error", msg);
     } else {
-        char *args_json = arguments_item ? cJSON_PrintUnformatted(arguments_item) : strdup("{}");
+        char *args_json = print_json_or_empty(arguments_item);
 
         copilot_tool_invocation_t invocation;
         invocation.session_id = session_id;
@@ -399,7 +892,7 @@ static cJSON *on_tool_call_request(const char *method, cJSON *params, void *user
                 cJSON_AddStringToObject(result_inner, "error", tool_result.error);
             }
         }
-        free(args_json);
+        cJSON_free(args_json);
     }
 
     cJSON_AddItemToObject(result_obj, "result", result_inner);
@@ -455,7 +948,7 @@ static cJSON *on_permission_request(const char *method, cJSON *params, void *use
     copilot_error_t err = session->permission_handler(
         &request, session->session_id, session->permission_user_data, &perm_result);
 
-    free(raw);
+    cJSON_free(raw);
 
     cJSON *result = cJSON_CreateObject();
     cJSON *inner = cJSON_CreateObject();
@@ -573,11 +1066,11 @@ static cJSON *on_hooks_invoke(const char *method, cJSON *params, void *user_data
         return result;
     }
 
-    char *input_json = input_item ? cJSON_PrintUnformatted(input_item) : strdup("{}");
+    char *input_json = print_json_or_empty(input_item);
     char *output_json = session->hook_handler(
         hook_type_item->valuestring, input_json,
         session->session_id, session->hook_user_data);
-    free(input_json);
+    cJSON_free(input_json);
 
     cJSON *result = cJSON_CreateObject();
     if (output_json) {
@@ -795,9 +1288,8 @@ static copilot_error_t verify_protocol_version(copilot_client_t *client)
 
     int err_code = 0;
     char *err_msg = NULL;
-    cJSON *result = json_rpc_client_request(client->rpc, "ping", params, 10000,
-                                            &err_code, &err_msg);
-    cJSON_Delete(params);
+    cJSON *result = json_rpc_client_request_owned(client->rpc, "ping", params, 10000,
+                                                  &err_code, &err_msg);
 
     if (!result) {
         free(err_msg);
@@ -975,14 +1467,10 @@ static copilot_session_t *create_session_from_response(
     session->rpc = client->rpc;
     session->owner = client;
     session->handlers = NULL;
+    session->dispatch = NULL;
     session->next_handler_id = 0;
     pthread_mutex_init(&session->handlers_mutex, NULL);
-    pthread_mutex_init(&session->idle_mutex, NULL);
-    pthread_cond_init(&session->idle_cond, NULL);
-    session->idle_signaled = false;
-    session->error_signaled = false;
-    session->error_message = NULL;
-    session->last_assistant_content = NULL;
+    session->turns = NULL;
 
     cJSON *wp = cJSON_GetObjectItem(response, "workspacePath");
     if (wp && cJSON_IsString(wp)) {
@@ -1021,11 +1509,18 @@ static copilot_session_t *create_session_from_response(
 
 copilot_client_t *copilot_client_create(const copilot_client_options_t *options)
 {
+    copilot_client_options_t opts = options ? *options : copilot_client_options_default();
+
+    /* JSON allocator hooks: both or neither, and consistent across clients */
+    if (!opts.json_malloc != !opts.json_free) return NULL;
+    if ((opts.json_malloc || opts.message_arena_size > 0) &&
+        !json_arena_install_hooks(opts.json_malloc, opts.json_free)) {
+        return NULL;
+    }
+
     copilot_client_t *client = calloc(1, sizeof(copilot_client_t));
     if (!client) return NULL;
 
-    copilot_client_options_t opts = options ? *options : copilot_client_options_default();
-
     client->cli_path = opts.cli_path ? strdup(opts.cli_path) : NULL;
     client->cwd = opts.cwd ? strdup(opts.cwd) : NULL;
     client->log_level = strdup(opts.log_level ? opts.log_level : "info");
@@ -1034,6 +1529,10 @@ copilot_client_t *copilot_client_create(const copilot_client_options_t *options)
     client->auto_restart = opts.auto_restart;
     client->github_token = opts.github_token ? strdup(opts.github_token) : NULL;
     client->use_logged_in_user = opts.use_logged_in_user;
+    client->request_worker_threads = opts.request_worker_threads;
+    client->request_queue_capacity = opts.request_queue_capacity;
+    client->message_arena_size = opts.message_arena_size;
+    client->abort_on_timeout = opts.abort_on_timeout;
 
     /* Copy extra args */
     if (opts.extra_args) {
@@ -1049,7 +1548,12 @@ copilot_client_t *copilot_client_create(const copilot_client_options_t *options)
     client->state = COPILOT_STATE_DISCONNECTED;
     client->rpc = NULL;
     client->sessions = NULL;
+    client->session_buckets = NULL;
+    client->session_bucket_count = 0;
+    client->session_count = 0;
     pthread_mutex_init(&client->sessions_mutex, NULL);
+    pthread_mutex_init(&client->turns_mutex, NULL);
+    json_rpc_cond_init(&client->turns_cond);
 
 #ifdef _WIN32
     client->process_handle = NULL;
@@ -1092,6 +1596,13 @@ copilot_error_t copilot_client_start(copilot_client_t *client)
         return COPILOT_ERROR_OUT_OF_MEMORY;
     }
 
+    json_rpc_client_set_worker_pool(client->rpc, client->request_worker_threads,
+                                    client->request_queue_capacity);
+    if (json_rpc_client_set_message_arena(client->rpc, client->message_arena_size) != 0) {
+        /* Not fatal: messages are parsed onto the heap instead */
+        json_rpc_client_set_message_arena(client->rpc, 0);
+    }
+
     /* Register handlers */
     json_rpc_client_set_notification_handler(client->rpc, "session.event",
                                              on_session_event_notification, client);
@@ -1130,34 +1641,50 @@ copilot_error_t copilot_client_stop(copilot_client_t *client)
 {
     if (!client) return COPILOT_ERROR_INVALID_ARGUMENT;
 
-    /* Destroy all sessions */
+    /* Destroy all sessions. The requests go out without sessions_mutex held:
+     * the reader needs it to route events that arrive in the meantime */
     pthread_mutex_lock(&client->sessions_mutex);
-    copilot_session_t *s = client->sessions;
-    while (s) {
-        copilot_session_t *next = s->next;
+    size_t id_count = 0;
+    char **ids = client->rpc && client->session_count > 0
+                     ? calloc(client->session_count, sizeof(char *)) : NULL;
+    for (copilot_session_t *s = client->sessions; s && ids; s = s->next) {
+        ids[id_count++] = strdup(s->session_id);
+    }
+    pthread_mutex_unlock(&client->sessions_mutex);
+
+    for (size_t i = 0; i < id_count; i++) {
         /* Best-effort destroy */
-        if (client->rpc) {
+        if (ids[i]) {
             cJSON *params = cJSON_CreateObject();
-            cJSON_AddStringToObject(params, "sessionId", s->session_id);
+            cJSON_AddStringToObject(params, "sessionId", ids[i]);
             int ec = 0; char *em = NULL;
-            cJSON *r = json_rpc_client_request(client->rpc, "session.destroy",
-                                               params, 5000, &ec, &em);
-            cJSON_Delete(params);
+            cJSON *r = json_rpc_client_request_owned(client->rpc, "session.destroy",
+                                                     params, 5000, &ec, &em);
             if (r) cJSON_Delete(r);
             free(em);
         }
-        s = next;
+        free(ids[i]);
+    }
+    free(ids);
+
+    pthread_mutex_lock(&client->sessions_mutex);
+    for (copilot_session_t *s = client->sessions; s; s = s->next) {
+        fail_session_turns(s, COPILOT_ERROR_NOT_CONNECTED);
     }
     pthread_mutex_unlock(&client->sessions_mutex);
 
-    /* Stop RPC client */
+    /* Shut the write side down inside the RPC layer, under its write lock,
+     * so the reader and workers cannot write to a closed or reused fd. EOF on
+     * the CLI's stdin plus SIGTERM make it exit, and its exit gives the reader
+     * EOF: closing our read fd alone does not wake a reader blocked in read() */
     if (client->rpc) {
-        json_rpc_client_stop(client->rpc);
-        json_rpc_client_free(client->rpc);
-        client->rpc = NULL;
+        json_rpc_client_close_write(client->rpc);
+#ifdef _WIN32
+        client->stdin_write = NULL;   /* owned by the fd the RPC client closed */
+#else
+        client->stdin_write_fd = -1;
+#endif
     }
-
-    /* Kill CLI process */
 #ifdef _WIN32
     if (client->stdin_write) {
         CloseHandle(client->stdin_write);
@@ -1165,9 +1692,6 @@ copilot_error_t copilot_client_stop(copilot_client_t *client)
     }
     if (client->process_handle) {
         TerminateProcess(client->process_handle, 0);
-        WaitForSingleObject(client->process_handle, 5000);
-        CloseHandle(client->process_handle);
-        client->process_handle = NULL;
     }
 #else
     if (client->stdin_write_fd >= 0) {
@@ -1176,6 +1700,27 @@ copilot_error_t copilot_client_stop(copilot_client_t *client)
     }
     if (client->cli_pid > 0) {
         kill(client->cli_pid, SIGTERM);
+    }
+#endif
+
+    /* Stop RPC client (joins reader and worker threads). The reader fails
+     * every outstanding async request on its way out; deliver those now */
+    if (client->rpc) {
+        json_rpc_client_stop(client->rpc);
+        json_rpc_client_process(client->rpc);
+        json_rpc_client_free(client->rpc);
+        client->rpc = NULL;
+    }
+
+    /* Reap CLI process */
+#ifdef _WIN32
+    if (client->process_handle) {
+        WaitForSingleObject(client->process_handle, 5000);
+        CloseHandle(client->process_handle);
+        client->process_handle = NULL;
+    }
+#else
+    if (client->cli_pid > 0) {
         int status;
         waitpid(client->cli_pid, &status, 0);
         client->cli_pid = 0;
@@ -1197,6 +1742,7 @@ void copilot_client_free(copilot_client_t *client)
         copilot_session_free(s);
         s = next;
     }
+    free(client->session_buckets);
 
     free(client->cli_path);
     free(client->cwd);
@@ -1211,6 +1757,8 @@ void copilot_client_free(copilot_client_t *client)
     }
 
     pthread_mutex_destroy(&client->sessions_mutex);
+    pthread_mutex_destroy(&client->turns_mutex);
+    pthread_cond_destroy(&client->turns_cond);
     free(client);
 }
 
@@ -1234,9 +1782,8 @@ copilot_error_t copilot_client_ping(
 
     int err_code = 0;
     char *err_msg = NULL;
-    cJSON *result = json_rpc_client_request(client->rpc, "ping", params, 10000,
-                                            &err_code, &err_msg);
-    cJSON_Delete(params);
+    cJSON *result = json_rpc_client_request_owned(client->rpc, "ping", params, 10000,
+                                                  &err_code, &err_msg);
 
     if (!result) {
         free(err_msg);
@@ -1275,9 +1822,8 @@ copilot_error_t copilot_client_list_models(
     cJSON *params = cJSON_CreateObject();
     int err_code = 0;
     char *err_msg = NULL;
-    cJSON *result = json_rpc_client_request(client->rpc, "models.list", params, 30000,
-                                            &err_code, &err_msg);
-    cJSON_Delete(params);
+    cJSON *result = json_rpc_client_request_owned(client->rpc, "models.list", params, 30000,
+                                                  &err_code, &err_msg);
 
     if (!result) {
         free(err_msg);
@@ -1345,9 +1891,8 @@ copilot_error_t copilot_client_list_sessions(
     cJSON *params = cJSON_CreateObject();
     int err_code = 0;
     char *err_msg = NULL;
-    cJSON *result = json_rpc_client_request(client->rpc, "session.list", params, 10000,
-                                            &err_code, &err_msg);
-    cJSON_Delete(params);
+    cJSON *result = json_rpc_client_request_owned(client->rpc, "session.list", params, 10000,
+                                                  &err_code, &err_msg);
 
     if (!result) {
         free(err_msg);
@@ -1408,9 +1953,8 @@ copilot_error_t copilot_client_delete_session(
 
     int err_code = 0;
     char *err_msg = NULL;
-    cJSON *result = json_rpc_client_request(client->rpc, "session.delete", params, 10000,
-                                            &err_code, &err_msg);
-    cJSON_Delete(params);
+    cJSON *result = json_rpc_client_request_owned(client->rpc, "session.delete", params, 10000,
+                                                  &err_code, &err_msg);
 
     if (!result) {
         free(err_msg);
@@ -1432,6 +1976,136 @@ copilot_error_t copilot_client_delete_session(
     return COPILOT_OK;
 }
 
+/* ============================================================================
+ * Public API: Non-blocking requests
+ * ============================================================================ */
+
+/**
+ * json_rpc completion: runs inside copilot_client_process().
+ */
+static void on_request_complete(pending_request_t *call, void *user_data)
+{
+    copilot_request_t *request = (copilot_request_t *)user_data;
+
+    if (request->abandoned) {
+        json_rpc_call_free(call);
+        free(request);
+        return;
+    }
+
+    request->done = true;
+    request->callback(request, request->user_data);
+}
+
+copilot_error_t copilot_client_request_async(
+    copilot_client_t *client,
+    const char *method,
+    const char *params_json,
+    copilot_request_callback_fn callback,
+    void *user_data,
+    copilot_request_t **out_request)
+{
+    if (!client || !method || !callback || !out_request) return COPILOT_ERROR_INVALID_ARGUMENT;
+    if (!client->rpc) return COPILOT_ERROR_NOT_CONNECTED;
+
+    cJSON *params = NULL;
+    if (params_json) {
+        params = cJSON_Parse(params_json);
+        if (!params) return COPILOT_ERROR_JSON_PARSE;
+    }
+
+    copilot_request_t *request = calloc(1, sizeof(copilot_request_t));
+    if (!request) {
+        cJSON_Delete(params);
+        return COPILOT_ERROR_OUT_OF_MEMORY;
+    }
+    request->client = client;
+    request->callback = callback;
+    request->user_data = user_data;
+
+    request->call = json_rpc_client_request_async(client->rpc, method, params,
+                                                  on_request_complete, request);
+    if (!request->call) {
+        free(request);
+        return COPILOT_ERROR_IO;
+    }
+
+    *out_request = request;
+    return COPILOT_OK;
+}
+
+int copilot_client_get_fd(const copilot_client_t *client)
+{
+    if (!client || !client->rpc) return -1;
+    return json_rpc_client_get_fd(client->rpc);
+}
+
+copilot_error_t copilot_client_process(copilot_client_t *client)
+{
+    if (!client) return COPILOT_ERROR_INVALID_ARGUMENT;
+    if (!client->rpc) return COPILOT_ERROR_NOT_CONNECTED;
+
+    json_rpc_client_process(client->rpc);
+    return COPILOT_OK;
+}
+
+bool copilot_request_is_done(const copilot_request_t *request)
+{
+    return request && request->done;
+}
+
+const char *copilot_request_get_result(copilot_request_t *request)
+{
+    if (!request || !request->done || !request->call->result) return NULL;
+
+    if (!request->result_json) {
+        request->result_json = cJSON_PrintUnformatted(request->call->result);
+    }
+    return request->result_json;
+}
+
+copilot_error_t copilot_request_get_error(const copilot_request_t *request,
+                                          const char **out_message)
+{
+    if (out_message) *out_message = NULL;
+    if (!request) return COPILOT_ERROR_INVALID_ARGUMENT;
+    if (!request->done) return COPILOT_ERROR_TIMEOUT;
+
+    if (request->call->error_code != 0) {
+        if (out_message) *out_message = request->call->error_message;
+        return request->call->error_code == JSON_RPC_REQUEST_CANCELLED ? COPILOT_ERROR_CANCELLED
+                                                                       : COPILOT_ERROR_RPC;
+    }
+    return COPILOT_OK;
+}
+
+copilot_error_t copilot_request_cancel(copilot_request_t *request)
+{
+    if (!request) return COPILOT_ERROR_INVALID_ARGUMENT;
+    if (request->done || !request->client->rpc) return COPILOT_ERROR_INVALID_ARGUMENT;
+
+    if (json_rpc_client_cancel(request->client->rpc, request->call) != 0) {
+        /* The response is already queued; the callback reports it */
+        return COPILOT_ERROR_INVALID_ARGUMENT;
+    }
+    return COPILOT_OK;
+}
+
+void copilot_request_free(copilot_request_t *request)
+{
+    if (!request) return;
+
+    if (!request->done) {
+        /* Still queued in the RPC client; on_request_complete frees it */
+        request->abandoned = true;
+        return;
+    }
+
+    if (request->result_json) cJSON_free(request->result_json);
+    json_rpc_call_free(request->call);
+    free(request);
+}
+
 /* ============================================================================
  * Public API: Session creation
  * ============================================================================ */
@@ -1457,9 +2131,8 @@ copilot_error_t copilot_client_create_session(
 
     int err_code = 0;
     char *err_msg = NULL;
-    cJSON *result = json_rpc_client_request(client->rpc, "session.create", params, 30000,
-                                            &err_code, &err_msg);
-    cJSON_Delete(params);
+    cJSON *result = json_rpc_client_request_owned(client->rpc, "session.create", params, 30000,
+                                                  &err_code, &err_msg);
 
     if (!result) {
         free(err_msg);
@@ -1499,9 +2172,8 @@ copilot_error_t copilot_client_resume_session(
 
     int err_code = 0;
     char *err_msg = NULL;
-    cJSON *result = json_rpc_client_request(client->rpc, "session.resume", params, 30000,
-                                            &err_code, &err_msg);
-    cJSON_Delete(params);
+    cJSON *result = json_rpc_client_request_owned(client->rpc, "session.resume", params, 30000,
+                                                  &err_code, &err_msg);
 
     if (!result) {
         free(err_msg);
@@ -1532,14 +2204,11 @@ const char *copilot_session_get_workspace_path(const copilot_session_t *session)
     return session ? session->workspace_path : NULL;
 }
 
-copilot_error_t copilot_session_send(
-    copilot_session_t *session,
-    const copilot_message_options_t *options,
-    char **out_message_id)
+/**
+ * Build the session.send params for a message.
+ */
+static cJSON *build_send_params(copilot_session_t *session, const copilot_message_options_t *options)
 {
-    if (!session || !options || !options->prompt) return COPILOT_ERROR_INVALID_ARGUMENT;
-    if (!session->rpc) return COPILOT_ERROR_NOT_CONNECTED;
-
     cJSON *params = cJSON_CreateObject();
     cJSON_AddStringToObject(params, "sessionId", session->session_id);
     cJSON_AddStringToObject(params, "prompt", options->prompt);
@@ -1607,11 +2276,22 @@ copilot_error_t copilot_session_send(
         cJSON_AddItemToObject(params, "attachments", arr);
     }
 
+    return params;
+}
+
+copilot_error_t copilot_session_send(
+    copilot_session_t *session,
+    const copilot_message_options_t *options,
+    char **out_message_id)
+{
+    if (!session || !options || !options->prompt) return COPILOT_ERROR_INVALID_ARGUMENT;
+    if (!session->rpc) return COPILOT_ERROR_NOT_CONNECTED;
+
     int err_code = 0;
     char *err_msg = NULL;
-    cJSON *result = json_rpc_client_request(session->rpc, "session.send", params, 30000,
-                                            &err_code, &err_msg);
-    cJSON_Delete(params);
+    cJSON *result = json_rpc_client_request_owned(session->rpc, "session.send",
+                                                  build_send_params(session, options), 30000,
+                                                  &err_code, &err_msg);
 
     if (!result) {
         free(err_msg);
@@ -1633,65 +2313,217 @@ copilot_error_t copilot_session_send_and_wait(
     int timeout_ms,
     char **out_content)
 {
-    if (!session || !options) return COPILOT_ERROR_INVALID_ARGUMENT;
+    copilot_turn_t *turn = NULL;
+    copilot_error_t err = copilot_session_send_async(session, options, &turn);
+    if (err != COPILOT_OK) return err;
 
-    if (timeout_ms <= 0) timeout_ms = 60000;
+    err = copilot_turn_wait(turn, timeout_ms, out_content);
+    if (err == COPILOT_ERROR_TIMEOUT && session->owner->abort_on_timeout) {
+        copilot_turn_cancel(turn);
+    }
+    copilot_turn_free(turn);
+    return err;
+}
 
-    /* Reset idle state before sending */
-    pthread_mutex_lock(&session->idle_mutex);
-    session->idle_signaled = false;
-    session->error_signaled = false;
-    free(session->error_message);
-    session->error_message = NULL;
-    free(session->last_assistant_content);
-    session->last_assistant_content = NULL;
-    pthread_mutex_unlock(&session->idle_mutex);
-
-    /* Send message */
-    copilot_error_t err = copilot_session_send(session, options, NULL);
-    if (err != COPILOT_OK) return err;
+copilot_error_t copilot_session_send_async(
+    copilot_session_t *session,
+    const copilot_message_options_t *options,
+    copilot_turn_t **out_turn)
+{
+    if (!session || !options || !options->prompt || !out_turn) return COPILOT_ERROR_INVALID_ARGUMENT;
+    if (!session->owner || !session->rpc) return COPILOT_ERROR_NOT_CONNECTED;
+    *out_turn = NULL;
+
+    copilot_turn_t *turn = calloc(1, sizeof(copilot_turn_t));
+    if (!turn) return COPILOT_ERROR_OUT_OF_MEMORY;
+    turn->client = session->owner;
+    turn->session = session;
+    turn->status = COPILOT_OK;
+    turn->params = build_send_params(session, options);
+
+    /* Queue behind the session's earlier turns; the completion of the turn
+     * ahead sends this one, so nothing here waits on the server */
+    copilot_client_t *client = turn->client;
+    pthread_mutex_lock(&client->turns_mutex);
+    copilot_turn_t **tail = &session->turns;
+    while (*tail) {
+        tail = &(*tail)->next;
+    }
+    *tail = turn;
+    copilot_turn_t *next = next_turn_locked(session);
+    pthread_mutex_unlock(&client->turns_mutex);
+
+    send_turns(client, next);
+
+    /* A send that failed straight away is reported here, not through the turn */
+    pthread_mutex_lock(&client->turns_mutex);
+    copilot_error_t err = turn->done ? turn->status : COPILOT_OK;
+    pthread_mutex_unlock(&client->turns_mutex);
+    if (err != COPILOT_OK) {
+        copilot_turn_free(turn);
+        return err;
+    }
+
+    *out_turn = turn;
+    return COPILOT_OK;
+}
 
-    /* Wait for idle or error */
+copilot_error_t copilot_turn_wait(copilot_turn_t *turn, int timeout_ms, char **out_content)
+{
+    if (!turn) return COPILOT_ERROR_INVALID_ARGUMENT;
+    if (out_content) *out_content = NULL;
+
+    if (timeout_ms <= 0) timeout_ms = 60000;
     struct timespec ts;
-#ifdef _WIN32
-    struct timespec now;
-    timespec_get(&now, TIME_UTC);
-    ts.tv_sec = now.tv_sec + timeout_ms / 1000;
-    ts.tv_nsec = now.tv_nsec + (timeout_ms % 1000) * 1000000L;
-#else
-    clock_gettime(CLOCK_REALTIME, &ts);
-    ts.tv_sec += timeout_ms / 1000;
-    ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
-#endif
-    if (ts.tv_nsec >= 1000000000L) {
-        ts.tv_sec += 1;
-        ts.tv_nsec -= 1000000000L;
+    json_rpc_deadline_after_ms(timeout_ms, &ts);
+
+    copilot_client_t *client = turn->client;
+    pthread_mutex_lock(&client->turns_mutex);
+    while (!turn->done) {
+        int rc = pthread_cond_timedwait(&client->turns_cond, &client->turns_mutex, &ts);
+        if (rc == ETIMEDOUT && !turn->done) {
+            pthread_mutex_unlock(&client->turns_mutex);
+            return COPILOT_ERROR_TIMEOUT;
+        }
     }
 
-    pthread_mutex_lock(&session->idle_mutex);
-    while (!session->idle_signaled && !session->error_signaled) {
-        int rc = pthread_cond_timedwait(&session->idle_cond, &session->idle_mutex, &ts);
-        if (rc == ETIMEDOUT) {
-            pthread_mutex_unlock(&session->idle_mutex);
+    copilot_error_t status = turn->status;
+    if (status == COPILOT_OK && out_content && turn->content) {
+        *out_content = strdup(turn->content);
+    }
+    pthread_mutex_unlock(&client->turns_mutex);
+    return status;
+}
+
+/**
+ * Shared wait loop for copilot_turns_wait_any/all.
+ */
+static copilot_error_t wait_turns(copilot_turn_t *const *turns, size_t count, int timeout_ms,
+                                  bool wait_all, size_t *out_index)
+{
+    if (!turns || count == 0 || !turns[0]) return COPILOT_ERROR_INVALID_ARGUMENT;
+
+    copilot_client_t *client = turns[0]->client;
+    for (size_t i = 1; i < count; i++) {
+        if (!turns[i] || turns[i]->client != client) return COPILOT_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (timeout_ms <= 0) timeout_ms = 60000;
+    struct timespec ts;
+    json_rpc_deadline_after_ms(timeout_ms, &ts);
+
+    pthread_mutex_lock(&client->turns_mutex);
+    while (1) {
+        size_t done = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (!turns[i]->done) continue;
+            if (!wait_all) {
+                if (out_index) *out_index = i;
+                pthread_mutex_unlock(&client->turns_mutex);
+                return COPILOT_OK;
+            }
+            done++;
+        }
+        if (wait_all && done == count) break;
+
+        if (pthread_cond_timedwait(&client->turns_cond, &client->turns_mutex, &ts) == ETIMEDOUT) {
+            pthread_mutex_unlock(&client->turns_mutex);
             return COPILOT_ERROR_TIMEOUT;
         }
     }
+    pthread_mutex_unlock(&client->turns_mutex);
+    return COPILOT_OK;
+}
+
+copilot_error_t copilot_turns_wait_any(
+    copilot_turn_t *const *turns,
+    size_t count,
+    int timeout_ms,
+    size_t *out_index)
+{
+    return wait_turns(turns, count, timeout_ms, false, out_index);
+}
+
+copilot_error_t copilot_turns_wait_all(
+    copilot_turn_t *const *turns,
+    size_t count,
+    int timeout_ms)
+{
+    return wait_turns(turns, count, timeout_ms, true, NULL);
+}
+
+bool copilot_turn_is_done(const copilot_turn_t *turn)
+{
+    if (!turn) return false;
+
+    pthread_mutex_lock(&turn->client->turns_mutex);
+    bool done = turn->done;
+    pthread_mutex_unlock(&turn->client->turns_mutex);
+    return done;
+}
+
+const char *copilot_turn_get_message_id(const copilot_turn_t *turn)
+{
+    if (!turn) return NULL;
 
-    if (session->error_signaled) {
-        pthread_mutex_unlock(&session->idle_mutex);
-        return COPILOT_ERROR_SESSION_ERROR;
+    pthread_mutex_lock(&turn->client->turns_mutex);
+    const char *message_id = turn->message_id;
+    pthread_mutex_unlock(&turn->client->turns_mutex);
+    return message_id;
+}
+
+copilot_error_t copilot_turn_cancel(copilot_turn_t *turn)
+{
+    if (!turn) return COPILOT_ERROR_INVALID_ARGUMENT;
+
+    copilot_client_t *client = turn->client;
+    pthread_mutex_lock(&client->turns_mutex);
+    if (turn->done || !turn->session) {
+        pthread_mutex_unlock(&client->turns_mutex);
+        return COPILOT_ERROR_INVALID_ARGUMENT;
     }
 
-    if (out_content && session->last_assistant_content) {
-        *out_content = strdup(session->last_assistant_content);
-    } else if (out_content) {
-        *out_content = NULL;
+    complete_turn_locked(turn, COPILOT_ERROR_CANCELLED);
+    if (!turn->sent) {
+        /* Never reached the server */
+        detach_turn_locked(turn);
+        pthread_mutex_unlock(&client->turns_mutex);
+        return COPILOT_OK;
     }
 
-    pthread_mutex_unlock(&session->idle_mutex);
+    /* A sent turn keeps the session until the abort leaves it idle */
+    cJSON *params = cJSON_CreateObject();
+    cJSON_AddStringToObject(params, "sessionId", turn->session->session_id);
+    pthread_mutex_unlock(&client->turns_mutex);
+
+    /* Fire and forget, so event loops never block on the reply */
+    if (!client->rpc) {
+        cJSON_Delete(params);
+        return COPILOT_ERROR_NOT_CONNECTED;
+    }
+    if (json_rpc_client_request_detached(client->rpc, "session.abort", params) != 0) {
+        return COPILOT_ERROR_IO;
+    }
     return COPILOT_OK;
 }
 
+void copilot_turn_free(copilot_turn_t *turn)
+{
+    if (!turn) return;
+
+    /* A sent turn stays queued until the server is done with it */
+    pthread_mutex_lock(&turn->client->turns_mutex);
+    bool keep = turn->send_pending || (turn->session && turn->sent);
+    if (keep) {
+        turn->released = true;
+    } else {
+        detach_turn_locked(turn);
+    }
+    pthread_mutex_unlock(&turn->client->turns_mutex);
+
+    if (!keep) turn_destroy(turn);
+}
+
 int copilot_session_on(
     copilot_session_t *session,
     copilot_session_event_handler_fn handler,
@@ -1711,14 +2543,32 @@ int copilot_session_on_type(
     session_handler_entry_t *entry = calloc(1, sizeof(session_handler_entry_t));
     if (!entry) return -1;
 
+    entry->event_type_filter = event_type ? strdup(event_type) : NULL;
+    if (event_type && !entry->event_type_filter) {
+        free(entry);
+        return -1;
+    }
+    entry->handler = handler;
+    entry->user_data = user_data;
+    atomic_init(&entry->refcount, 1);
+    atomic_init(&entry->removed, false);
+    entry->next = NULL;
+
     pthread_mutex_lock(&session->handlers_mutex);
+    session_handler_entry_t **tail = &session->handlers;
+    while (*tail) {
+        tail = &(*tail)->next;
+    }
+    *tail = entry;
+
+    if (dispatch_rebuild(session) != 0) {
+        *tail = NULL;
+        pthread_mutex_unlock(&session->handlers_mutex);
+        handler_entry_release(entry);
+        return -1;
+    }
     int id = session->next_handler_id++;
     entry->id = id;
-    entry->event_type_filter = event_type ? event_type : NULL;
-    entry->handler = handler;
-    entry->user_data = user_data;
-    entry->next = session->handlers;
-    session->handlers = entry;
     pthread_mutex_unlock(&session->handlers_mutex);
 
     return id;
@@ -1734,7 +2584,10 @@ void copilot_session_off(copilot_session_t *session, int handler_id)
         if ((*pp)->id == handler_id) {
             session_handler_entry_t *entry = *pp;
             *pp = entry->next;
-            free(entry);
+            /* Snapshots still in flight may hold the entry; they skip it from now on */
+            atomic_store_explicit(&entry->removed, true, memory_order_release);
+            dispatch_rebuild(session);
+            handler_entry_release(entry);
             break;
         }
         pp = &(*pp)->next;
@@ -1752,9 +2605,8 @@ copilot_error_t copilot_session_destroy(copilot_session_t *session)
 
     int err_code = 0;
     char *err_msg = NULL;
-    cJSON *result = json_rpc_client_request(session->rpc, "session.destroy", params, 10000,
-                                            &err_code, &err_msg);
-    cJSON_Delete(params);
+    cJSON *result = json_rpc_client_request_owned(session->rpc, "session.destroy", params, 10000,
+                                                  &err_code, &err_msg);
 
     if (result) cJSON_Delete(result);
     free(err_msg);
@@ -1764,16 +2616,9 @@ copilot_error_t copilot_session_destroy(copilot_session_t *session)
         remove_session(session->owner, session);
     }
 
-    /* Clear handlers */
-    pthread_mutex_lock(&session->handlers_mutex);
-    session_handler_entry_t *h = session->handlers;
-    while (h) {
-        session_handler_entry_t *next = h->next;
-        free(h);
-        h = next;
-    }
-    session->handlers = NULL;
-    pthread_mutex_unlock(&session->handlers_mutex);
+    /* Complete in-flight turns and clear handlers */
+    fail_session_turns(session, COPILOT_ERROR_NOT_CONNECTED);
+    clear_session_handlers(session);
 
     return COPILOT_OK;
 }
@@ -1785,20 +2630,14 @@ void copilot_session_free(copilot_session_t *session)
     free(session->session_id);
     free(session->workspace_path);
     free(session->tools);
-    free(session->last_assistant_content);
-    free(session->error_message);
+
+    /* Turns still waiting on this session complete with an error */
+    fail_session_turns(session, COPILOT_ERROR_NOT_CONNECTED);
 
     /* Free remaining handlers */
-    session_handler_entry_t *h = session->handlers;
-    while (h) {
-        session_handler_entry_t *next = h->next;
-        free(h);
-        h = next;
-    }
+    clear_session_handlers(session);
 
     pthread_mutex_destroy(&session->handlers_mutex);
-    pthread_mutex_destroy(&session->idle_mutex);
-    pthread_cond_destroy(&session->idle_cond);
 
     free(session);
 }
@@ -1813,9 +2652,8 @@ copilot_error_t copilot_session_abort(copilot_session_t *session)
 
     int err_code = 0;
     char *err_msg = NULL;
-    cJSON *result = json_rpc_client_request(session->rpc, "session.abort", params, 10000,
-                                            &err_code, &err_msg);
-    cJSON_Delete(params);
+    cJSON *result = json_rpc_client_request_owned(session->rpc, "session.abort", params, 10000,
+                                                  &err_code, &err_msg);
 
     if (result) cJSON_Delete(result);
     free(err_msg);
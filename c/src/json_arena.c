@@ -0,0 +1,220 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Microsoft Corporation. All rights reserved.
+ *--------------------------------------------------------------------------------------------*/
+
+/**
+ * @file json_arena.c
+ * @brief Internal cJSON allocator hooks with per-message parse arenas.
+ */
+
+#include "json_arena.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <cjson/cJSON.h>
+
+/* Allocation granularity; matches what malloc guarantees on common targets */
+#define ARENA_ALIGN ((size_t)16)
+#define ARENA_ROUND(n) (((n) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+/* Allocations larger than this fraction of a block go straight to the base allocator */
+#define ARENA_MAX_ALLOC_DIVISOR 4
+
+/* ============================================================================
+ * Types
+ * ============================================================================ */
+
+typedef struct json_arena_block {
+    char *data;
+    size_t cap;
+    size_t used;                     /**< Only touched by the owning arena's thread */
+    atomic_size_t refs;              /**< Live allocations, plus one while it is the current block */
+} json_arena_block_t;
+
+struct json_arena {
+    size_t block_size;
+    json_arena_block_t *current;
+};
+
+/* Precedes every allocation handed to cJSON, so a free needs no lookup */
+typedef struct alloc_header {
+    json_arena_block_t *block;       /**< Owning block, or NULL for heap memory */
+    uintptr_t tag;                   /**< ALLOC_TAG_ARENA or ALLOC_TAG_HEAP */
+} alloc_header_t;
+
+#define ALLOC_HEADER ARENA_ROUND(sizeof(alloc_header_t))
+#define ALLOC_TAG_ARENA ((uintptr_t)0x4a534f4e41524e41u)
+#define ALLOC_TAG_HEAP  ((uintptr_t)0x4a534f4e48454150u)
+
+/* ============================================================================
+ * Global state
+ * ============================================================================ */
+
+static void *(*base_malloc)(size_t) = malloc;
+static void (*base_free)(void *) = free;
+
+static pthread_mutex_t hooks_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool hooks_installed = false;
+
+/* Arena receiving this thread's cJSON allocations, if any */
+static _Thread_local json_arena_t *active_arena = NULL;
+
+/* ============================================================================
+ * Blocks
+ * ============================================================================ */
+
+static json_arena_block_t *block_create(size_t cap)
+{
+    size_t header = ARENA_ROUND(sizeof(json_arena_block_t));
+    json_arena_block_t *block = base_malloc(header + cap);
+    if (!block) return NULL;
+
+    block->data = (char *)block + header;
+    block->cap = cap;
+    block->used = 0;
+    atomic_init(&block->refs, 1);
+    return block;
+}
+
+static void block_release(json_arena_block_t *block)
+{
+    if (atomic_fetch_sub_explicit(&block->refs, 1, memory_order_acq_rel) != 1) return;
+    base_free(block);
+}
+
+/**
+ * Carves a tagged allocation of 'size' bytes (header included) from the arena.
+ */
+static alloc_header_t *arena_alloc(json_arena_t *arena, size_t size)
+{
+    size = ARENA_ROUND(size);
+    if (size > arena->block_size / ARENA_MAX_ALLOC_DIVISOR) {
+        return NULL;
+    }
+
+    json_arena_block_t *block = arena->current;
+    if (!block || block->used + size > block->cap) {
+        /* Retire the full block; it goes away with its last allocation */
+        if (block) block_release(block);
+        block = block_create(arena->block_size);
+        arena->current = block;
+        if (!block) return NULL;
+    }
+
+    alloc_header_t *header = (alloc_header_t *)(block->data + block->used);
+    block->used += size;
+    atomic_fetch_add_explicit(&block->refs, 1, memory_order_relaxed);
+    header->block = block;
+    header->tag = ALLOC_TAG_ARENA;
+    return header;
+}
+
+/* ============================================================================
+ * cJSON hooks
+ * ============================================================================ */
+
+static void *hook_malloc(size_t size)
+{
+    if (size > SIZE_MAX - ALLOC_HEADER) return NULL;
+
+    alloc_header_t *header = NULL;
+    json_arena_t *arena = active_arena;
+    if (arena) {
+        header = arena_alloc(arena, ALLOC_HEADER + size);
+    }
+    if (!header) {
+        header = base_malloc(ALLOC_HEADER + size);
+        if (!header) return NULL;
+        header->block = NULL;
+        header->tag = ALLOC_TAG_HEAP;
+    }
+    return (char *)header + ALLOC_HEADER;
+}
+
+static void hook_free(void *ptr)
+{
+    if (!ptr) return;
+
+    alloc_header_t *header = (alloc_header_t *)((char *)ptr - ALLOC_HEADER);
+    if (header->tag == ALLOC_TAG_ARENA) {
+        block_release(header->block);
+    } else {
+        header->tag = 0;
+        base_free(header);
+    }
+}
+
+/* ============================================================================
+ * Public (internal) API
+ * ============================================================================ */
+
+bool json_arena_install_hooks(void *(*malloc_fn)(size_t), void (*free_fn)(void *))
+{
+    if (!malloc_fn || !free_fn) {
+        malloc_fn = malloc;
+        free_fn = free;
+    }
+
+    pthread_mutex_lock(&hooks_mutex);
+    bool ok;
+    if (!hooks_installed) {
+        base_malloc = malloc_fn;
+        base_free = free_fn;
+        cJSON_Hooks hooks = { hook_malloc, hook_free };
+        cJSON_InitHooks(&hooks);
+        hooks_installed = true;
+        ok = true;
+    } else {
+        ok = base_malloc == malloc_fn && base_free == free_fn;
+    }
+    pthread_mutex_unlock(&hooks_mutex);
+    return ok;
+}
+
+json_arena_t *json_arena_create(size_t block_size)
+{
+    if (block_size < (ALLOC_HEADER + ARENA_ALIGN) * ARENA_MAX_ALLOC_DIVISOR) return NULL;
+
+    json_arena_t *arena = calloc(1, sizeof(json_arena_t));
+    if (!arena) return NULL;
+
+    arena->block_size = ARENA_ROUND(block_size);
+    arena->current = NULL;
+    return arena;
+}
+
+void json_arena_destroy(json_arena_t *arena)
+{
+    if (!arena) return;
+    if (arena->current) {
+        block_release(arena->current);
+    }
+    free(arena);
+}
+
+void json_arena_begin(json_arena_t *arena)
+{
+    if (!arena) return;
+
+    json_arena_block_t *block = arena->current;
+    if (block) {
+        if (atomic_load_explicit(&block->refs, memory_order_acquire) == 1) {
+            /* Everything parsed into it has been freed: start over */
+            block->used = 0;
+        } else {
+            /* An earlier tree is still alive elsewhere; leave it the block */
+            block_release(block);
+            arena->current = NULL;
+        }
+    }
+    active_arena = arena;
+}
+
+void json_arena_end(json_arena_t *arena)
+{
+    if (active_arena == arena) {
+        active_arena = NULL;
+    }
+}
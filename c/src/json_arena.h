@@ -0,0 +1,81 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Microsoft Corporation. All rights reserved.
+ *--------------------------------------------------------------------------------------------*/
+
+/**
+ * @file json_arena.h
+ * @brief Internal cJSON allocator hooks with per-message parse arenas.
+ *
+ * cJSON does one allocation per node and per string. While a thread is inside
+ * json_arena_begin()/json_arena_end(), those allocations are carved from the
+ * arena's current block instead, so parsing a message costs a bump-pointer
+ * per node and the block is reused for the next message once the tree is gone.
+ *
+ * Callers copy out whatever must outlive the message (responses handed to a
+ * waiting thread, requests queued for a worker), so a block normally only
+ * holds the tree being dispatched. Blocks are still refcounted by their live
+ * allocations: if anything is alive when the next message starts, the block
+ * is retired and freed with its last allocation, and a fresh block is used.
+ *
+ * Every allocation made through the hooks carries a small header naming its
+ * block (or none, for heap memory), so a free from any thread is a tag check
+ * and an atomic decrement, with no lock or lookup.
+ *
+ * cJSON hooks are process-wide and replace any the application installed, so
+ * they are only installed when a client asks for them, by the first caller of
+ * json_arena_install_hooks(). Every free then expects that header: a tree
+ * allocated before the hooks were installed must be deleted before that.
+ */
+
+#ifndef COPILOT_JSON_ARENA_H
+#define COPILOT_JSON_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Suggested arena block size. Messages needing more spill into a fresh block. */
+#define JSON_ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+typedef struct json_arena json_arena_t;
+
+/**
+ * Installs the SDK's cJSON hooks on top of the given base allocator
+ * (NULL for malloc/free). Only the first call has any effect.
+ *
+ * @return true if these hooks are now active, false if an earlier call
+ *         installed hooks with a different base allocator.
+ */
+bool json_arena_install_hooks(void *(*malloc_fn)(size_t), void (*free_fn)(void *));
+
+/**
+ * Creates an arena that allocates blocks of 'block_size' bytes.
+ * Requires json_arena_install_hooks() to have been called.
+ */
+json_arena_t *json_arena_create(size_t block_size);
+
+/**
+ * Destroys the arena. Blocks still referenced by live trees are freed when
+ * those trees are.
+ */
+void json_arena_destroy(json_arena_t *arena);
+
+/**
+ * Routes the calling thread's cJSON allocations into the arena until
+ * json_arena_end(). Only one thread may use a given arena.
+ */
+void json_arena_begin(json_arena_t *arena);
+
+/**
+ * Stops routing the calling thread's cJSON allocations into the arena.
+ */
+void json_arena_end(json_arena_t *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COPILOT_JSON_ARENA_H */
@@ -21,25 +21,87 @@
 #define write_fd_fn _write
 #else
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/uio.h>
 #define read_fd_fn  read
 #define write_fd_fn write
 #endif
 
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
 /* ============================================================================
  * Internal helpers
  * ============================================================================ */
 
-static char *generate_request_id(json_rpc_client_t *client)
+/* pthread_condattr_setclock() is missing on macOS and in pthreads-win32 */
+#if !defined(_WIN32) && !defined(__APPLE__)
+#define JSON_RPC_MONOTONIC_WAITS 1
+#endif
+
+void json_rpc_cond_init(pthread_cond_t *cond)
+{
+#ifdef JSON_RPC_MONOTONIC_WAITS
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+#else
+    pthread_cond_init(cond, NULL);
+#endif
+}
+
+void json_rpc_deadline_after_ms(int timeout_ms, struct timespec *ts)
 {
-    pthread_mutex_lock(&client->id_mutex);
-    unsigned long id = client->next_id++;
-    pthread_mutex_unlock(&client->id_mutex);
+#if defined(JSON_RPC_MONOTONIC_WAITS)
+    clock_gettime(CLOCK_MONOTONIC, ts);
+#elif defined(_WIN32)
+    timespec_get(ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_REALTIME, ts);
+#endif
+    ts->tv_sec += timeout_ms / 1000;
+    ts->tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec += 1;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
 
-    char buf[32];
-    snprintf(buf, sizeof(buf), "%lu", id);
-    return strdup(buf);
+static unsigned long generate_request_id(json_rpc_client_t *client)
+{
+    return atomic_fetch_add_explicit(&client->next_id, 1, memory_order_relaxed);
 }
 
+#ifndef _WIN32
+/**
+ * Write all iovecs with as few writev() calls as possible.
+ */
+static int writev_all(int fd, struct iovec *iov, int iovcnt)
+{
+    while (iovcnt > 0) {
+        ssize_t n = writev(fd, iov, iovcnt);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            return -1;
+        }
+        /* Advance past fully written vectors, then trim the partial one */
+        size_t done = (size_t)n;
+        while (iovcnt > 0 && done >= iov->iov_len) {
+            done -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + done;
+            iov->iov_len -= done;
+        }
+    }
+    return 0;
+}
+#else
 /**
  * Write exactly 'len' bytes to the file descriptor.
  */
@@ -55,9 +117,11 @@ static int write_all(int fd, const char *buf, size_t len)
     }
     return 0;
 }
+#endif
 
 /**
  * Send a JSON-RPC message with Content-Length framing.
+ * Header and body go out in a single writev() so each frame is one syscall.
  */
 static int send_message(json_rpc_client_t *client, cJSON *message)
 {
@@ -72,78 +136,195 @@ static int send_message(json_rpc_client_t *client, cJSON *message)
                               "Content-Length: %zu\r\n\r\n", json_len);
 
     pthread_mutex_lock(&client->write_mutex);
+    if (client->write_fd < 0) {
+        /* Write side already shut down by json_rpc_client_close_write() */
+        pthread_mutex_unlock(&client->write_mutex);
+        cJSON_free(json_str);
+        return -1;
+    }
+#ifdef _WIN32
     int rc = write_all(client->write_fd, header, (size_t)header_len);
     if (rc == 0) {
         rc = write_all(client->write_fd, json_str, json_len);
     }
+#else
+    struct iovec iov[2];
+    iov[0].iov_base = header;
+    iov[0].iov_len = (size_t)header_len;
+    iov[1].iov_base = json_str;
+    iov[1].iov_len = json_len;
+    int rc = writev_all(client->write_fd, iov, 2);
+#endif
     pthread_mutex_unlock(&client->write_mutex);
 
-    free(json_str);
+    cJSON_free(json_str);
     return rc;
 }
 
+/* ============================================================================
+ * Buffered input
+ * ============================================================================ */
+
 /**
- * Read a line (up to \n) from the file descriptor.
- * Returns the number of bytes read (including \n), or -1 on error/EOF.
+ * Make room for at least 'need' unread bytes in the read buffer, compacting
+ * consumed bytes away first and growing only when that is not enough.
  */
-static int read_line(int fd, char *buf, size_t max_len)
+static int read_buf_reserve(json_rpc_client_t *client, size_t need)
 {
-    size_t pos = 0;
-    while (pos < max_len - 1) {
-        char c;
-        int n = read_fd_fn(fd, &c, 1);
-        if (n <= 0) {
-            return -1;
-        }
-        buf[pos++] = c;
-        if (c == '\n') {
-            break;
+    size_t unread = client->rbuf_end - client->rbuf_start;
+
+    if (client->rbuf_start > 0 && client->rbuf_cap - client->rbuf_start < need + 1) {
+        memmove(client->rbuf, client->rbuf + client->rbuf_start, unread);
+        client->rbuf_start = 0;
+        client->rbuf_end = unread;
+    }
+
+    if (client->rbuf_cap < need + 1) {
+        size_t new_cap = client->rbuf_cap ? client->rbuf_cap : JSON_RPC_READ_CHUNK;
+        while (new_cap < need + 1) {
+            new_cap *= 2;
         }
+        char *buf = realloc(client->rbuf, new_cap);
+        if (!buf) return -1;
+        client->rbuf = buf;
+        client->rbuf_cap = new_cap;
     }
-    buf[pos] = '\0';
-    return (int)pos;
+    return 0;
 }
 
 /**
- * Read exactly 'len' bytes from the file descriptor.
+ * Read one chunk from the file descriptor into the read buffer.
+ * Returns the number of bytes read, or -1 on error/EOF.
  */
-static int read_exact(int fd, char *buf, size_t len)
+static int read_buf_fill(json_rpc_client_t *client)
 {
-    size_t total = 0;
-    while (total < len) {
-        int n = read_fd_fn(fd, buf + total, (unsigned int)(len - total));
-        if (n <= 0) {
-            return -1;
+    size_t unread = client->rbuf_end - client->rbuf_start;
+    if (read_buf_reserve(client, unread + JSON_RPC_READ_CHUNK) != 0) {
+        return -1;
+    }
+
+    int n;
+    do {
+        n = read_fd_fn(client->read_fd, client->rbuf + client->rbuf_end,
+                       (unsigned int)(client->rbuf_cap - client->rbuf_end - 1));
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+        return -1;
+    }
+    client->rbuf_end += (size_t)n;
+    return n;
+}
+
+/**
+ * Parse the Content-Length value from a header line, or -1 if the line is
+ * some other header.
+ */
+static long parse_content_length(const char *line, size_t len)
+{
+    static const char prefix[] = "Content-Length:";
+    const size_t prefix_len = sizeof(prefix) - 1;
+
+    if (len < prefix_len || memcmp(line, prefix, prefix_len) != 0) {
+        return -1;
+    }
+
+    size_t i = prefix_len;
+    while (i < len && (line[i] == ' ' || line[i] == '\t')) i++;
+
+    long value = 0;
+    bool any = false;
+    while (i < len && line[i] >= '0' && line[i] <= '9') {
+        value = value * 10 + (line[i] - '0');
+        if (value > JSON_RPC_MAX_MESSAGE_SIZE) return -1;
+        any = true;
+        i++;
+    }
+    return any ? value : -1;
+}
+
+/**
+ * Read the next framed message and parse it straight out of the read buffer.
+ * Returns 1 with *out set (NULL if the body is not valid JSON),
+ * 0 for a frame without a usable Content-Length, or -1 on error/EOF.
+ */
+static int read_message(json_rpc_client_t *client, cJSON **out)
+{
+    long content_length = 0;
+    *out = NULL;
+
+    /* Scan header lines until the blank line */
+    while (1) {
+        const char *start = client->rbuf + client->rbuf_start;
+        size_t avail = client->rbuf_end - client->rbuf_start;
+        const char *nl = avail > 0 ? memchr(start, '\n', avail) : NULL;
+
+        if (!nl) {
+            if (avail > JSON_RPC_MAX_HEADER_SIZE) return -1;
+            if (read_buf_fill(client) < 0) return -1;
+            continue;
+        }
+
+        size_t line_len = (size_t)(nl - start);
+        client->rbuf_start += line_len + 1;
+        if (line_len > 0 && start[line_len - 1] == '\r') line_len--;
+
+        if (line_len == 0) {
+            break;  /* End of headers */
+        }
+
+        long len = parse_content_length(start, line_len);
+        if (len >= 0) {
+            content_length = len;
         }
-        total += (size_t)n;
     }
-    return 0;
+
+    if (content_length <= 0) {
+        return 0;
+    }
+
+    /* Make sure the whole body is buffered */
+    size_t body_len = (size_t)content_length;
+    if (read_buf_reserve(client, body_len) != 0) {
+        return -1;
+    }
+    while (client->rbuf_end - client->rbuf_start < body_len) {
+        if (read_buf_fill(client) < 0) return -1;
+    }
+
+    json_arena_begin(client->arena);
+    *out = cJSON_ParseWithLength(client->rbuf + client->rbuf_start, body_len);
+    json_arena_end(client->arena);
+    client->rbuf_start += body_len;
+    if (client->rbuf_start == client->rbuf_end) {
+        client->rbuf_start = 0;
+        client->rbuf_end = 0;
+    }
+    return 1;
 }
 
 /* ============================================================================
  * Pending request management
  * ============================================================================ */
 
-static pending_request_t *pending_request_create(const char *id)
+static pending_request_t *pending_request_create(unsigned long id)
 {
     pending_request_t *pr = calloc(1, sizeof(pending_request_t));
     if (!pr) return NULL;
 
-    pr->id = strdup(id);
+    pr->id = id;
     pr->completed = false;
     pr->result = NULL;
     pr->error_code = 0;
     pr->error_message = NULL;
     pr->next = NULL;
     pthread_mutex_init(&pr->mutex, NULL);
-    pthread_cond_init(&pr->cond, NULL);
+    json_rpc_cond_init(&pr->cond);
     return pr;
 }
 
 static void pending_request_free(pending_request_t *pr)
 {
     if (!pr) return;
-    free(pr->id);
     if (pr->result) cJSON_Delete(pr->result);
     free(pr->error_message);
     pthread_mutex_destroy(&pr->mutex);
@@ -151,76 +332,210 @@ static void pending_request_free(pending_request_t *pr)
     free(pr);
 }
 
+/**
+ * Double the pending slot array and rehash. Caller holds pending_mutex.
+ * On allocation failure the old table is kept (chains just get longer).
+ */
+static void grow_pending_slots(json_rpc_client_t *client)
+{
+    size_t new_count = client->pending_slot_count * 2;
+    pending_request_t **slots = calloc(new_count, sizeof(pending_request_t *));
+    if (!slots) return;
+
+    for (size_t i = 0; i < client->pending_slot_count; i++) {
+        pending_request_t *pr = client->pending_slots[i];
+        while (pr) {
+            pending_request_t *next = pr->next;
+            size_t slot = pr->id & (new_count - 1);
+            pr->next = slots[slot];
+            slots[slot] = pr;
+            pr = next;
+        }
+    }
+
+    free(client->pending_slots);
+    client->pending_slots = slots;
+    client->pending_slot_count = new_count;
+}
+
 static void add_pending(json_rpc_client_t *client, pending_request_t *pr)
 {
     pthread_mutex_lock(&client->pending_mutex);
-    pr->next = client->pending_requests;
-    client->pending_requests = pr;
+    if (client->pending_count >= client->pending_slot_count) {
+        grow_pending_slots(client);
+    }
+    size_t slot = pr->id & (client->pending_slot_count - 1);
+    pr->next = client->pending_slots[slot];
+    client->pending_slots[slot] = pr;
+    client->pending_count++;
     pthread_mutex_unlock(&client->pending_mutex);
 }
 
-static void remove_pending(json_rpc_client_t *client, pending_request_t *pr)
+/**
+ * Unlink a pending request. Returns false if it was no longer registered,
+ * i.e. the reader has already taken it to deliver a response.
+ */
+static bool remove_pending(json_rpc_client_t *client, pending_request_t *pr)
 {
+    bool found = false;
     pthread_mutex_lock(&client->pending_mutex);
-    pending_request_t **pp = &client->pending_requests;
+    size_t slot = pr->id & (client->pending_slot_count - 1);
+    pending_request_t **pp = &client->pending_slots[slot];
     while (*pp) {
         if (*pp == pr) {
             *pp = pr->next;
+            client->pending_count--;
+            found = true;
             break;
         }
         pp = &(*pp)->next;
     }
     pthread_mutex_unlock(&client->pending_mutex);
+    return found;
 }
 
-static pending_request_t *find_pending_by_id(json_rpc_client_t *client, const char *id)
+/**
+ * Find and unlink the pending request with the given ID, so a requester
+ * that times out concurrently knows a response is on its way.
+ */
+static pending_request_t *take_pending_by_id(json_rpc_client_t *client, unsigned long id)
 {
     pthread_mutex_lock(&client->pending_mutex);
-    pending_request_t *pr = client->pending_requests;
-    while (pr) {
-        if (strcmp(pr->id, id) == 0) {
-            pthread_mutex_unlock(&client->pending_mutex);
-            return pr;
-        }
-        pr = pr->next;
+    pending_request_t **pp = &client->pending_slots[id & (client->pending_slot_count - 1)];
+    while (*pp && (*pp)->id != id) {
+        pp = &(*pp)->next;
+    }
+    pending_request_t *pr = *pp;
+    if (pr) {
+        *pp = pr->next;
+        client->pending_count--;
     }
     pthread_mutex_unlock(&client->pending_mutex);
-    return NULL;
+    return pr;
 }
 
 /* ============================================================================
  * Handler lookup
  * ============================================================================ */
 
+static size_t handler_bucket(const char *method)
+{
+    return json_rpc_hash_string(method) & (JSON_RPC_HANDLER_BUCKETS - 1);
+}
+
 static request_handler_entry_t *find_request_handler(json_rpc_client_t *client, const char *method)
 {
     pthread_mutex_lock(&client->handlers_mutex);
-    request_handler_entry_t *entry = client->request_handlers;
-    while (entry) {
-        if (strcmp(entry->method, method) == 0) {
-            pthread_mutex_unlock(&client->handlers_mutex);
-            return entry;
-        }
+    request_handler_entry_t *entry = client->request_handlers[handler_bucket(method)];
+    while (entry && strcmp(entry->method, method) != 0) {
         entry = entry->next;
     }
     pthread_mutex_unlock(&client->handlers_mutex);
-    return NULL;
+    return entry;
 }
 
 static notification_handler_entry_t *find_notification_handler(
     json_rpc_client_t *client, const char *method)
 {
     pthread_mutex_lock(&client->handlers_mutex);
-    notification_handler_entry_t *entry = client->notification_handlers;
-    while (entry) {
-        if (strcmp(entry->method, method) == 0) {
-            pthread_mutex_unlock(&client->handlers_mutex);
-            return entry;
-        }
+    notification_handler_entry_t *entry = client->notification_handlers[handler_bucket(method)];
+    while (entry && strcmp(entry->method, method) != 0) {
         entry = entry->next;
     }
     pthread_mutex_unlock(&client->handlers_mutex);
-    return NULL;
+    return entry;
+}
+
+/* ============================================================================
+ * Async completion queue
+ * ============================================================================ */
+
+/**
+ * Make the completion fd readable. Safe from any thread.
+ */
+static void signal_completion_fd(json_rpc_client_t *client)
+{
+#ifndef _WIN32
+    if (client->completion_fd < 0) return;
+#ifdef __linux__
+    uint64_t one = 1;
+    ssize_t n = write(client->completion_fd, &one, sizeof(one));
+#else
+    char one = 1;
+    ssize_t n = write(client->completion_wake_fd, &one, 1);
+#endif
+    (void)n;  /* EAGAIN means it is already readable */
+#else
+    (void)client;
+#endif
+}
+
+/**
+ * Reset the completion fd to non-readable.
+ */
+static void drain_completion_fd(json_rpc_client_t *client)
+{
+#ifndef _WIN32
+    if (client->completion_fd < 0) return;
+    char buf[64];
+    while (read(client->completion_fd, buf, sizeof(buf)) > 0) {
+    }
+#else
+    (void)client;
+#endif
+}
+
+/**
+ * Queue a finished async request for json_rpc_client_process().
+ */
+static void enqueue_completion(json_rpc_client_t *client, pending_request_t *pr)
+{
+    if (!pr->on_complete) {
+        /* Detached request: nobody wants the outcome */
+        pending_request_free(pr);
+        return;
+    }
+
+    pthread_mutex_lock(&client->completion_mutex);
+    pr->next = NULL;
+    if (client->completion_tail) {
+        client->completion_tail->next = pr;
+    } else {
+        client->completion_head = pr;
+    }
+    client->completion_tail = pr;
+    pthread_mutex_unlock(&client->completion_mutex);
+
+    signal_completion_fd(client);
+}
+
+static void open_completion_fd(json_rpc_client_t *client)
+{
+    client->completion_fd = -1;
+    client->completion_wake_fd = -1;
+#if defined(__linux__)
+    client->completion_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#elif !defined(_WIN32)
+    int fds[2];
+    if (pipe(fds) == 0) {
+        for (int i = 0; i < 2; i++) {
+            fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+            fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+        }
+        client->completion_fd = fds[0];
+        client->completion_wake_fd = fds[1];
+    }
+#endif
+}
+
+static void close_completion_fd(json_rpc_client_t *client)
+{
+#ifndef _WIN32
+    if (client->completion_fd >= 0) close(client->completion_fd);
+    if (client->completion_wake_fd >= 0) close(client->completion_wake_fd);
+#endif
+    client->completion_fd = -1;
+    client->completion_wake_fd = -1;
 }
 
 /* ============================================================================
@@ -232,18 +547,23 @@ static void handle_response(json_rpc_client_t *client, cJSON *message)
     cJSON *id_item = cJSON_GetObjectItem(message, "id");
     if (!id_item) return;
 
-    const char *id_str;
-    char id_buf[32];
+    /* We only ever send decimal IDs, so anything else cannot match */
+    unsigned long id;
     if (cJSON_IsString(id_item)) {
-        id_str = id_item->valuestring;
+        const char *str = id_item->valuestring;
+        char *end = NULL;
+        if (!str || *str < '0' || *str > '9') return;
+        errno = 0;
+        id = strtoul(str, &end, 10);
+        if (errno != 0 || *end != '\0') return;
     } else if (cJSON_IsNumber(id_item)) {
-        snprintf(id_buf, sizeof(id_buf), "%d", id_item->valueint);
-        id_str = id_buf;
+        if (id_item->valuedouble < 0) return;
+        id = (unsigned long)id_item->valuedouble;
     } else {
         return;
     }
 
-    pending_request_t *pr = find_pending_by_id(client, id_str);
+    pending_request_t *pr = take_pending_by_id(client, id);
     if (!pr) return;
 
     pthread_mutex_lock(&pr->mutex);
@@ -256,125 +576,239 @@ static void handle_response(json_rpc_client_t *client, cJSON *message)
         pr->error_message = msg && cJSON_IsString(msg) ? strdup(msg->valuestring) : strdup("Unknown error");
         pr->result = NULL;
     } else {
-        cJSON *result = cJSON_GetObjectItem(message, "result");
-        pr->result = result ? cJSON_Duplicate(result, 1) : cJSON_CreateObject();
+        /* Take the result subtree (a heap copy when parsed into the message
+         * arena); the reader deletes the rest of the message */
+        cJSON *result = client->arena ? cJSON_Duplicate(cJSON_GetObjectItem(message, "result"), 1)
+                                      : cJSON_DetachItemFromObject(message, "result");
+        pr->result = result ? result : cJSON_CreateObject();
         pr->error_code = 0;
         pr->error_message = NULL;
     }
 
+    /* Runs before any later message is read, and before the caller wakes */
+    bool async = pr->async;
+    cJSON *hook_result = pr->error_code == 0 ? pr->result : NULL;
+    if (pr->on_response && !async) {
+        pr->on_response(hook_result, pr->on_response_data);
+    }
+
+    /* A synchronous waiter may free 'pr' as soon as the mutex is released */
     pr->completed = true;
     pthread_cond_signal(&pr->cond);
     pthread_mutex_unlock(&pr->mutex);
+
+    if (async) {
+        /* Nobody waits on 'pr': run the hook unlocked so it may send requests */
+        if (pr->on_response) {
+            pr->on_response(hook_result, pr->on_response_data);
+        }
+        enqueue_completion(client, pr);
+    }
+}
+
+/**
+ * Send a JSON-RPC error response for the given request ID.
+ */
+static void send_error_response(json_rpc_client_t *client, cJSON *id_item,
+                                int code, const char *message)
+{
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddStringToObject(response, "jsonrpc", "2.0");
+    cJSON_AddItemToObject(response, "id", cJSON_Duplicate(id_item, 1));
+
+    cJSON *error = cJSON_CreateObject();
+    cJSON_AddNumberToObject(error, "code", code);
+    cJSON_AddStringToObject(error, "message", message);
+    cJSON_AddItemToObject(response, "error", error);
+
+    send_message(client, response);
+    cJSON_Delete(response);
 }
 
-static void handle_server_request(json_rpc_client_t *client, cJSON *message)
+/**
+ * Run the registered handler for a server request and send its response.
+ * Called from a worker thread, or from the reader thread when no pool is configured.
+ */
+static void process_server_call(json_rpc_client_t *client, cJSON *message)
 {
     cJSON *method_item = cJSON_GetObjectItem(message, "method");
     cJSON *id_item = cJSON_GetObjectItem(message, "id");
     cJSON *params_item = cJSON_GetObjectItem(message, "params");
+    const char *method = method_item->valuestring;
 
-    if (!method_item || !cJSON_IsString(method_item)) return;
+    /* Look for registered request handler */
+    request_handler_entry_t *entry = find_request_handler(client, method);
 
-    const char *method = method_item->valuestring;
-    bool is_call = (id_item != NULL && !cJSON_IsNull(id_item));
+    if (!entry || !entry->handler) {
+        char msg[256];
+        snprintf(msg, sizeof(msg), "Method not found: %s", method);
+        send_error_response(client, id_item, -32601, msg);
+        return;
+    }
 
-    if (is_call) {
-        /* Server request: look for registered request handler */
-        request_handler_entry_t *entry = find_request_handler(client, method);
+    int err_code = 0;
+    char *err_msg = NULL;
+    cJSON *result = entry->handler(method, params_item, entry->user_data,
+                                   &err_code, &err_msg);
+    if (err_code != 0) {
+        send_error_response(client, id_item, err_code, err_msg ? err_msg : "Handler error");
+        free(err_msg);
+        if (result) cJSON_Delete(result);
+        return;
+    }
 
-        cJSON *response = cJSON_CreateObject();
-        cJSON_AddStringToObject(response, "jsonrpc", "2.0");
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddStringToObject(response, "jsonrpc", "2.0");
 
-        /* Copy the ID */
-        cJSON_AddItemToObject(response, "id", cJSON_Duplicate(id_item, 1));
+    /* Copy the ID */
+    cJSON_AddItemToObject(response, "id", cJSON_Duplicate(id_item, 1));
+    cJSON_AddItemToObject(response, "result", result ? result : cJSON_CreateObject());
 
-        if (entry && entry->handler) {
-            int err_code = 0;
-            char *err_msg = NULL;
-            cJSON *result = entry->handler(method, params_item, entry->user_data,
-                                           &err_code, &err_msg);
-            if (err_code != 0) {
-                cJSON *error = cJSON_CreateObject();
-                cJSON_AddNumberToObject(error, "code", err_code);
-                cJSON_AddStringToObject(error, "message", err_msg ? err_msg : "Handler error");
-                cJSON_AddItemToObject(response, "error", error);
-                free(err_msg);
-                if (result) cJSON_Delete(result);
-            } else {
-                cJSON_AddItemToObject(response, "result",
-                                      result ? result : cJSON_CreateObject());
-            }
-        } else {
-            cJSON *error = cJSON_CreateObject();
-            cJSON_AddNumberToObject(error, "code", -32601);
-            char msg[256];
-            snprintf(msg, sizeof(msg), "Method not found: %s", method);
-            cJSON_AddStringToObject(error, "message", msg);
-            cJSON_AddItemToObject(response, "error", error);
+    send_message(client, response);
+    cJSON_Delete(response);
+}
+
+/**
+ * Queue a server request for the worker pool.
+ * Returns 0 if the message was queued (ownership transferred), -1 if the queue is full.
+ */
+static int enqueue_server_call(json_rpc_client_t *client, cJSON *message)
+{
+    server_request_item_t *item = calloc(1, sizeof(server_request_item_t));
+    if (!item) return -1;
+    item->message = message;
+
+    pthread_mutex_lock(&client->queue_mutex);
+    if (client->queue_length >= client->queue_capacity) {
+        pthread_mutex_unlock(&client->queue_mutex);
+        free(item);
+        return -1;
+    }
+    if (client->queue_tail) {
+        client->queue_tail->next = item;
+    } else {
+        client->queue_head = item;
+    }
+    client->queue_tail = item;
+    client->queue_length++;
+    pthread_cond_signal(&client->queue_cond);
+    pthread_mutex_unlock(&client->queue_mutex);
+    return 0;
+}
+
+/**
+ * Dispatch a server request or notification.
+ * Returns true if ownership of the message was transferred to the worker pool.
+ */
+static bool handle_server_request(json_rpc_client_t *client, cJSON *message)
+{
+    cJSON *method_item = cJSON_GetObjectItem(message, "method");
+    cJSON *id_item = cJSON_GetObjectItem(message, "id");
+    cJSON *params_item = cJSON_GetObjectItem(message, "params");
+
+    if (!method_item || !cJSON_IsString(method_item)) return false;
+
+    const char *method = method_item->valuestring;
+    bool is_call = (id_item != NULL && !cJSON_IsNull(id_item));
+
+    if (is_call) {
+        /* Server request: hand off to the worker pool so slow handlers
+         * do not stall event delivery and RPC responses */
+        if (client->workers_started == 0) {
+            process_server_call(client, message);
+            return false;
         }
 
-        send_message(client, response);
-        cJSON_Delete(response);
+        /* Workers get a heap copy, never memory from the message arena */
+        cJSON *queued = client->arena ? cJSON_Duplicate(message, 1) : message;
+        if (queued && enqueue_server_call(client, queued) == 0) {
+            return queued == message;
+        }
+        if (queued != message) cJSON_Delete(queued);
+        send_error_response(client, id_item, -32000, "Server request queue full");
     } else {
-        /* Server notification */
+        /* Server notification: dispatched in order on the reader thread */
         notification_handler_entry_t *entry = find_notification_handler(client, method);
         if (entry && entry->handler) {
             entry->handler(method, params_item, entry->user_data);
         }
     }
+    return false;
 }
 
 /* ============================================================================
- * Reader thread
+ * Worker threads
  * ============================================================================ */
 
-static void *reader_thread_fn(void *arg)
+static void *worker_thread_fn(void *arg)
 {
     json_rpc_client_t *client = (json_rpc_client_t *)arg;
-    char line_buf[1024];
 
-    while (!client->stopping) {
-        /* Read headers to find Content-Length */
-        int content_length = 0;
-
-        while (1) {
-            int n = read_line(client->read_fd, line_buf, sizeof(line_buf));
-            if (n <= 0) {
-                /* EOF or error */
-                goto done;
-            }
+    while (1) {
+        pthread_mutex_lock(&client->queue_mutex);
+        while (!client->queue_head && !client->workers_stopping) {
+            pthread_cond_wait(&client->queue_cond, &client->queue_mutex);
+        }
+        if (client->workers_stopping) {
+            pthread_mutex_unlock(&client->queue_mutex);
+            break;
+        }
+        server_request_item_t *item = client->queue_head;
+        client->queue_head = item->next;
+        if (!client->queue_head) client->queue_tail = NULL;
+        client->queue_length--;
+        pthread_mutex_unlock(&client->queue_mutex);
+
+        process_server_call(client, item->message);
+        cJSON_Delete(item->message);
+        free(item);
+    }
 
-            /* End of headers: blank line */
-            if (strcmp(line_buf, "\r\n") == 0 || strcmp(line_buf, "\n") == 0) {
-                break;
-            }
+    return NULL;
+}
 
-            /* Parse Content-Length */
-            int len;
-            if (sscanf(line_buf, "Content-Length: %d", &len) == 1) {
-                content_length = len;
-            }
-        }
+static void stop_workers(json_rpc_client_t *client)
+{
+    pthread_mutex_lock(&client->queue_mutex);
+    client->workers_stopping = true;
+    pthread_cond_broadcast(&client->queue_cond);
+    pthread_mutex_unlock(&client->queue_mutex);
 
-        if (content_length <= 0) {
-            continue;
-        }
+    for (size_t i = 0; i < client->workers_started; i++) {
+        pthread_join(client->workers[i], NULL);
+    }
+    client->workers_started = 0;
+    free(client->workers);
+    client->workers = NULL;
+
+    /* Drop requests that never started */
+    server_request_item_t *item = client->queue_head;
+    while (item) {
+        server_request_item_t *next = item->next;
+        cJSON_Delete(item->message);
+        free(item);
+        item = next;
+    }
+    client->queue_head = NULL;
+    client->queue_tail = NULL;
+    client->queue_length = 0;
+}
 
-        /* Read message body */
-        char *body = malloc((size_t)content_length + 1);
-        if (!body) {
-            goto done;
-        }
+/* ============================================================================
+ * Reader thread
+ * ============================================================================ */
 
-        if (read_exact(client->read_fd, body, (size_t)content_length) != 0) {
-            free(body);
+static void *reader_thread_fn(void *arg)
+{
+    json_rpc_client_t *client = (json_rpc_client_t *)arg;
+
+    while (!client->stopping) {
+        cJSON *message = NULL;
+        int rc = read_message(client, &message);
+        if (rc < 0) {
+            /* EOF or error */
             goto done;
         }
-        body[content_length] = '\0';
-
-        /* Parse JSON */
-        cJSON *message = cJSON_Parse(body);
-        free(body);
         if (!message) {
             continue;
         }
@@ -385,7 +819,9 @@ static void *reader_thread_fn(void *arg)
 
         if (method && cJSON_IsString(method)) {
             /* Server request or notification */
-            handle_server_request(client, message);
+            if (handle_server_request(client, message)) {
+                continue;  /* Ownership transferred to the worker pool */
+            }
         } else if (id) {
             /* Response to a pending request */
             handle_response(client, message);
@@ -397,24 +833,94 @@ static void *reader_thread_fn(void *arg)
 done:
     client->reader_running = false;
     /* Wake up any pending requests */
+    pending_request_t *closed_async = NULL;
     pthread_mutex_lock(&client->pending_mutex);
-    pending_request_t *pr = client->pending_requests;
-    while (pr) {
-        pthread_mutex_lock(&pr->mutex);
-        if (!pr->completed) {
-            pr->completed = true;
-            pr->error_code = -32000;
-            pr->error_message = strdup("Connection closed");
-            pthread_cond_signal(&pr->cond);
+    for (size_t i = 0; i < client->pending_slot_count; i++) {
+        pending_request_t **pp = &client->pending_slots[i];
+        while (*pp) {
+            pending_request_t *pr = *pp;
+            pthread_mutex_lock(&pr->mutex);
+            if (!pr->completed) {
+                pr->completed = true;
+                pr->error_code = -32000;
+                pr->error_message = strdup("Connection closed");
+                pthread_cond_signal(&pr->cond);
+            }
+            pthread_mutex_unlock(&pr->mutex);
+
+            if (pr->async) {
+                /* Nobody waits on these; hand them to the completion queue */
+                *pp = pr->next;
+                client->pending_count--;
+                pr->next = closed_async;
+                closed_async = pr;
+            } else {
+                pp = &pr->next;
+            }
         }
-        pthread_mutex_unlock(&pr->mutex);
-        pr = pr->next;
     }
     pthread_mutex_unlock(&client->pending_mutex);
 
+    while (closed_async) {
+        pending_request_t *next = closed_async->next;
+        if (closed_async->on_response) {
+            closed_async->on_response(NULL, closed_async->on_response_data);
+        }
+        enqueue_completion(client, closed_async);
+        closed_async = next;
+    }
+
     return NULL;
 }
 
+/* ============================================================================
+ * Request submission
+ * ============================================================================ */
+
+/**
+ * Register 'pr' and send it as a 'method' request. Takes ownership of params.
+ * On failure the caller unregisters and frees 'pr'.
+ */
+static int send_request(json_rpc_client_t *client, pending_request_t *pr,
+                        const char *method, cJSON *params)
+{
+    char id_str[32];
+    snprintf(id_str, sizeof(id_str), "%lu", pr->id);
+
+    add_pending(client, pr);
+
+    /* Build JSON-RPC request */
+    cJSON *request = cJSON_CreateObject();
+    cJSON_AddStringToObject(request, "jsonrpc", "2.0");
+    cJSON_AddStringToObject(request, "id", id_str);
+    cJSON_AddStringToObject(request, "method", method);
+    cJSON_AddItemToObject(request, "params", params ? params : cJSON_CreateObject());
+
+    /* Send (deleting the request also frees params) */
+    int rc = send_message(client, request);
+    cJSON_Delete(request);
+    return rc;
+}
+
+/**
+ * Tell the server we no longer want the response to request 'id', so it can
+ * stop working on it. Servers that do not know $/cancelRequest ignore it.
+ */
+static void send_cancel_notification(json_rpc_client_t *client, unsigned long id)
+{
+    char id_str[32];
+    snprintf(id_str, sizeof(id_str), "%lu", id);
+
+    cJSON *notification = cJSON_CreateObject();
+    cJSON_AddStringToObject(notification, "jsonrpc", "2.0");
+    cJSON_AddStringToObject(notification, "method", "$/cancelRequest");
+    cJSON *params = cJSON_AddObjectToObject(notification, "params");
+    cJSON_AddStringToObject(params, "id", id_str);
+
+    send_message(client, notification);
+    cJSON_Delete(notification);
+}
+
 /* ============================================================================
  * Public API
  * ============================================================================ */
@@ -428,35 +934,110 @@ json_rpc_client_t *json_rpc_client_create(int write_fd, int read_fd)
     client->read_fd = read_fd;
     client->reader_running = false;
     client->stopping = false;
-    client->pending_requests = NULL;
-    client->request_handlers = NULL;
-    client->notification_handlers = NULL;
-    client->next_id = 1;
+    client->pending_slots = calloc(JSON_RPC_PENDING_INITIAL_SLOTS, sizeof(pending_request_t *));
+    if (!client->pending_slots) {
+        free(client);
+        return NULL;
+    }
+    client->pending_slot_count = JSON_RPC_PENDING_INITIAL_SLOTS;
+    client->pending_count = 0;
+    atomic_init(&client->next_id, 1);
+    client->worker_count = JSON_RPC_DEFAULT_WORKER_THREADS;
+    client->queue_capacity = JSON_RPC_DEFAULT_QUEUE_CAPACITY;
 
     pthread_mutex_init(&client->write_mutex, NULL);
     pthread_mutex_init(&client->pending_mutex, NULL);
     pthread_mutex_init(&client->handlers_mutex, NULL);
-    pthread_mutex_init(&client->id_mutex, NULL);
+    pthread_mutex_init(&client->queue_mutex, NULL);
+    pthread_cond_init(&client->queue_cond, NULL);
+    pthread_mutex_init(&client->completion_mutex, NULL);
+    open_completion_fd(client);
 
     return client;
 }
 
+void json_rpc_client_set_worker_pool(
+    json_rpc_client_t *client,
+    size_t worker_count,
+    size_t queue_capacity)
+{
+    if (!client || client->reader_running) return;
+
+    client->worker_count = worker_count;
+    client->queue_capacity = queue_capacity > 0 ? queue_capacity
+                                                : JSON_RPC_DEFAULT_QUEUE_CAPACITY;
+}
+
+int json_rpc_client_set_message_arena(json_rpc_client_t *client, size_t block_size)
+{
+    if (!client || client->reader_running) return -1;
+
+    json_arena_destroy(client->arena);
+    client->arena = NULL;
+    if (block_size == 0) return 0;
+
+    client->arena = json_arena_create(block_size);
+    return client->arena ? 0 : -1;
+}
+
 int json_rpc_client_start(json_rpc_client_t *client)
 {
     if (!client || client->reader_running) return -1;
 
     client->reader_running = true;
     client->stopping = false;
+    client->workers_stopping = false;
+
+    /* Start workers before the reader so no request is handled inline */
+    if (client->worker_count > 0) {
+        client->workers = calloc(client->worker_count, sizeof(pthread_t));
+        if (!client->workers) {
+            client->reader_running = false;
+            return -1;
+        }
+        for (size_t i = 0; i < client->worker_count; i++) {
+            if (pthread_create(&client->workers[i], NULL, worker_thread_fn, client) != 0) {
+                break;
+            }
+            client->workers_started++;
+        }
+        if (client->workers_started == 0) {
+            free(client->workers);
+            client->workers = NULL;
+            client->reader_running = false;
+            return -1;
+        }
+    }
 
     int rc = pthread_create(&client->reader_thread, NULL, reader_thread_fn, client);
     if (rc != 0) {
+        stop_workers(client);
         client->reader_running = false;
         return -1;
     }
+    client->reader_joinable = true;
 
     return 0;
 }
 
+void json_rpc_client_close_write(json_rpc_client_t *client)
+{
+    if (!client) return;
+
+    /* Under write_mutex, so no frame is mid-write and no later send_message()
+     * can reach the closed (or reused) descriptor */
+    pthread_mutex_lock(&client->write_mutex);
+    if (client->write_fd >= 0) {
+#ifdef _WIN32
+        _close(client->write_fd);
+#else
+        close(client->write_fd);
+#endif
+        client->write_fd = -1;
+    }
+    pthread_mutex_unlock(&client->write_mutex);
+}
+
 void json_rpc_client_stop(json_rpc_client_t *client)
 {
     if (!client) return;
@@ -473,10 +1054,15 @@ void json_rpc_client_stop(json_rpc_client_t *client)
         client->read_fd = -1;
     }
 
-    if (client->reader_running) {
+    /* Join even if the reader already exited on EOF */
+    if (client->reader_joinable) {
         pthread_join(client->reader_thread, NULL);
+        client->reader_joinable = false;
         client->reader_running = false;
     }
+
+    /* Reader is gone, so nothing else is enqueued */
+    stop_workers(client);
 }
 
 void json_rpc_client_free(json_rpc_client_t *client)
@@ -484,36 +1070,54 @@ void json_rpc_client_free(json_rpc_client_t *client)
     if (!client) return;
 
     /* Free pending requests */
-    pending_request_t *pr = client->pending_requests;
-    while (pr) {
-        pending_request_t *next = pr->next;
-        pending_request_free(pr);
-        pr = next;
-    }
-
-    /* Free request handlers */
-    request_handler_entry_t *rh = client->request_handlers;
-    while (rh) {
-        request_handler_entry_t *next = rh->next;
-        free(rh->method);
-        free(rh);
-        rh = next;
+    for (size_t i = 0; i < client->pending_slot_count; i++) {
+        pending_request_t *pr = client->pending_slots[i];
+        while (pr) {
+            pending_request_t *next = pr->next;
+            pending_request_free(pr);
+            pr = next;
+        }
     }
+    free(client->pending_slots);
+
+    for (size_t i = 0; i < JSON_RPC_HANDLER_BUCKETS; i++) {
+        /* Free request handlers */
+        request_handler_entry_t *rh = client->request_handlers[i];
+        while (rh) {
+            request_handler_entry_t *next = rh->next;
+            free(rh->method);
+            free(rh);
+            rh = next;
+        }
 
-    /* Free notification handlers */
-    notification_handler_entry_t *nh = client->notification_handlers;
-    while (nh) {
-        notification_handler_entry_t *next = nh->next;
-        free(nh->method);
-        free(nh);
-        nh = next;
+        /* Free notification handlers */
+        notification_handler_entry_t *nh = client->notification_handlers[i];
+        while (nh) {
+            notification_handler_entry_t *next = nh->next;
+            free(nh->method);
+            free(nh);
+            nh = next;
+        }
     }
 
     pthread_mutex_destroy(&client->write_mutex);
     pthread_mutex_destroy(&client->pending_mutex);
     pthread_mutex_destroy(&client->handlers_mutex);
-    pthread_mutex_destroy(&client->id_mutex);
+    pthread_mutex_destroy(&client->queue_mutex);
+    pthread_cond_destroy(&client->queue_cond);
+
+    /* Completions nobody processed */
+    pending_request_t *done = client->completion_head;
+    while (done) {
+        pending_request_t *next = done->next;
+        pending_request_free(done);
+        done = next;
+    }
+    pthread_mutex_destroy(&client->completion_mutex);
+    close_completion_fd(client);
 
+    free(client->rbuf);
+    json_arena_destroy(client->arena);
     free(client);
 }
 
@@ -527,39 +1131,52 @@ cJSON *json_rpc_client_request(
 {
     if (!client || !method) return NULL;
 
+    return json_rpc_client_request_owned(client, method,
+                                         params ? cJSON_Duplicate(params, 1) : NULL,
+                                         timeout_ms, out_error_code, out_error_message);
+}
+
+cJSON *json_rpc_client_request_owned(
+    json_rpc_client_t *client,
+    const char *method,
+    cJSON *params,
+    int timeout_ms,
+    int *out_error_code,
+    char **out_error_message)
+{
+    return json_rpc_client_request_with_hook(client, method, params, timeout_ms,
+                                             NULL, NULL, out_error_code, out_error_message);
+}
+
+cJSON *json_rpc_client_request_with_hook(
+    json_rpc_client_t *client,
+    const char *method,
+    cJSON *params,
+    int timeout_ms,
+    json_rpc_response_hook_fn on_response,
+    void *on_response_data,
+    int *out_error_code,
+    char **out_error_message)
+{
+    if (!client || !method) {
+        cJSON_Delete(params);
+        return NULL;
+    }
+
     if (timeout_ms <= 0) {
         timeout_ms = 30000;
     }
 
-    /* Generate request ID */
-    char *id = generate_request_id(client);
-    if (!id) return NULL;
-
     /* Create pending request */
-    pending_request_t *pr = pending_request_create(id);
+    pending_request_t *pr = pending_request_create(generate_request_id(client));
     if (!pr) {
-        free(id);
+        cJSON_Delete(params);
         return NULL;
     }
-    add_pending(client, pr);
-
-    /* Build JSON-RPC request */
-    cJSON *request = cJSON_CreateObject();
-    cJSON_AddStringToObject(request, "jsonrpc", "2.0");
-    cJSON_AddStringToObject(request, "id", id);
-    cJSON_AddStringToObject(request, "method", method);
-    if (params) {
-        cJSON_AddItemToObject(request, "params", cJSON_Duplicate(params, 1));
-    } else {
-        cJSON_AddItemToObject(request, "params", cJSON_CreateObject());
-    }
-
-    /* Send */
-    int rc = send_message(client, request);
-    cJSON_Delete(request);
-    free(id);
+    pr->on_response = on_response;
+    pr->on_response_data = on_response_data;
 
-    if (rc != 0) {
+    if (send_request(client, pr, method, params) != 0) {
         remove_pending(client, pr);
         pending_request_free(pr);
         if (out_error_code) *out_error_code = -32000;
@@ -569,31 +1186,26 @@ cJSON *json_rpc_client_request(
 
     /* Wait for response with timeout */
     struct timespec ts;
-#ifdef _WIN32
-    struct timespec now;
-    timespec_get(&now, TIME_UTC);
-    ts.tv_sec = now.tv_sec + timeout_ms / 1000;
-    ts.tv_nsec = now.tv_nsec + (timeout_ms % 1000) * 1000000L;
-#else
-    clock_gettime(CLOCK_REALTIME, &ts);
-    ts.tv_sec += timeout_ms / 1000;
-    ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
-#endif
-    if (ts.tv_nsec >= 1000000000L) {
-        ts.tv_sec += 1;
-        ts.tv_nsec -= 1000000000L;
-    }
+    json_rpc_deadline_after_ms(timeout_ms, &ts);
 
     pthread_mutex_lock(&pr->mutex);
     while (!pr->completed) {
         int wait_rc = pthread_cond_timedwait(&pr->cond, &pr->mutex, &ts);
         if (wait_rc == ETIMEDOUT) {
             pthread_mutex_unlock(&pr->mutex);
-            remove_pending(client, pr);
-            pending_request_free(pr);
-            if (out_error_code) *out_error_code = -32000;
-            if (out_error_message) *out_error_message = strdup("Request timed out");
-            return NULL;
+            if (remove_pending(client, pr)) {
+                send_cancel_notification(client, pr->id);
+                pending_request_free(pr);
+                if (out_error_code) *out_error_code = -32000;
+                if (out_error_message) *out_error_message = strdup("Request timed out");
+                return NULL;
+            }
+            /* The reader already took it and is delivering the response */
+            pthread_mutex_lock(&pr->mutex);
+            while (!pr->completed) {
+                pthread_cond_wait(&pr->cond, &pr->mutex);
+            }
+            break;
         }
     }
 
@@ -650,7 +1262,8 @@ void json_rpc_client_set_request_handler(
     pthread_mutex_lock(&client->handlers_mutex);
 
     /* Check if handler already exists for this method */
-    request_handler_entry_t *entry = client->request_handlers;
+    size_t bucket = handler_bucket(method);
+    request_handler_entry_t *entry = client->request_handlers[bucket];
     while (entry) {
         if (strcmp(entry->method, method) == 0) {
             if (handler) {
@@ -682,8 +1295,8 @@ void json_rpc_client_set_request_handler(
     entry->method = strdup(method);
     entry->handler = handler;
     entry->user_data = user_data;
-    entry->next = client->request_handlers;
-    client->request_handlers = entry;
+    entry->next = client->request_handlers[bucket];
+    client->request_handlers[bucket] = entry;
 
     pthread_mutex_unlock(&client->handlers_mutex);
 }
@@ -699,7 +1312,8 @@ void json_rpc_client_set_notification_handler(
     pthread_mutex_lock(&client->handlers_mutex);
 
     /* Check if handler already exists for this method */
-    notification_handler_entry_t *entry = client->notification_handlers;
+    size_t bucket = handler_bucket(method);
+    notification_handler_entry_t *entry = client->notification_handlers[bucket];
     while (entry) {
         if (strcmp(entry->method, method) == 0) {
             if (handler) {
@@ -729,8 +1343,138 @@ void json_rpc_client_set_notification_handler(
     entry->method = strdup(method);
     entry->handler = handler;
     entry->user_data = user_data;
-    entry->next = client->notification_handlers;
-    client->notification_handlers = entry;
+    entry->next = client->notification_handlers[bucket];
+    client->notification_handlers[bucket] = entry;
 
     pthread_mutex_unlock(&client->handlers_mutex);
 }
+
+/**
+ * Shared by json_rpc_client_request_async() and the _detached() variants; a
+ * NULL 'on_complete' drops the outcome instead of queueing it.
+ */
+static pending_request_t *submit_async(
+    json_rpc_client_t *client,
+    const char *method,
+    cJSON *params,
+    json_rpc_completion_fn on_complete,
+    void *user_data,
+    json_rpc_response_hook_fn on_response,
+    void *on_response_data)
+{
+    if (!client || !method || client->stopping) {
+        cJSON_Delete(params);
+        return NULL;
+    }
+
+    pending_request_t *pr = pending_request_create(generate_request_id(client));
+    if (!pr) {
+        cJSON_Delete(params);
+        return NULL;
+    }
+    pr->async = true;
+    pr->on_complete = on_complete;
+    pr->on_complete_data = user_data;
+    pr->on_response = on_response;
+    pr->on_response_data = on_response_data;
+
+    if (send_request(client, pr, method, params) != 0) {
+        if (!remove_pending(client, pr)) {
+            /* The reader already failed it as part of shutting down */
+            return pr;
+        }
+        pending_request_free(pr);
+        return NULL;
+    }
+    return pr;
+}
+
+pending_request_t *json_rpc_client_request_async(
+    json_rpc_client_t *client,
+    const char *method,
+    cJSON *params,
+    json_rpc_completion_fn on_complete,
+    void *user_data)
+{
+    if (!on_complete) {
+        cJSON_Delete(params);
+        return NULL;
+    }
+    return submit_async(client, method, params, on_complete, user_data, NULL, NULL);
+}
+
+int json_rpc_client_request_detached(
+    json_rpc_client_t *client,
+    const char *method,
+    cJSON *params)
+{
+    return submit_async(client, method, params, NULL, NULL, NULL, NULL) ? 0 : -1;
+}
+
+int json_rpc_client_request_detached_with_hook(
+    json_rpc_client_t *client,
+    const char *method,
+    cJSON *params,
+    json_rpc_response_hook_fn on_response,
+    void *on_response_data)
+{
+    return submit_async(client, method, params, NULL, NULL,
+                        on_response, on_response_data) ? 0 : -1;
+}
+
+int json_rpc_client_cancel(json_rpc_client_t *client, pending_request_t *call)
+{
+    if (!client || !call || !call->async) return -1;
+
+    /* Fails if the response (or connection loss) is already being delivered */
+    if (!remove_pending(client, call)) return -1;
+
+    send_cancel_notification(client, call->id);
+
+    pthread_mutex_lock(&call->mutex);
+    call->completed = true;
+    call->error_code = JSON_RPC_REQUEST_CANCELLED;
+    call->error_message = strdup("Request cancelled");
+    pthread_mutex_unlock(&call->mutex);
+
+    enqueue_completion(client, call);
+    return 0;
+}
+
+void json_rpc_call_free(pending_request_t *call)
+{
+    pending_request_free(call);
+}
+
+int json_rpc_client_get_fd(const json_rpc_client_t *client)
+{
+    return client ? client->completion_fd : -1;
+}
+
+void json_rpc_client_wake(json_rpc_client_t *client)
+{
+    if (client) signal_completion_fd(client);
+}
+
+size_t json_rpc_client_process(json_rpc_client_t *client)
+{
+    if (!client) return 0;
+
+    drain_completion_fd(client);
+
+    pthread_mutex_lock(&client->completion_mutex);
+    pending_request_t *pr = client->completion_head;
+    client->completion_head = NULL;
+    client->completion_tail = NULL;
+    pthread_mutex_unlock(&client->completion_mutex);
+
+    size_t count = 0;
+    while (pr) {
+        pending_request_t *next = pr->next;
+        pr->next = NULL;
+        pr->on_complete(pr, pr->on_complete_data);
+        pr = next;
+        count++;
+    }
+    return count;
+}
@@ -9,9 +9,13 @@
  * This module implements the JSON-RPC 2.0 protocol used to communicate with the
  * Copilot CLI server. It handles:
  *   - Content-Length header framing for message delimiting
+ *   - Buffered chunked reads, with bodies parsed in place from the read buffer
+ *   - Optional per-message arena for the parsed cJSON trees
  *   - Sending requests and receiving responses with correlation by ID
  *   - Receiving server-initiated notifications and requests
  *   - Background reader thread for incoming messages
+ *   - Worker pool with a bounded queue for server-initiated requests
+ *   - Non-blocking requests completed through a pollable fd
  *   - Thread-safe request/response matching
  */
 
@@ -20,9 +24,13 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
 #include <pthread.h>
 #include <cjson/cJSON.h>
 
+#include "json_arena.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -52,12 +60,63 @@ typedef void (*json_rpc_notification_handler_fn)(
     void *user_data
 );
 
+/* ============================================================================
+ * Hash tables
+ * ============================================================================ */
+
+/** Initial number of pending request slots (power of two). */
+#define JSON_RPC_PENDING_INITIAL_SLOTS 64
+
+/** Number of buckets in each method handler table (power of two). */
+#define JSON_RPC_HANDLER_BUCKETS 32
+
+/**
+ * FNV-1a hash of a NUL-terminated string, used for method and session tables.
+ */
+static inline uint32_t json_rpc_hash_string(const char *str)
+{
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)str; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
 /* ============================================================================
  * Pending request tracking
  * ============================================================================ */
 
+/**
+ * Callback run on the reader thread when the response arrives, before the
+ * requesting thread is woken and before any later message is handled: with
+ * the result on success, or NULL on an error response. For
+ * json_rpc_client_request_detached_with_hook() it also runs with NULL if the
+ * connection closes first. Must not block. 'result' remains owned by the request.
+ */
+typedef void (*json_rpc_response_hook_fn)(cJSON *result, void *user_data);
+
+struct pending_request;
+
+/**
+ * Completion callback for json_rpc_client_request_async(). Runs on the thread
+ * calling json_rpc_client_process() and takes ownership of 'call'
+ * (release with json_rpc_call_free()).
+ */
+typedef void (*json_rpc_completion_fn)(struct pending_request *call, void *user_data);
+
+/*
+ * Request IDs come from a sequential counter, so pending requests live in a
+ * power-of-two slot array indexed by (id & mask). Each slot chains the rare
+ * requests that share it once more than slot_count requests are in flight.
+ */
 typedef struct pending_request {
-    char *id;
+    unsigned long id;
+    bool async;              /**< Completed through the completion queue, not a waiter */
+    json_rpc_completion_fn on_complete;
+    void *on_complete_data;
+    json_rpc_response_hook_fn on_response;  /**< Optional, see json_rpc_client_request_with_hook() */
+    void *on_response_data;
     cJSON *result;           /**< Set when response arrives */
     int error_code;          /**< Non-zero if error response */
     char *error_message;     /**< Error message from response */
@@ -89,6 +148,34 @@ typedef struct notification_handler_entry {
     struct notification_handler_entry *next;
 } notification_handler_entry_t;
 
+/* ============================================================================
+ * Server request queue
+ * ============================================================================ */
+
+/** Default number of worker threads for server-initiated requests. */
+#define JSON_RPC_DEFAULT_WORKER_THREADS 4
+
+/** Default capacity of the server request queue. */
+#define JSON_RPC_DEFAULT_QUEUE_CAPACITY 64
+
+typedef struct server_request_item {
+    cJSON *message;          /**< Full request message (owned) */
+    struct server_request_item *next;
+} server_request_item_t;
+
+/* ============================================================================
+ * Input buffering
+ * ============================================================================ */
+
+/** Bytes requested per read() call; also the initial read buffer size. */
+#define JSON_RPC_READ_CHUNK 8192
+
+/** Upper bound on a header block without a newline before the stream is treated as corrupt. */
+#define JSON_RPC_MAX_HEADER_SIZE 8192
+
+/** Upper bound on a single message body. */
+#define JSON_RPC_MAX_MESSAGE_SIZE (256L * 1024L * 1024L)
+
 /* ============================================================================
  * JSON-RPC Client
  * ============================================================================ */
@@ -98,25 +185,56 @@ struct json_rpc_client {
     int write_fd;            /**< Write end (to CLI stdin) */
     int read_fd;             /**< Read end (from CLI stdout) */
 
+    /* Read buffer: bytes [rbuf_start, rbuf_end) are unread.
+     * Only touched by the reader thread. */
+    char *rbuf;
+    size_t rbuf_cap;
+    size_t rbuf_start;
+    size_t rbuf_end;
+
+    /* Arena for parsing inbound messages, or NULL to use the heap */
+    json_arena_t *arena;
+
     /* Reader thread */
     pthread_t reader_thread;
     bool reader_running;
+    bool reader_joinable;    /**< Set until the reader thread has been joined */
 
     /* Synchronization */
     pthread_mutex_t write_mutex;       /**< Protects write_fd writes */
-    pthread_mutex_t pending_mutex;     /**< Protects pending_requests list */
-    pthread_mutex_t handlers_mutex;    /**< Protects handler lists */
+    pthread_mutex_t pending_mutex;     /**< Protects pending request slots */
+    pthread_mutex_t handlers_mutex;    /**< Protects handler tables */
 
-    /* Pending requests awaiting responses */
-    pending_request_t *pending_requests;
+    /* Pending requests awaiting responses, indexed by (id & (slot_count - 1)) */
+    pending_request_t **pending_slots;
+    size_t pending_slot_count;
+    size_t pending_count;
 
-    /* Registered handlers */
-    request_handler_entry_t *request_handlers;
-    notification_handler_entry_t *notification_handlers;
+    /* Registered handlers, bucketed by json_rpc_hash_string(method) */
+    request_handler_entry_t *request_handlers[JSON_RPC_HANDLER_BUCKETS];
+    notification_handler_entry_t *notification_handlers[JSON_RPC_HANDLER_BUCKETS];
 
     /* ID counter */
-    unsigned long next_id;
-    pthread_mutex_t id_mutex;
+    atomic_ulong next_id;
+
+    /* Server request worker pool (worker_count == 0: handle on reader thread) */
+    pthread_t *workers;
+    size_t worker_count;
+    size_t workers_started;
+    size_t queue_capacity;
+    size_t queue_length;
+    server_request_item_t *queue_head;
+    server_request_item_t *queue_tail;
+    pthread_mutex_t queue_mutex;
+    pthread_cond_t queue_cond;
+    bool workers_stopping;
+
+    /* Completed async requests awaiting json_rpc_client_process() */
+    pending_request_t *completion_head;
+    pending_request_t *completion_tail;
+    pthread_mutex_t completion_mutex;
+    int completion_fd;       /**< Readable while completions are queued (-1 if unsupported) */
+    int completion_wake_fd;  /**< Write end when completion_fd is a pipe, else -1 */
 
     /* Stop signal */
     volatile bool stopping;
@@ -132,14 +250,52 @@ struct json_rpc_client {
 json_rpc_client_t *json_rpc_client_create(int write_fd, int read_fd);
 
 /**
- * Starts the background reader thread.
+ * Configures the worker pool used for server-initiated requests
+ * (tool.call, permission.request, userInput.request, hooks.invoke).
+ * Must be called before json_rpc_client_start().
+ *
+ * Notifications are always dispatched on the reader thread so their ordering
+ * is preserved. Requests that arrive while the queue is full are answered with
+ * an error instead of blocking the reader.
+ *
+ * @param worker_count    Number of worker threads (0 = run handlers on the reader thread).
+ * @param queue_capacity  Maximum number of queued requests (0 = default).
+ */
+void json_rpc_client_set_worker_pool(
+    json_rpc_client_t *client,
+    size_t worker_count,
+    size_t queue_capacity
+);
+
+/**
+ * Parses inbound messages into a per-message arena with blocks of
+ * 'block_size' bytes (0 = parse onto the heap). Must be called before
+ * json_rpc_client_start(), after json_arena_install_hooks().
+ *
+ * @return 0 on success, -1 if the arena could not be created.
+ */
+int json_rpc_client_set_message_arena(
+    json_rpc_client_t *client,
+    size_t block_size
+);
+
+/**
+ * Starts the background reader thread and the request worker pool.
  *
  * @return 0 on success, -1 on failure.
  */
 int json_rpc_client_start(json_rpc_client_t *client);
 
 /**
- * Stops the client and waits for the reader thread to finish.
+ * Closes the write fd under the write lock. Later sends, including responses
+ * from the reader or workers, fail with -1 instead of writing to it.
+ * The client owns write_fd from here on; the caller must not close it again.
+ */
+void json_rpc_client_close_write(json_rpc_client_t *client);
+
+/**
+ * Stops the client and waits for the reader thread and workers to finish.
+ * Queued server requests that have not started are dropped.
  */
 void json_rpc_client_stop(json_rpc_client_t *client);
 
@@ -168,6 +324,36 @@ cJSON *json_rpc_client_request(
     char **out_error_message
 );
 
+/**
+ * Same as json_rpc_client_request(), but takes ownership of params so the
+ * tree is sent without being copied. params is freed on every path.
+ */
+cJSON *json_rpc_client_request_owned(
+    json_rpc_client_t *client,
+    const char *method,
+    cJSON *params,
+    int timeout_ms,
+    int *out_error_code,
+    char **out_error_message
+);
+
+/**
+ * Same as json_rpc_client_request_owned(), and additionally runs on_response
+ * on the reader thread when a successful response arrives. Use it to record
+ * state that must be in place before notifications following the response
+ * are dispatched.
+ */
+cJSON *json_rpc_client_request_with_hook(
+    json_rpc_client_t *client,
+    const char *method,
+    cJSON *params,
+    int timeout_ms,
+    json_rpc_response_hook_fn on_response,
+    void *on_response_data,
+    int *out_error_code,
+    char **out_error_message
+);
+
 /**
  * Sends a JSON-RPC notification (no response expected).
  *
@@ -202,6 +388,107 @@ void json_rpc_client_set_notification_handler(
     void *user_data
 );
 
+/* ============================================================================
+ * Deadlines
+ * ============================================================================ */
+
+/**
+ * Initializes a condition variable whose timed waits take deadlines from
+ * json_rpc_deadline_after_ms(). Uses CLOCK_MONOTONIC where the platform
+ * allows it, so wall-clock steps neither cut waits short nor stretch them.
+ */
+void json_rpc_cond_init(pthread_cond_t *cond);
+
+/**
+ * Computes the absolute deadline 'timeout_ms' from now, on the clock of
+ * conditions created with json_rpc_cond_init().
+ */
+void json_rpc_deadline_after_ms(int timeout_ms, struct timespec *ts);
+
+/* ============================================================================
+ * Non-blocking requests
+ * ============================================================================ */
+
+/** Error code of a call cancelled with json_rpc_client_cancel() (as in LSP). */
+#define JSON_RPC_REQUEST_CANCELLED (-32800)
+
+/**
+ * Sends a request without waiting. When the response arrives (or the
+ * connection closes) the call is queued, the completion fd becomes readable,
+ * and the next json_rpc_client_process() invokes on_complete with it.
+ * Inspect call->result / call->error_code / call->error_message there.
+ *
+ * @param params  The parameters (ownership transferred), or NULL.
+ * @return The in-flight call, or NULL if it could not be sent.
+ */
+pending_request_t *json_rpc_client_request_async(
+    json_rpc_client_t *client,
+    const char *method,
+    cJSON *params,
+    json_rpc_completion_fn on_complete,
+    void *user_data
+);
+
+/**
+ * Sends a request whose response is discarded, for fire-and-forget calls
+ * such as session.abort.
+ *
+ * @param params  The parameters (ownership transferred), or NULL.
+ * @return 0 if the request was sent.
+ */
+int json_rpc_client_request_detached(
+    json_rpc_client_t *client,
+    const char *method,
+    cJSON *params
+);
+
+/**
+ * Same as json_rpc_client_request_detached(), with on_response run on the
+ * reader thread once the outcome is known (see json_rpc_response_hook_fn).
+ * It may run before this function returns, and may itself send requests.
+ *
+ * @return 0 if the request was sent; on -1 on_response is never run.
+ */
+int json_rpc_client_request_detached_with_hook(
+    json_rpc_client_t *client,
+    const char *method,
+    cJSON *params,
+    json_rpc_response_hook_fn on_response,
+    void *on_response_data
+);
+
+/**
+ * Cancels an in-flight async call: sends $/cancelRequest to the server and
+ * completes the call locally with JSON_RPC_REQUEST_CANCELLED, so its
+ * on_complete runs on the next json_rpc_client_process().
+ *
+ * @return 0 if cancelled, -1 if the call already completed.
+ */
+int json_rpc_client_cancel(json_rpc_client_t *client, pending_request_t *call);
+
+/**
+ * Frees a completed call handed to a json_rpc_completion_fn.
+ */
+void json_rpc_call_free(pending_request_t *call);
+
+/**
+ * Returns the completion fd for select/poll/epoll, or -1 if unsupported.
+ */
+int json_rpc_client_get_fd(const json_rpc_client_t *client);
+
+/**
+ * Makes the completion fd readable so an event loop calls process().
+ */
+void json_rpc_client_wake(json_rpc_client_t *client);
+
+/**
+ * Runs callbacks for every queued completion on the calling thread and
+ * resets the completion fd. Never blocks.
+ *
+ * @return Number of callbacks run.
+ */
+size_t json_rpc_client_process(json_rpc_client_t *client);
+
 #ifdef __cplusplus
 }
 #endif
@@ -13,9 +13,11 @@
  * Currently this module provides:
  *   - Session event type string constants
  *   - Helper functions for working with session events
+ *   - Lazy accessors for session event fields
  */
 
 #include "copilot/copilot.h"
+#include "session_event.h"
 #include <string.h>
 #include <stdlib.h>
 
@@ -86,3 +88,52 @@ bool copilot_session_event_is_delta(const copilot_session_event_t *event)
 {
     return copilot_session_event_is_type(event, COPILOT_EVENT_ASSISTANT_MESSAGE_DELTA);
 }
+
+/* ============================================================================
+ * Session event accessors
+ * ============================================================================ */
+
+const char *copilot_session_event_raw_json(const copilot_session_event_t *event)
+{
+    if (!event || !event->source || !event->source->event) return NULL;
+
+    copilot_session_event_source_t *src = event->source;
+    if (!src->raw_json) {
+        src->raw_json = cJSON_PrintUnformatted(src->event);
+    }
+    return src->raw_json;
+}
+
+const char *copilot_session_event_get_string(const copilot_session_event_t *event,
+                                             const char *field)
+{
+    if (!event || !event->source || !event->source->data || !field) return NULL;
+
+    cJSON *item = cJSON_GetObjectItem(event->source->data, field);
+    return item && cJSON_IsString(item) ? item->valuestring : NULL;
+}
+
+const char *copilot_session_event_content(const copilot_session_event_t *event)
+{
+    return copilot_session_event_get_string(event, "content");
+}
+
+const char *copilot_session_event_message(const copilot_session_event_t *event)
+{
+    return copilot_session_event_get_string(event, "message");
+}
+
+const char *copilot_session_event_delta_content(const copilot_session_event_t *event)
+{
+    return copilot_session_event_get_string(event, "deltaContent");
+}
+
+const char *copilot_session_event_tool_name(const copilot_session_event_t *event)
+{
+    return copilot_session_event_get_string(event, "toolName");
+}
+
+const char *copilot_session_event_tool_call_id(const copilot_session_event_t *event)
+{
+    return copilot_session_event_get_string(event, "toolCallId");
+}
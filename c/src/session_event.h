@@ -0,0 +1,33 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Microsoft Corporation. All rights reserved.
+ *--------------------------------------------------------------------------------------------*/
+
+/**
+ * @file session_event.h
+ * @brief Internal backing store for copilot_session_event_t views.
+ *
+ * The dispatcher points each event at one of these for the duration of the
+ * callbacks; the accessors in session.c resolve fields from it on demand.
+ */
+
+#ifndef COPILOT_SESSION_EVENT_H
+#define COPILOT_SESSION_EVENT_H
+
+#include "copilot/copilot.h"
+#include <cjson/cJSON.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct copilot_session_event_source {
+    cJSON *event;            /**< The "event" object (borrowed from the notification) */
+    cJSON *data;             /**< Its "data" object, or NULL */
+    char *raw_json;          /**< Printed on first request, freed by the dispatcher */
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COPILOT_SESSION_EVENT_H */
@@ -59,7 +59,7 @@ int main() {
                 },
                 "required": ["city"]
             })"),
-            [](const nlohmann::json& args, const copilot::ToolInvocation& inv)
+            [](const nlohmann::json& args, const copilot::ToolInvocation& /*inv*/)
                 -> copilot::ToolResultObject {
                 std::string city = args.value("city", "unknown");
                 std::string unit = args.value("unit", "celsius");
@@ -84,7 +84,7 @@ int main() {
             -> copilot::PermissionRequestResult {
             std::cout << "[Permission] " << req.kind << " requested for session "
                       << sessionId << " -> approved" << std::endl;
-            return {"approved"};
+            return {"approved", std::nullopt};
         };
 
         // Create a session
@@ -110,10 +110,9 @@ int main() {
 
         // Send a message and wait for the response
         std::cout << "\nSending message..." << std::endl;
-        auto response = session->sendAndWait(
-            copilot::MessageOptions{.prompt = "What is the weather in Tokyo?"},
-            120000  // 2 minute timeout
-        );
+        copilot::MessageOptions message;
+        message.prompt = "What is the weather in Tokyo?";
+        auto response = session->sendAndWait(message, 120000);  // 2 minute timeout
 
         if (response) {
             std::cout << "\nFinal response received." << std::endl;
@@ -0,0 +1,99 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Microsoft Corporation. All rights reserved.
+ *--------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "copilot/result.h"
+#include "copilot/types.h"
+
+namespace copilot {
+
+/// Admission controller shared by all sessions of a CopilotClient.
+///
+/// Bounds the number of turns in flight and rate-limits sends per tag with
+/// token buckets. Sends that cannot be admitted block in acquire(); whenever a
+/// slot or token frees up, higher priority classes are served first and tags
+/// within a class round-robin. A class whose oldest waiter has waited past
+/// the starvation bound is served ahead of the others.
+///
+/// Thread-safe: all public methods can be called from any thread.
+class AdmissionController {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// A granted in-flight slot. Pass it back to release() when the turn ends.
+    struct Ticket {
+        uint64_t id = 0;
+        uint64_t generation = 0;
+        std::string tag;
+        Priority priority = Priority::Normal;
+        Clock::time_point admittedAt;
+    };
+
+    AdmissionController(const AdmissionOptions& options, int starvationMs);
+
+    /// Blocks until a turn for 'tag' may be sent.
+    /// @throws std::runtime_error if maxQueueWaitMs elapses or reset() is called first.
+    Ticket acquire(const std::string& tag, Priority priority = Priority::Normal);
+
+    /// acquire() without exceptions: a queue timeout or reset() comes back as
+    /// an RpcError of kind Timeout or Stopped.
+    Result<Ticket> tryAcquire(const std::string& tag, Priority priority = Priority::Normal);
+
+    /// Returns a ticket's slot. 'completed' is false when the send itself failed,
+    /// in which case no server time is recorded.
+    void release(const Ticket& ticket, bool completed);
+
+    /// Fails every waiting acquire() and forgets all in-flight turns.
+    /// Tickets granted before the reset are ignored by release().
+    void reset();
+
+    /// Snapshot of the admission counters.
+    AdmissionStats stats() const;
+
+private:
+    struct Waiter {
+        bool admitted = false;
+        Clock::time_point enqueuedAt;
+    };
+
+    struct TagState {
+        TagRateLimit limit;
+        double tokens = 0;
+        Clock::time_point lastRefill;
+        std::array<std::deque<Waiter*>, kPriorityCount> waiters;  // Per priority class
+        TagAdmissionStats stats;
+    };
+
+    TagState& tagState(const std::string& tag);
+    void refill(TagState& state, Clock::time_point now);
+    std::array<size_t, kPriorityCount> serviceOrder(Clock::time_point now) const;
+    bool admitOne(size_t cls, Clock::time_point now);
+    bool schedule(Clock::time_point now);
+    void removeWaiter(const std::string& tag, size_t cls, Waiter* waiter);
+
+    AdmissionOptions options_;
+    Clock::duration starvationBound_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::map<std::string, TagState> tags_;
+    std::array<std::deque<std::string>, kPriorityCount> readyTags_;  // Round-robin order per class
+    std::array<TagAdmissionStats, kPriorityCount> priorityStats_;
+    size_t inFlight_ = 0;
+    uint64_t nextTicketId_ = 0;
+    uint64_t generation_ = 0;
+    Clock::time_point nextRefill_ = Clock::time_point::max();
+};
+
+} // namespace copilot
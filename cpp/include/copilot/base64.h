@@ -0,0 +1,87 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Microsoft Corporation. All rights reserved.
+ *--------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace copilot {
+
+/// Receives decoded bytes in order, one block at a time.
+using ByteSink = std::function<void(const uint8_t* data, size_t size)>;
+
+/// Sink writing to a file descriptor.
+/// @throws std::runtime_error if a write fails.
+ByteSink fdSink(int fd);
+
+/// Sink appending to a buffer. The buffer must outlive the sink.
+ByteSink bufferSink(std::vector<uint8_t>& out);
+
+/// A base64 string left in place in the buffer of a received message instead
+/// of being copied into the JSON DOM. Holding the span keeps the buffer alive.
+struct Base64Span {
+    std::shared_ptr<const std::vector<char>> buffer;
+    size_t offset = 0;
+    size_t size = 0;
+
+    bool empty() const { return size == 0; }
+
+    std::string_view view() const {
+        return buffer ? std::string_view(buffer->data() + offset, size) : std::string_view();
+    }
+};
+
+/// Streaming base64 decoder (standard alphabet, '=' padding).
+///
+/// Input may be split anywhere. Decoded bytes are buffered and handed to the
+/// sink in blocks of up to bufferSize. On x86 CPUs with SSSE3, full 16-char
+/// groups are decoded with SIMD; otherwise a table-driven scalar loop is used.
+class Base64Decoder {
+public:
+    explicit Base64Decoder(ByteSink sink, size_t bufferSize = 64 * 1024);
+
+    /// Decode the next chunk of base64 text.
+    /// @throws std::runtime_error on characters outside the alphabet or data after padding.
+    void feed(std::string_view text);
+
+    /// Flush buffered output.
+    /// @throws std::runtime_error if the input ended in the middle of a group.
+    void finish();
+
+    /// Bytes delivered to the sink so far.
+    uint64_t bytesWritten() const { return written_; }
+
+private:
+    void decodeGroups(const char* in, size_t groups);
+    void decodeFinalGroup(const char* group);
+    void flush();
+
+    ByteSink sink_;
+    std::vector<uint8_t> out_;
+    size_t outSize_ = 0;
+    size_t blockSize_;
+    char pending_[4] = {};
+    size_t pendingSize_ = 0;
+    bool padded_ = false;
+    uint64_t written_ = 0;
+};
+
+/// Decode a complete base64 string into 'sink'.
+/// @return Number of decoded bytes.
+/// @throws std::runtime_error on malformed input.
+size_t base64Decode(std::string_view text, const ByteSink& sink);
+
+/// Decoded size of a complete, padded base64 string.
+size_t base64DecodedSize(std::string_view text);
+
+/// Encode bytes as base64 with '=' padding.
+std::string base64Encode(const uint8_t* data, size_t size);
+
+} // namespace copilot
@@ -4,15 +4,23 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <future>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "copilot/admission.h"
+#include "copilot/disk_cache.h"
+#include "copilot/health.h"
 #include "copilot/json_rpc_client.h"
 #include "copilot/session.h"
+#include "copilot/supervisor.h"
 #include "copilot/types.h"
 
 namespace copilot {
@@ -52,6 +60,16 @@ public:
     /// Called automatically on first use if autoStart is true.
     void start();
 
+    /// Starts the CLI server on a background thread and returns at once, so
+    /// the application can initialize while the server spawns. The future
+    /// completes when the protocol version has been verified, or holds the
+    /// startup error. Calls made in the meantime wait for it rather than
+    /// starting again. While a start is in progress, the same future is returned.
+    std::shared_future<void> startAsync();
+
+    /// Phase timings of the most recent start.
+    StartupTimings startupTimings() const;
+
     /// Stops the CLI server and closes all active sessions.
     /// Returns a list of errors encountered during cleanup (empty = success).
     std::vector<std::string> stop();
@@ -78,7 +96,8 @@ public:
     /// Get current authentication status.
     GetAuthStatusResponse getAuthStatus();
 
-    /// List available models with their metadata (cached after first call).
+    /// List available models with their metadata (cached after first call,
+    /// and across processes with CopilotClientOptions::diskCachePath).
     std::vector<ModelInfo> listModels();
 
     /// Gets the ID of the most recently updated session.
@@ -102,15 +121,69 @@ public:
     /// Subscribe to a specific lifecycle event type. Returns unsubscribe function.
     std::function<void()> onLifecycle(const std::string& eventType, SessionLifecycleHandler handler);
 
+    /// Sends every prompt through a pool of up to 'concurrency' sessions created
+    /// from 'config' and blocks until each item has succeeded or used up its
+    /// attempts. Results are passed to 'onResult' as they complete; an exception
+    /// thrown by 'onResult' stops the batch and is rethrown here.
+    BatchSummary runBatch(const std::vector<MessageOptions>& prompts, const SessionConfig& config,
+                          size_t concurrency, BatchResultHandler onResult,
+                          const BatchOptions& options = {});
+
+    /// Admission control counters (all zero when admission control is disabled).
+    AdmissionStats admissionStats() const;
+
+    /// Outbound RPC latency per priority class for the current connection.
+    std::map<Priority, PriorityLatencyStats> rpcLatencyStats() const;
+
+    /// Subscribe to connection health changes (requires CopilotClientOptions::health).
+    /// Handlers run on the monitor thread. Returns unsubscribe function.
+    std::function<void()> onHealth(HealthHandler handler);
+
+    /// Ping latency and failure counters (all zero when health monitoring is disabled).
+    HealthStats healthStats() const;
+
+    /// Restart counters of the spawned CLI server.
+    RestartStats restartStats() const;
+
+    /// Memory and CPU usage of the spawned CLI process, and how the last one
+    /// exited. Usage is sampled on POSIX only.
+    ProcessStats processStats() const;
+
+    /// The most recent stderr output of the spawned CLI (see stderrBufferBytes).
+    std::string cliStderr() const;
+
 private:
     void ensureConnected();
+    void requireConnected();
+    void launchStart(std::function<void()> body);
+    void runStartup();
+    void joinStartup();
     void startCLIServer();
+    void startReplay();
     void connectToServer();
-    void verifyProtocolVersion();
+    void detachTransport();
+    void openTransport(int& readFd, int& writeFd);
+    static void verifyProtocolVersion(const PingResponse& response);
+    nlohmann::json cachedRequest(const std::string& method);
+    void revalidateDiskCache();
+    void stopDiskCache();
     void setupHandlers();
+    void handleHealthChange(const HealthEvent& event);
+    void handleConnectionClosed();
+    void handleProcessExit(const ProcessExit& exit);
+    void connectionLost(const std::string& reason);
+    bool canRestart() const;
+    bool isStopping() const;
+    void beginRecovery(const std::string& reason);
+    void recoverConnection(const std::string& reason);
+    void resumeSessions();
+    bool waitRestartBackoff(int ms);
+    void interruptRecovery();
+    void stopServerProcess(bool graceful);
+    void closeServerPipes();
 
     // Server request handlers
-    void handleSessionEvent(const nlohmann::json& params);
+    void handleSessionEvent(const nlohmann::json& params, const std::vector<Base64Span>& payloads);
     void handleSessionLifecycle(const nlohmann::json& params);
     std::pair<nlohmann::json, std::optional<JsonRpcError>> handleToolCall(const nlohmann::json& params);
     std::pair<nlohmann::json, std::optional<JsonRpcError>> handlePermissionRequest(const nlohmann::json& params);
@@ -127,9 +200,16 @@ private:
     nlohmann::json buildToolsJson(const std::vector<Tool>& tools);
 
     CopilotClientOptions options_;
-    ConnectionState state_ = ConnectionState::Disconnected;
+    std::atomic<ConnectionState> state_{ConnectionState::Disconnected};
     bool isExternalServer_ = false;
 
+    // Startup: startMutex_ guards the future and thread of the current start
+    std::mutex startMutex_;
+    std::shared_future<void> startFuture_;
+    std::thread startThread_;
+    mutable std::mutex timingsMutex_;
+    StartupTimings startupTimings_;
+
     // Process management
 #ifdef _WIN32
     void* processHandle_ = nullptr;   // HANDLE for Win32
@@ -141,9 +221,40 @@ private:
     int stdoutReadFd_ = -1;
 #endif
 
+    // Supervision of the spawned CLI (POSIX). processMutex_ guards
+    // supervisor_ and lastExit_; the stderr buffer outlives restarts.
+    std::shared_ptr<StderrBuffer> stderrBuffer_;
+    mutable std::mutex processMutex_;
+    std::unique_ptr<ProcessSupervisor> supervisor_;
+    std::optional<ProcessExit> lastExit_;
+
+    // Stands in for the CLI process when CopilotClientOptions::replay is set
+    std::unique_ptr<JournalReplayer> replayer_;
+
     // JSON-RPC client
     std::unique_ptr<JsonRpcClient> rpcClient_;
 
+    // Admission control for session.send (null when disabled)
+    std::unique_ptr<AdmissionController> admission_;
+
+    // Recovery after the CLI server exits or hangs. restartMutex_ guards the
+    // stats and stopping_, which cuts a restart backoff short.
+    std::atomic<bool> recovering_{false};
+    mutable std::mutex restartMutex_;
+    std::condition_variable restartCv_;
+    bool stopping_ = false;
+    RestartStats restartStats_;
+
+    // Connection health monitor (null when disabled)
+    std::unique_ptr<HealthMonitor> health_;
+    struct HealthEntry {
+        uint64_t id;
+        HealthHandler fn;
+    };
+    mutable std::mutex healthMutex_;
+    std::vector<HealthEntry> healthHandlers_;
+    uint64_t nextHealthId_ = 0;
+
     // Sessions
     mutable std::mutex sessionsMutex_;
     std::map<std::string, std::shared_ptr<CopilotSession>> sessions_;
@@ -152,6 +263,12 @@ private:
     mutable std::mutex modelsCacheMutex_;
     std::optional<std::vector<ModelInfo>> modelsCache_;
 
+    // Results persisted across processes (null when disabled). Cached status
+    // and session list are served until the background refresh completes.
+    std::unique_ptr<DiskCache> diskCache_;
+    std::thread revalidateThread_;
+    std::atomic<bool> diskCacheRevalidated_{false};
+
     // Lifecycle handlers
     struct LifecycleEntry {
         uint64_t id;
@@ -0,0 +1,59 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Microsoft Corporation. All rights reserved.
+ *--------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+namespace copilot {
+
+/// On-disk cache of RPC results that rarely change ("status.get",
+/// "models.list", "session.list"), so a new process can answer them before
+/// the CLI has responded.
+///
+/// The file holds one JSON document keyed by the SDK protocol version and the
+/// CLI version. A file written for another protocol version is ignored;
+/// entries recorded for another CLI version are dropped by setCliVersion().
+/// The file is memory-mapped on load and replaced atomically on save.
+///
+/// Thread-safe.
+class DiskCache {
+public:
+    explicit DiskCache(std::string path);
+
+    /// Load the cache file.
+    /// @return false if the file is missing, malformed, or for another protocol version.
+    bool load();
+
+    /// CLI version the entries were recorded for (empty until known).
+    std::string cliVersion() const;
+
+    /// Record the CLI version being talked to. Entries recorded for a
+    /// different version are dropped.
+    void setCliVersion(const std::string& version);
+
+    /// Cached result of 'method', if any.
+    std::optional<nlohmann::json> get(const std::string& method) const;
+
+    /// Store the result of 'method' and rewrite the file, unless the cached
+    /// result is already equal to it. Write errors are ignored; the in-memory
+    /// entry is still updated.
+    void put(const std::string& method, const nlohmann::json& result);
+
+private:
+    bool save();
+
+    std::string path_;
+    mutable std::mutex mutex_;
+    std::string cliVersion_;
+    std::map<std::string, nlohmann::json> entries_;
+};
+
+} // namespace copilot
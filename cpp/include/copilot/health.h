@@ -0,0 +1,76 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Microsoft Corporation. All rights reserved.
+ *--------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "copilot/types.h"
+
+namespace copilot {
+
+/// Connection health monitor of a CopilotClient.
+///
+/// A background thread checks the transport for stalls and pings the server
+/// every HealthOptions::intervalMs. When the connection turns unhealthy (a
+/// stall, or failureThreshold pings in a row failing or missing their
+/// deadline) or recovers, the change handler runs on the monitor thread.
+/// Ping latency is tracked as an EWMA and a histogram.
+///
+/// Thread-safe: all public methods can be called from any thread, and
+/// start() may be called from the change handler.
+class HealthMonitor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// Sends one ping that must complete within 'timeout'; throws on failure.
+    /// Returns false when there is no connection to probe.
+    using Probe = std::function<bool(std::chrono::milliseconds timeout)>;
+
+    /// Returns why the transport is stalled past 'bound', or an empty string.
+    using StallCheck = std::function<std::string(std::chrono::milliseconds bound)>;
+
+    HealthMonitor(const HealthOptions& options, Probe probe, StallCheck stallCheck,
+                  HealthHandler onChange, ThreadOptions threads = {});
+    ~HealthMonitor();
+
+    /// Start the monitor thread (no-op if it is running).
+    void start();
+
+    /// Stop and join the monitor thread. Must not be called from the change handler.
+    void stop();
+
+    /// Count a restart of the connection and start over with no failed pings.
+    /// The connection is reported healthy again once a ping succeeds.
+    void recordRestart();
+
+    /// Snapshot of the health counters.
+    HealthStats stats() const;
+
+private:
+    void run();
+    void check();
+    void recordLatency(double ms);
+    void recordFailure(const std::string& reason, bool immediate);
+    void report(bool healthy, const std::string& reason);
+
+    HealthOptions options_;
+    Probe probe_;
+    StallCheck stallCheck_;
+    HealthHandler onChange_;
+    ThreadOptions threads_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool running_ = false;
+    std::thread thread_;
+    HealthStats stats_;
+};
+
+} // namespace copilot
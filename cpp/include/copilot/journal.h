@@ -0,0 +1,206 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Microsoft Corporation. All rights reserved.
+ *--------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "copilot/types.h"
+
+namespace copilot {
+
+// ============================================================================
+// Journal Format
+// ============================================================================
+//
+// A journal is a little-endian, append-only file:
+//
+//   JournalFileHeader                         (32 bytes)
+//   { JournalRecordHeader, body, padding }*   (each record 8-byte aligned)
+//
+// Bodies are the JSON-RPC message bodies without Content-Length framing, so
+// a mapped journal can be walked in place without parsing.
+
+enum class JournalDirection : uint8_t {
+    Inbound = 0,   // CLI -> SDK
+    Outbound = 1   // SDK -> CLI
+};
+
+struct JournalFileHeader {
+    char magic[8];            // "CPJRNL\0\0"
+    uint32_t version;         // 1
+    uint32_t headerSize;      // sizeof(JournalFileHeader)
+    uint64_t startUnixNs;     // Wall-clock time of the first record's time base
+    uint64_t reserved;
+};
+
+struct JournalRecordHeader {
+    uint32_t size;            // Body size in bytes (excluding padding)
+    uint8_t direction;        // JournalDirection
+    uint8_t reserved[3];
+    uint64_t offsetNs;        // Monotonic time since the journal was opened
+};
+
+static_assert(sizeof(JournalFileHeader) == 32, "journal header layout");
+static_assert(sizeof(JournalRecordHeader) == 16, "journal record layout");
+
+/// One record of a journal opened with JournalReader. 'body' points into the
+/// reader's mapping and is valid while the reader is alive.
+struct JournalRecord {
+    JournalDirection direction = JournalDirection::Inbound;
+    std::chrono::nanoseconds offset{0};
+    std::string_view body;
+};
+
+// ============================================================================
+// JournalWriter
+// ============================================================================
+
+/// Appends frames to a journal file from a background thread.
+///
+/// append() copies the frame into an in-memory batch and returns; the writer
+/// thread swaps the batch out and writes it with a single fwrite().
+///
+/// Thread-safe: append() can be called from any thread.
+class JournalWriter {
+public:
+    /// Create (or truncate) the journal at 'path'.
+    /// @throws std::runtime_error if the file cannot be opened.
+    explicit JournalWriter(const std::string& path, const ThreadOptions& threads = {});
+
+    /// Flushes outstanding records and closes the file.
+    ~JournalWriter();
+
+    JournalWriter(const JournalWriter&) = delete;
+    JournalWriter& operator=(const JournalWriter&) = delete;
+
+    void append(JournalDirection direction, const char* data, size_t size);
+
+private:
+    void run();
+
+    std::FILE* file_;
+    std::chrono::steady_clock::time_point start_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<char> batch_;
+    bool closing_ = false;
+    std::thread thread_;
+};
+
+// ============================================================================
+// JournalReader
+// ============================================================================
+
+/// Read-only view of a journal file. Memory-maps the file on POSIX systems
+/// and reads it into memory elsewhere.
+class JournalReader {
+public:
+    /// @throws std::runtime_error if the file is missing or not a journal.
+    explicit JournalReader(const std::string& path);
+    ~JournalReader();
+
+    JournalReader(const JournalReader&) = delete;
+    JournalReader& operator=(const JournalReader&) = delete;
+
+    const JournalFileHeader& header() const;
+
+    /// Read the next record. Returns false at the end of the journal or at a
+    /// record truncated by an interrupted writer.
+    bool next(JournalRecord& record);
+
+    /// Start again from the first record.
+    void rewind();
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    size_t position_ = 0;
+    std::vector<char> buffer_;   // Used when the file is not mapped
+    bool mapped_ = false;
+};
+
+// ============================================================================
+// JournalReplayer
+// ============================================================================
+
+/// Plays the inbound side of a journal to a CopilotClient in place of the CLI.
+///
+/// Inbound frames are written to the client at their recorded offsets,
+/// divided by ReplayOptions::speed. A recorded response is held until the
+/// client sends the matching request (the same method, in the same order)
+/// and is rewritten to carry the new request ID. Requests with no recorded
+/// counterpart are answered with an empty result.
+///
+/// Used by CopilotClient when CopilotClientOptions::replay is set.
+class JournalReplayer {
+public:
+    /// @throws std::runtime_error if the journal cannot be read or the pipes cannot be created.
+    explicit JournalReplayer(const ReplayOptions& options, const ThreadOptions& threads = {});
+
+    /// Stops replaying and joins the replay threads. Call after the client
+    /// has closed its ends of the transport.
+    ~JournalReplayer();
+
+    JournalReplayer(const JournalReplayer&) = delete;
+    JournalReplayer& operator=(const JournalReplayer&) = delete;
+
+    /// Client end of the transport: the client reads from readFd() and writes to writeFd().
+    int readFd() const { return clientReadFd_; }
+    int writeFd() const { return clientWriteFd_; }
+
+    /// Stop feeding frames and close the feed pipe, so the client sees end of input.
+    void finish();
+
+private:
+    enum class Reply : uint8_t { Pending, Recorded, Synthetic };
+
+    struct RecordedRequest {
+        std::string method;
+        size_t ordinal;       // Index among recorded requests of the same method
+    };
+
+    /// Requests of one method: recorded in the journal and sent by the client.
+    struct MethodState {
+        size_t recorded = 0;
+        std::vector<std::string> liveIds;   // In the order the client sent them
+        std::vector<Reply> replies;         // By ordinal
+    };
+
+    void feedLoop();
+    void drainLoop();
+    void replySynthetic(const std::string& id);
+    void writeFrame(const std::string& body);
+
+    ReplayOptions options_;
+    JournalReader reader_;
+    std::map<std::string, RecordedRequest> recordedRequests_;   // By recorded request ID
+
+    int clientReadFd_ = -1;
+    int clientWriteFd_ = -1;
+    int feedFd_ = -1;      // Replayer -> client
+    int drainFd_ = -1;     // Client -> replayer
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::map<std::string, MethodState> methods_;
+    bool fed_ = false;       // Every inbound record has been played
+    bool stopping_ = false;
+    std::mutex writeMutex_;
+
+    std::thread feedThread_;
+    std::thread drainThread_;
+};
+
+} // namespace copilot
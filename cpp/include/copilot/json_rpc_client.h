@@ -4,18 +4,28 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <functional>
-#include <future>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include <nlohmann/json.hpp>
 
+#include "copilot/base64.h"
+#include "copilot/journal.h"
+#include "copilot/result.h"
+#include "copilot/types.h"
+#include "copilot/waiter.h"
+
 namespace copilot {
 
 /// JSON-RPC 2.0 error
@@ -30,6 +40,11 @@ struct JsonRpcError {
 using RequestHandler = std::function<std::pair<nlohmann::json, std::optional<JsonRpcError>>(
     const nlohmann::json& params)>;
 
+/// Request handler that also receives the base64 payloads kept out of
+/// 'params' (see JsonRpcClient::setPayloadExtraction()).
+using PayloadRequestHandler = std::function<std::pair<nlohmann::json, std::optional<JsonRpcError>>(
+    const nlohmann::json& params, const std::vector<Base64Span>& payloads)>;
+
 /// Minimal JSON-RPC 2.0 client for Content-Length framed stdio/pipe transport.
 ///
 /// The client reads messages from an input stream (stdout of the subprocess) and
@@ -41,12 +56,17 @@ using RequestHandler = std::function<std::pair<nlohmann::json, std::optional<Jso
 /// - Requests/Notifications (messages with "method") are dispatched to registered handlers.
 ///   Notifications (no "id") run synchronously on the reader thread.
 ///   Requests (with "id") run in a detached thread and responses are sent back.
+///
+/// Outbound messages are written one at a time in priority order: a queued
+/// Interactive message goes before Normal and Batch ones, and a lower class
+/// that has waited past the starvation bound goes before everything else.
 class JsonRpcClient {
 public:
     /// Construct a client operating on the given file descriptors.
     /// @param readFd  File descriptor to read from (server stdout).
     /// @param writeFd File descriptor to write to (server stdin).
-    JsonRpcClient(int readFd, int writeFd);
+    /// @param threads Setup of the reader and request handler threads.
+    JsonRpcClient(int readFd, int writeFd, ThreadOptions threads = {});
 
     ~JsonRpcClient();
 
@@ -59,23 +79,121 @@ public:
     /// Register a handler for incoming requests/notifications with the given method name.
     void setRequestHandler(const std::string& method, RequestHandler handler);
 
-    /// Send a JSON-RPC request and wait for the response.
-    /// @return The result field of the response, or throws std::runtime_error on error.
-    nlohmann::json request(const std::string& method, const nlohmann::json& params);
+    /// Register a handler that receives extracted payloads along with the params.
+    void setPayloadRequestHandler(const std::string& method, PayloadRequestHandler handler);
+
+    /// Keep "base64" string values of at least minSize characters out of the
+    /// JSON DOM of inbound messages. Each such value is replaced by
+    /// {"$payload": index} and handed to payload handlers as a Base64Span into
+    /// the received message buffer. Only requests for methods registered with
+    /// setPayloadRequestHandler() are affected; responses and other handlers
+    /// see the values inline. 0 (the default) disables extraction.
+    void setPayloadExtraction(size_t minSize);
+
+    /// Record every inbound and outbound frame body to 'journal'. Call before start().
+    void setJournal(std::shared_ptr<JournalWriter> journal);
+
+    /// Send a JSON-RPC request and wait for the response, for at most
+    /// 'timeout' when it is non-zero.
+    /// @return The result field of the response, or throws std::runtime_error on
+    ///         error or timeout.
+    nlohmann::json request(const std::string& method, const nlohmann::json& params,
+                           Priority priority = Priority::Normal,
+                           std::chrono::milliseconds timeout = std::chrono::milliseconds::zero());
+
+    /// request() without exceptions: a server error, timeout or lost
+    /// connection comes back as an RpcError. request() wraps this call.
+    Result<nlohmann::json> tryRequest(const std::string& method, const nlohmann::json& params,
+                                      Priority priority = Priority::Normal,
+                                      std::chrono::milliseconds timeout = std::chrono::milliseconds::zero());
 
     /// Send a JSON-RPC notification (no response expected).
-    void notify(const std::string& method, const nlohmann::json& params);
+    void notify(const std::string& method, const nlohmann::json& params,
+                Priority priority = Priority::Normal);
+
+    /// Set how long a queued message of a lower class may be passed over.
+    void setPriorityStarvationMs(int ms);
+
+    /// Snapshot of outbound latency per priority class.
+    std::map<Priority, PriorityLatencyStats> priorityStats() const;
+
+    /// Fail every request waiting for a response with 'reason' (an RpcError
+    /// of 'kind'), without stopping the client.
+    void failPending(const std::string& reason,
+                     RpcError::Kind kind = RpcError::Kind::ConnectionLost);
+
+    /// Called on the reader thread when the server closes the stream while
+    /// the client is running. Call before start().
+    void setCloseHandler(std::function<void()> handler);
+
+    /// Detach from a transport whose server has gone away and join the
+    /// reader. Written requests whose method 'isReplayable' accepts stay
+    /// pending for replay; other written requests fail. Requests made from
+    /// now on are held until releaseHeld(). Call once the server process is gone.
+    /// @return The number of requests that failed.
+    size_t suspend(const std::function<bool(const std::string& method)>& isReplayable);
+
+    /// Read from and write to a new transport after suspend(). Held requests
+    /// stay held; only recoveryRequest() goes through.
+    void reattach(int readFd, int writeFd);
+
+    /// A request that bypasses the hold, for restoring server state after reattach().
+    nlohmann::json recoveryRequest(const std::string& method, const nlohmann::json& params,
+                                   std::chrono::milliseconds timeout = std::chrono::milliseconds::zero());
+
+    /// End the hold: send the held requests and replay the ones kept by suspend().
+    /// @return The number of requests sent.
+    size_t releaseHeld();
+
+    /// Describes a write, or the read and parse of an inbound frame, that has
+    /// been running longer than 'bound'; empty if there is none. Time spent in
+    /// handlers is not counted.
+    std::string stallReason(std::chrono::milliseconds bound) const;
 
 private:
+    using Clock = std::chrono::steady_clock;
+
+    /// A request awaiting its response. Slots are pooled: the requester
+    /// takes one, and whoever removes it from pendingRequests_ (under
+    /// pendingMutex_) sets the outcome and signals 'done'.
     struct PendingRequest {
-        std::promise<nlohmann::json> promise;
+        nlohmann::json message;
+        Priority priority = Priority::Normal;
+        std::atomic<bool> written{false};   // Set under the write gate
+        OneShotWaiter done;
+        nlohmann::json result;
+        std::optional<RpcError> error;
+        std::atomic<int> refs{0};           // The requester, and releaseHeld() while it sends
+    };
+
+    struct WriteWaiter {
+        Clock::time_point enqueuedAt;
+        bool granted = false;
+    };
+
+    struct RequestHandlerEntry {
+        PayloadRequestHandler handler;
+        bool wantsPayloads = false;   // Registered with setPayloadRequestHandler()
     };
 
     void readLoop();
-    void handleIncoming(const nlohmann::json& msg);
+    void readMessages();
+    void handleIncoming(const nlohmann::json& msg, const std::vector<Base64Span>& payloads);
     void handleResponse(const nlohmann::json& msg);
-    void handleRequest(const nlohmann::json& msg);
-    void sendMessage(const nlohmann::json& msg);
+    void handleRequest(const nlohmann::json& msg, const std::vector<Base64Span>& payloads);
+    bool wantsPayloads(const nlohmann::json& msg);
+    bool acquireWrite(Priority priority, Clock::time_point deadline);
+    void releaseWrite();
+    PendingRequest* acquirePendingLocked();
+    void releasePending(PendingRequest* pending);
+    static void completeLocked(PendingRequest& pending, nlohmann::json result);
+    static void failLocked(PendingRequest& pending, RpcError error);
+    Result<nlohmann::json> requestImpl(const std::string& method, const nlohmann::json& params,
+                                       Priority priority, std::chrono::milliseconds timeout,
+                                       bool bypassHold);
+    Result<bool> sendMessage(const nlohmann::json& msg, Priority priority = Priority::Normal,
+                     Clock::time_point deadline = Clock::time_point::max(),
+                     std::atomic<bool>* written = nullptr, bool bypassHold = false);
     void sendResponse(const nlohmann::json& id, const nlohmann::json& result);
     void sendErrorResponse(const nlohmann::json& id, int code, const std::string& message);
 
@@ -84,15 +202,36 @@ private:
     int readFd_;
     int writeFd_;
     std::atomic<bool> running_{false};
+    ThreadOptions threads_;
     std::thread readerThread_;
+    std::function<void()> closeHandler_;
 
+    // Write gate: writeMutex_ guards writing_ and the per-class queues; the
+    // holder of the gate writes to writeFd_ without the mutex held.
     std::mutex writeMutex_;
+    std::condition_variable writeCv_;
+    bool writing_ = false;
+    bool held_ = false;   // Between suspend() and releaseHeld(); read under the gate
+    std::array<std::deque<WriteWaiter*>, kPriorityCount> writeQueues_;
+    Clock::duration starvationBound_ = std::chrono::milliseconds(500);
+
+    mutable std::mutex statsMutex_;
+    std::array<PriorityLatencyStats, kPriorityCount> latencyStats_;
 
+    // pendingMutex_ guards the pending map and the free slots
     std::mutex pendingMutex_;
-    std::map<std::string, std::shared_ptr<PendingRequest>> pendingRequests_;
+    std::map<std::string, PendingRequest*> pendingRequests_;
+    std::vector<std::unique_ptr<PendingRequest>> freePending_;
 
     std::mutex handlerMutex_;
-    std::map<std::string, RequestHandler> requestHandlers_;
+    std::map<std::string, RequestHandlerEntry> requestHandlers_;
+
+    // Start of the write / inbound frame read in progress (steady clock ticks, 0 = idle)
+    std::atomic<Clock::rep> writeStartedAt_{0};
+    std::atomic<Clock::rep> frameStartedAt_{0};
+
+    std::atomic<size_t> payloadThreshold_{0};
+    std::shared_ptr<JournalWriter> journal_;
 };
 
 } // namespace copilot
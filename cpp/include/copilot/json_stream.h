@@ -0,0 +1,114 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Microsoft Corporation. All rights reserved.
+ *--------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace copilot {
+
+/// Incremental JSON parser for responses streamed as assistant.message_delta
+/// chunks (e.g. with ResponseFormat::JsonObject).
+///
+/// Text is fed in arbitrary pieces. Every value is reported as soon as it
+/// closes, identified by its JSON Pointer ("/items/3/title"), so downstream
+/// work can start before the whole document has been generated.
+///
+/// Example:
+/// @code
+///   auto parser = std::make_shared<copilot::JsonStreamParser>();
+///   parser->onElement("/items", [](size_t index, const nlohmann::json& item) {
+///       process(item);
+///   });
+///   session->streamJson(parser);
+///   session->sendAndWait(options);
+/// @endcode
+///
+/// Not thread-safe: handlers run on the thread calling feed(). When fed by
+/// CopilotSession::streamJson() that is the event dispatch thread.
+class JsonStreamParser {
+public:
+    /// Called for every completed value below the root, with its JSON Pointer.
+    using ValueHandler = std::function<void(const std::string& pointer, const nlohmann::json& value)>;
+
+    /// Called for every completed element of a watched array.
+    using ElementHandler = std::function<void(size_t index, const nlohmann::json& value)>;
+
+    /// Called once the top-level value is complete.
+    using DocumentHandler = std::function<void(const nlohmann::json& document)>;
+
+    void onValue(ValueHandler handler);
+    void onElement(const std::string& arrayPointer, ElementHandler handler);
+    void onDocument(DocumentHandler handler);
+
+    /// Parse the next chunk of text.
+    /// @throws std::runtime_error on malformed input. The parser then stays
+    ///         failed and ignores further input until reset().
+    void feed(std::string_view chunk);
+
+    /// Mark the end of input, completing a trailing top-level number.
+    /// @throws std::runtime_error if the document is incomplete.
+    void finish();
+
+    /// Discard parse state to start a new document. Handlers are kept.
+    void reset();
+
+    /// True once the top-level value is complete.
+    bool done() const { return done_; }
+
+    bool failed() const { return !error_.empty(); }
+    const std::string& error() const { return error_; }
+
+    /// Characters consumed so far.
+    size_t offset() const { return offset_; }
+
+    /// The document so far: completed values nested in the containers that
+    /// are still open. Values still being parsed are left out.
+    nlohmann::json partial() const;
+
+private:
+    enum class Expect { Value, Key, Colon, CommaOrEnd, End };
+    enum class Lex { None, String, Escape, Literal };
+
+    struct Frame {
+        nlohmann::json value;
+        std::string pointer;
+        std::string key;        // Key of the member being parsed (objects)
+        Expect expect;
+        bool empty = true;      // No member/element seen yet
+    };
+
+    void consume(char c);
+    void structural(char c);
+    void openContainer(nlohmann::json container);
+    void closeContainer();
+    void completeString();
+    void completeLiteral();
+    void completeValue(nlohmann::json value);
+    std::string childPointer() const;
+    Expect& expect();
+    [[noreturn]] void fail(const std::string& message);
+
+    std::vector<ValueHandler> valueHandlers_;
+    std::map<std::string, std::vector<ElementHandler>> elementHandlers_;
+    std::vector<DocumentHandler> documentHandlers_;
+
+    std::vector<Frame> stack_;
+    Expect rootExpect_ = Expect::Value;
+    Lex lex_ = Lex::None;
+    std::string token_;
+    bool tokenIsKey_ = false;
+    nlohmann::json document_;
+    bool done_ = false;
+    std::string error_;
+    size_t offset_ = 0;
+};
+
+} // namespace copilot
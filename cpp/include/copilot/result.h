@@ -0,0 +1,71 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Microsoft Corporation. All rights reserved.
+ *--------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <variant>
+
+#include <nlohmann/json.hpp>
+
+namespace copilot {
+
+/// Why an RPC, or a turn waited for with trySendAndWait(), failed.
+struct RpcError {
+    enum class Kind {
+        Server,           // JSON-RPC error response; 'code' and 'data' are the server's
+        Timeout,          // No response, or no session.idle, before the deadline
+        ConnectionLost,   // The CLI server went away or a write to it failed
+        Stopped,          // The client was stopped
+        Session,          // A session.error event ended the turn
+    };
+
+    Kind kind = Kind::Server;
+    int code = 0;
+    std::string message;
+    nlohmann::json data;
+
+    /// The text the throwing API uses for its std::runtime_error.
+    std::string what() const {
+        switch (kind) {
+            case Kind::Server: return "JSON-RPC Error " + std::to_string(code) + ": " + message;
+            case Kind::Session: return "Session error: " + message;
+            default: return message;
+        }
+    }
+};
+
+/// Either a value or an RpcError, in the manner of std::expected. Failures
+/// are plain values, so checking one costs no exception.
+template <typename T>
+class Result {
+public:
+    Result(T value) : state_(std::in_place_index<0>, std::move(value)) {}
+    Result(RpcError error) : state_(std::in_place_index<1>, std::move(error)) {}
+
+    bool ok() const { return state_.index() == 0; }
+    explicit operator bool() const { return ok(); }
+
+    /// The value; throws std::runtime_error with error().what() on failure.
+    T& value() & {
+        if (!ok()) throw std::runtime_error(error().what());
+        return std::get<0>(state_);
+    }
+    T&& value() && { return std::move(value()); }
+
+    T& operator*() { return std::get<0>(state_); }
+    const T& operator*() const { return std::get<0>(state_); }
+    T* operator->() { return &std::get<0>(state_); }
+    const T* operator->() const { return &std::get<0>(state_); }
+
+    /// Only valid when !ok().
+    const RpcError& error() const { return std::get<1>(state_); }
+
+private:
+    std::variant<T, RpcError> state_;
+};
+
+} // namespace copilot
@@ -4,15 +4,20 @@
 
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
 #include <functional>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
 #include <vector>
 
+#include "copilot/admission.h"
 #include "copilot/json_rpc_client.h"
+#include "copilot/json_stream.h"
+#include "copilot/result.h"
 #include "copilot/types.h"
 
 namespace copilot {
@@ -34,6 +39,7 @@ public:
     std::string workspacePath() const;
 
     /// Sends a message to this session.
+    /// With admission control enabled, blocks until the turn is admitted.
     /// @return The message ID of the queued message.
     std::string send(const MessageOptions& options);
 
@@ -44,6 +50,16 @@ public:
     /// @throws std::runtime_error on timeout or session error.
     std::optional<SessionEvent> sendAndWait(const MessageOptions& options, int timeoutMs = 60000);
 
+    /// send() without exceptions: admission, server and connection failures
+    /// come back as an RpcError.
+    Result<std::string> trySend(const MessageOptions& options);
+
+    /// sendAndWait() without exceptions. A timeout is an RpcError of kind
+    /// Timeout; a session.error event one of kind Session, carrying the
+    /// event's message and data.
+    Result<std::optional<SessionEvent>> trySendAndWait(const MessageOptions& options,
+                                                       int timeoutMs = 60000);
+
     /// Subscribe to all events from this session.
     /// @return An ID that can be passed to off() to unsubscribe.
     uint64_t on(SessionEventHandler handler);
@@ -55,6 +71,13 @@ public:
     /// Unsubscribe a previously registered event handler.
     void off(uint64_t handlerId);
 
+    /// Feed the content of each assistant message to 'parser' as its
+    /// assistant.message_delta events arrive. The parser is reset when a new
+    /// message starts; messages that were not streamed are parsed whole when
+    /// their assistant.message event arrives.
+    /// @return An ID that can be passed to off() to stop feeding the parser.
+    uint64_t streamJson(std::shared_ptr<JsonStreamParser> parser);
+
     /// Get all events/messages from this session's history.
     std::vector<SessionEvent> getMessages();
 
@@ -96,11 +119,29 @@ public:
 private:
     friend class CopilotClient;
 
-    CopilotSession(const std::string& sessionId, JsonRpcClient* client, const std::string& workspacePath);
+    CopilotSession(const std::string& sessionId, JsonRpcClient* client, const std::string& workspacePath,
+                   AdmissionController* admission = nullptr, const std::string& tag = "",
+                   Priority priority = Priority::Normal);
+
+    /// Return the admission slots of this session's turns.
+    void releaseAdmissions(bool completed);
 
     JsonRpcClient* client_;
     std::string workspacePath_;
 
+    // session.resume params restoring this session after a CLI restart
+    nlohmann::json resumeParams_;
+
+    // A turn was sent and has not reported session.idle/session.error yet
+    std::atomic<bool> turnActive_{false};
+
+    // Admission control (owned by the client; null when disabled)
+    AdmissionController* admission_;
+    std::string tag_;
+    Priority priority_;
+    std::mutex admissionMutex_;
+    std::vector<AdmissionController::Ticket> admissionTickets_;
+
     // Event handlers
     struct HandlerEntry {
         uint64_t id;
@@ -0,0 +1,124 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Microsoft Corporation. All rights reserved.
+ *--------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "copilot/types.h"
+
+namespace copilot {
+
+/// Bounded buffer keeping the most recent bytes written to it.
+///
+/// Thread-safe: all public methods can be called from any thread.
+class StderrBuffer {
+public:
+    explicit StderrBuffer(size_t capacity);
+
+    void append(const char* data, size_t size);
+
+    /// The buffered bytes, oldest first.
+    std::string contents() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<char> ring_;
+    size_t start_ = 0;
+    size_t size_ = 0;
+};
+
+/// ProcessLimits resolved before fork, so the child only makes
+/// async-signal-safe calls to apply them (POSIX only).
+class LaunchLimits {
+public:
+    /// Throws std::runtime_error for a limit this platform cannot apply.
+    explicit LaunchLimits(const ProcessLimits& limits);
+
+    /// Apply to the calling process; run in the child between fork and exec.
+    /// Returns a message naming the limit that failed, or nullptr.
+    const char* apply() const;
+
+private:
+    std::optional<uint64_t> addressSpaceBytes_;
+    std::optional<uint64_t> openFiles_;
+    std::optional<int> nice_;
+    std::vector<int> cpuAffinity_;
+    std::string cgroupProcs_;
+};
+
+/// Watches a spawned CLI process on a background thread (POSIX only).
+///
+/// Exit is detected through a pidfd (Linux 5.3+) or, where pidfds are not
+/// available, a SIGCHLD handler that wakes every supervisor through its own
+/// pipe. The supervisor reaps the process, so nothing else may wait for it.
+/// Its stderr is drained into a StderrBuffer and an optional line sink, and
+/// memory and CPU usage are sampled from /proc (and from 'cgroup', a cgroup
+/// v2 directory, when not empty).
+///
+/// Thread-safe: all public methods can be called from any thread.
+class ProcessSupervisor {
+public:
+    using ExitHandler = std::function<void(const ProcessExit&)>;
+
+    /// Takes ownership of 'stderrFd'. 'onExit' runs on the supervisor thread
+    /// once the process has been reaped and its remaining stderr read.
+    ProcessSupervisor(int pid, int stderrFd, std::shared_ptr<StderrBuffer> buffer, StderrSink sink,
+                      int sampleIntervalMs, std::string cgroup, ExitHandler onExit,
+                      const ThreadOptions& threads = {});
+
+    /// Stops watching and joins the supervisor thread. Does not signal the process.
+    ~ProcessSupervisor();
+
+    ProcessSupervisor(const ProcessSupervisor&) = delete;
+    ProcessSupervisor& operator=(const ProcessSupervisor&) = delete;
+
+    /// Send 'sig' to the process. Returns false once it has been reaped, so a
+    /// recycled PID is never signalled.
+    bool signal(int sig);
+
+    /// Wait until the process has been reaped. Returns false on timeout.
+    bool waitForExit(std::chrono::milliseconds timeout);
+
+    /// Last usage sample, or the exit once the process has been reaped.
+    ProcessStats stats() const;
+
+private:
+    void run();
+    bool reap();
+    void drainStderr();
+    void emitLines(const char* data, size_t size);
+    void sample();
+    void sampleCgroup();
+
+    int pid_;
+    int pidfd_ = -1;
+    int stderrFd_;
+    int wakeFds_[2] = {-1, -1};
+    int watcherSlot_ = -1;      // SIGCHLD registration when pidfds are unavailable
+    std::shared_ptr<StderrBuffer> buffer_;
+    StderrSink sink_;
+    int sampleIntervalMs_;
+    std::string cgroup_;
+    ExitHandler onExit_;
+    std::string partialLine_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable exitCv_;
+    bool stopping_ = false;
+    std::optional<ProcessExit> exit_;
+    ProcessStats stats_;
+    std::thread thread_;
+};
+
+} // namespace copilot
@@ -0,0 +1,23 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Microsoft Corporation. All rights reserved.
+ *--------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <functional>
+#include <thread>
+
+#include "copilot/types.h"
+
+namespace copilot {
+
+/// Start an SDK thread named 'name' (at most 15 characters, the Linux limit)
+/// that applies 'options' and runs the start hook before 'body', and the
+/// exit hook after it.
+std::thread startThread(const ThreadOptions& options, const char* name, std::function<void()> body);
+
+/// Throws std::runtime_error for options this platform cannot apply, so a
+/// bad configuration fails when the client is constructed.
+void validateThreadOptions(const ThreadOptions& options);
+
+} // namespace copilot
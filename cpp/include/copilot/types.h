@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <array>
 #include <functional>
 #include <map>
 #include <optional>
@@ -12,6 +13,8 @@
 
 #include <nlohmann/json.hpp>
 
+#include "copilot/base64.h"
+
 namespace copilot {
 
 // ============================================================================
@@ -35,6 +38,14 @@ inline std::string connectionStateToString(ConnectionState state) {
     return "unknown";
 }
 
+/// Wall-clock time spent in each phase of the last CopilotClient start.
+struct StartupTimings {
+    double spawnMs = 0;     // Starting the CLI process (0 for an external server)
+    double connectMs = 0;   // Creating the JSON-RPC client and starting its reader
+    double verifyMs = 0;    // Protocol version check (ping round trip)
+    double totalMs = 0;
+};
+
 // ============================================================================
 // Tool Types
 // ============================================================================
@@ -44,14 +55,20 @@ using ToolResultType = std::string; // "success", "failure", "rejected", "denied
 
 /// Binary result payload from a tool.
 struct ToolBinaryResult {
-    std::string data;
+    std::string data;                  // Base64-encoded payload
     std::string mimeType;
     std::string type;
     std::optional<std::string> description;
+    std::vector<uint8_t> bytes;        // Raw payload, encoded on send when data is empty
 };
 
 inline void to_json(nlohmann::json& j, const ToolBinaryResult& r) {
-    j = {{"data", r.data}, {"mimeType", r.mimeType}, {"type", r.type}};
+    j = {{"mimeType", r.mimeType}, {"type", r.type}};
+    if (r.data.empty() && !r.bytes.empty()) {
+        j["data"] = base64Encode(r.bytes.data(), r.bytes.size());
+    } else {
+        j["data"] = r.data;
+    }
     if (r.description) j["description"] = *r.description;
 }
 
@@ -502,6 +519,8 @@ inline void to_json(nlohmann::json& j, const Attachment& a) {
 /// A session event received from the CLI server.
 /// The 'type' field indicates the event kind (e.g., "assistant.message", "session.idle").
 /// The 'data' field contains event-specific payload as JSON.
+struct AssistantImageData;
+
 struct SessionEvent {
     std::string id;
     std::string timestamp;
@@ -509,6 +528,20 @@ struct SessionEvent {
     std::optional<bool> ephemeral;
     std::string type;
     nlohmann::json data;
+
+    /// Base64 strings kept out of 'data' (see CopilotClientOptions::payloadExtractionThreshold).
+    /// In 'data' each is replaced by {"$payload": index}.
+    std::vector<Base64Span> payloads;
+
+    /// Resolve a {"$payload": index} marker; empty for any other value.
+    Base64Span payload(const nlohmann::json& value) const {
+        if (!value.is_object() || !value.contains("$payload")) return {};
+        auto index = value["$payload"].get<size_t>();
+        return index < payloads.size() ? payloads[index] : Base64Span{};
+    }
+
+    /// The image of an assistant.message event, if any.
+    std::optional<AssistantImageData> image() const;
 };
 
 inline void from_json(const nlohmann::json& j, SessionEvent& e) {
@@ -532,6 +565,42 @@ inline void to_json(nlohmann::json& j, const SessionEvent& e) {
 /// Handler for session events.
 using SessionEventHandler = std::function<void(const SessionEvent&)>;
 
+// ============================================================================
+// Priority Classes
+// ============================================================================
+
+/// Scheduling class for outbound RPCs and turns. Higher classes go first;
+/// lower classes are still served once they have waited longer than the
+/// client's priorityStarvationMs.
+enum class Priority {
+    Interactive = 0,
+    Normal = 1,
+    Batch = 2
+};
+
+constexpr size_t kPriorityCount = 3;
+
+inline std::string priorityToString(Priority priority) {
+    switch (priority) {
+        case Priority::Interactive: return "interactive";
+        case Priority::Normal:      return "normal";
+        case Priority::Batch:       return "batch";
+    }
+    return "unknown";
+}
+
+/// Outbound latency for one priority class. Queue time is spent waiting for
+/// the write side of the connection; round trip runs from the request being
+/// queued to its response.
+struct PriorityLatencyStats {
+    uint64_t messages = 0;
+    double totalQueueTimeMs = 0;
+    double maxQueueTimeMs = 0;
+    uint64_t requests = 0;
+    double totalRoundTripMs = 0;
+    double maxRoundTripMs = 0;
+};
+
 // ============================================================================
 // Session Configuration
 // ============================================================================
@@ -556,6 +625,11 @@ struct SessionConfig {
     std::optional<std::vector<std::string>> skillDirectories;
     std::optional<std::vector<std::string>> disabledSkills;
     std::optional<InfiniteSessionConfig> infiniteSessions;
+    /// Admission tag (tenant key) for rate limiting and fair queuing of sends.
+    /// Sessions without a tag share the "" tag.
+    std::string tag;
+    /// Priority class for this session's RPCs and turns.
+    Priority priority = Priority::Normal;
 };
 
 struct ResumeSessionConfig {
@@ -578,6 +652,10 @@ struct ResumeSessionConfig {
     std::optional<std::vector<std::string>> disabledSkills;
     std::optional<InfiniteSessionConfig> infiniteSessions;
     bool disableResume = false;
+    /// Admission tag (tenant key), as in SessionConfig.
+    std::string tag;
+    /// Priority class, as in SessionConfig.
+    Priority priority = Priority::Normal;
 };
 
 // ============================================================================
@@ -629,6 +707,17 @@ struct AssistantImageData {
     std::string revisedPrompt;   // The prompt the model actually used
     int width = 0;
     int height = 0;
+    Base64Span base64Payload;    // Set instead of base64 when kept out of the event data
+
+    std::string_view base64View() const {
+        return base64Payload.empty() ? std::string_view(base64) : base64Payload.view();
+    }
+
+    size_t decodedSize() const { return base64DecodedSize(base64View()); }
+
+    /// Decode the image bytes into 'sink' without materializing them.
+    /// @return Number of decoded bytes.
+    size_t decodeTo(const ByteSink& sink) const { return base64Decode(base64View(), sink); }
 };
 
 inline void to_json(nlohmann::json& j, const AssistantImageData& d) {
@@ -643,13 +732,20 @@ inline void to_json(nlohmann::json& j, const AssistantImageData& d) {
 
 inline void from_json(const nlohmann::json& j, AssistantImageData& d) {
     if (j.contains("format")) j["format"].get_to(d.format);
-    if (j.contains("base64")) j["base64"].get_to(d.base64);
+    if (j.contains("base64") && j["base64"].is_string()) j["base64"].get_to(d.base64);
     if (j.contains("url")) j["url"].get_to(d.url);
     if (j.contains("revisedPrompt")) j["revisedPrompt"].get_to(d.revisedPrompt);
     if (j.contains("width")) j["width"].get_to(d.width);
     if (j.contains("height")) j["height"].get_to(d.height);
 }
 
+inline std::optional<AssistantImageData> SessionEvent::image() const {
+    if (!data.contains("image") || !data["image"].is_object()) return std::nullopt;
+    auto image = data["image"].get<AssistantImageData>();
+    if (data["image"].contains("base64")) image.base64Payload = payload(data["image"]["base64"]);
+    return image;
+}
+
 /** A content block in a mixed text+image response. */
 struct ContentBlock {
     std::string type;            // "text" or "image"
@@ -679,6 +775,7 @@ struct MessageOptions {
     std::optional<std::string> mode;              // "enqueue" or "immediate"
     std::optional<ResponseFormat> responseFormat;  // Desired response format
     std::optional<ImageOptions> imageOptions;      // Options for image generation
+    std::optional<Priority> priority;              // Overrides the session's priority class
 };
 
 // ============================================================================
@@ -873,6 +970,259 @@ inline void from_json(const nlohmann::json& j, SessionLifecycleEvent& e) {
 /// Handler for session lifecycle events.
 using SessionLifecycleHandler = std::function<void(const SessionLifecycleEvent&)>;
 
+// ============================================================================
+// Admission Control
+// ============================================================================
+
+/// Token bucket for one admission tag: sends are admitted at ratePerSecond on
+/// average, with up to burst sends admitted back to back.
+struct TagRateLimit {
+    double ratePerSecond = 0; // 0 = unlimited
+    double burst = 1;
+};
+
+/// Client-side admission control for session.send. A turn holds an in-flight
+/// slot from the moment it is admitted until its session reports session.idle
+/// or session.error. Turns that cannot be admitted wait client-side, and
+/// waiting tags are served round-robin so one busy tenant cannot starve the rest.
+struct AdmissionOptions {
+    /// Maximum turns in flight across the client (0 = unlimited).
+    size_t maxInFlightTurns = 0;
+
+    /// Rate limit applied to every tag without an entry in tagLimits.
+    TagRateLimit defaultTagLimit;
+
+    /// Per-tag rate limits.
+    std::map<std::string, TagRateLimit> tagLimits;
+
+    /// How long a send may wait for admission before throwing (0 = no limit).
+    int maxQueueWaitMs = 0;
+};
+
+/// Admission counters for one tag. Queue time is spent waiting client-side for
+/// admission; server time runs from admission to session.idle/session.error.
+struct TagAdmissionStats {
+    size_t queued = 0;            // Sends currently waiting
+    size_t inFlight = 0;          // Admitted turns not yet idle
+    uint64_t admitted = 0;
+    uint64_t completed = 0;
+    uint64_t rejected = 0;        // Gave up waiting (timeout or client stop)
+    double totalQueueTimeMs = 0;
+    double maxQueueTimeMs = 0;
+    double totalServerTimeMs = 0;
+    double maxServerTimeMs = 0;
+};
+
+struct AdmissionStats {
+    TagAdmissionStats total;
+    std::map<std::string, TagAdmissionStats> byTag;
+    std::map<Priority, TagAdmissionStats> byPriority;
+};
+
+// ============================================================================
+// Batch Prompts
+// ============================================================================
+
+struct BatchOptions {
+    /// Attempts per item before it is reported as failed (default: 3).
+    int maxAttempts = 3;
+
+    /// Delay before the first retry; doubles on every further retry (default: 1000).
+    int retryDelayMs = 1000;
+
+    /// Timeout of a single attempt, as in sendAndWait (default: 60000).
+    int timeoutMs = 60000;
+
+    /// Append-only checkpoint file (empty = none). Items recorded in it are
+    /// not sent again when the same batch is re-run.
+    std::string checkpointPath;
+};
+
+/// Outcome of one batch item. latencyMs covers all attempts, including retry delays.
+struct BatchItemResult {
+    size_t index = 0;
+    bool success = false;
+    std::string content;          // Last assistant message (empty if none)
+    std::string error;            // Last error when !success
+    int attempts = 0;
+    double latencyMs = 0;
+    bool fromCheckpoint = false;  // Completed by an earlier run
+};
+
+/// Called once per item as results arrive (serialized, in completion order).
+using BatchResultHandler = std::function<void(const BatchItemResult&)>;
+
+struct BatchSummary {
+    size_t succeeded = 0;
+    size_t failed = 0;
+    size_t fromCheckpoint = 0;
+    double elapsedMs = 0;
+};
+
+// ============================================================================
+// Journal Replay
+// ============================================================================
+
+struct ReplayOptions {
+    /// Journal recorded with CopilotClientOptions::journalPath.
+    std::string journalPath;
+
+    /// Playback speed relative to the recording (default: 1.0; 0 = as fast as possible).
+    double speed = 1.0;
+
+    /// How long a recorded response waits for the client to send its request
+    /// before it is delivered unmatched (default: 1000).
+    int matchTimeoutMs = 1000;
+};
+
+// ============================================================================
+// Connection Health
+// ============================================================================
+
+/// Background health monitoring of the CLI connection. The monitor pings the
+/// server every intervalMs and checks the transport for stalls; a connection
+/// that misses failureThreshold pings in a row, or whose reader or writer has
+/// been stuck for stallMs, is marked unhealthy.
+struct HealthOptions {
+    /// Time between pings (default: 1000).
+    int intervalMs = 1000;
+
+    /// Deadline for a single ping (default: 500).
+    int timeoutMs = 500;
+
+    /// Consecutive failed pings before the connection is unhealthy (default: 2).
+    int failureThreshold = 2;
+
+    /// How long a single write, or reading and parsing an inbound frame, may
+    /// take before the transport counts as stalled (default: 2000). Time spent
+    /// in event and request handlers does not count.
+    int stallMs = 2000;
+};
+
+/// Upper bounds (ms) of the ping latency histogram buckets; the last bucket
+/// holds everything slower.
+constexpr std::array<double, 9> kHealthLatencyBoundsMs = {1, 2, 5, 10, 20, 50, 100, 200, 500};
+constexpr size_t kHealthLatencyBuckets = kHealthLatencyBoundsMs.size() + 1;
+
+struct HealthStats {
+    bool healthy = true;
+    uint64_t pings = 0;
+    uint64_t failures = 0;
+    int consecutiveFailures = 0;
+    uint64_t restarts = 0;          // Connections restarted after becoming unhealthy
+    double lastLatencyMs = 0;
+    double ewmaLatencyMs = 0;       // Smoothed ping round trip (alpha 0.2)
+    double maxLatencyMs = 0;
+    std::array<uint64_t, kHealthLatencyBuckets> latencyHistogram{};
+};
+
+/// Reported whenever the connection turns unhealthy or recovers.
+struct HealthEvent {
+    bool healthy = true;
+    std::string reason;             // Why the connection is unhealthy (empty when healthy)
+    HealthStats stats;
+};
+
+using HealthHandler = std::function<void(const HealthEvent&)>;
+
+/// Restarts of the spawned CLI server after it exited or hung (see
+/// CopilotClientOptions::autoRestart).
+struct RestartStats {
+    uint64_t restarts = 0;          // Completed recoveries
+    uint64_t failedAttempts = 0;    // Spawn/reconnect attempts that failed
+    int lastBackoffMs = 0;          // Delay before the last attempt
+    double lastRecoveryMs = 0;      // From detection to reconnected
+    uint64_t replayedRequests = 0;  // Requests sent again, or held and sent, after a restart
+    uint64_t failedRequests = 0;    // In-flight requests that could not be replayed
+    uint64_t resumedSessions = 0;
+    std::string lastReason;
+};
+
+// ============================================================================
+// CLI Process
+// ============================================================================
+
+/// How a spawned CLI process ended. CPU time and peak RSS come from the
+/// rusage reported when it was reaped.
+struct ProcessExit {
+    int pid = 0;
+    std::optional<int> exitCode;    // Set when the process exited
+    std::optional<int> signal;      // Set when a signal terminated it
+    double userCpuMs = 0;
+    double systemCpuMs = 0;
+    uint64_t maxRssBytes = 0;
+};
+
+/// Resource usage of the spawned CLI process, sampled from /proc where
+/// available (zero elsewhere).
+struct ProcessStats {
+    int pid = 0;                    // 0 when no CLI process is running
+    bool running = false;
+    uint64_t rssBytes = 0;
+    double userCpuMs = 0;
+    double systemCpuMs = 0;
+    std::optional<ProcessExit> lastExit;
+
+    // The whole cgroup (the CLI plus the MCP servers it starts) when
+    // ProcessLimits::cgroup is set, from memory.current and cpu.stat
+    uint64_t cgroupMemoryBytes = 0;
+    double cgroupCpuMs = 0;
+};
+
+/// Resource controls applied to the spawned CLI before exec (POSIX).
+/// Unset fields inherit from the application. Children of the CLI, such as
+/// MCP servers, inherit them too.
+struct ProcessLimits {
+    /// RLIMIT_AS, soft and hard, clamped to the current hard limit.
+    std::optional<uint64_t> addressSpaceBytes;
+    /// RLIMIT_NOFILE, soft and hard, clamped to the current hard limit.
+    std::optional<uint64_t> openFiles;
+    /// Nice level; lowering it below the application's needs privileges.
+    std::optional<int> nice;
+    /// CPUs the CLI may run on (Linux only; empty = inherit).
+    std::vector<int> cpuAffinity;
+    /// Existing cgroup v2 directory to place the CLI in (Linux only), e.g.
+    /// "/sys/fs/cgroup/app.slice/copilot". Must be writable by the application.
+    std::string cgroup;
+};
+
+/// Receives each line the CLI process writes to stderr.
+using StderrSink = std::function<void(const std::string& line)>;
+
+// ============================================================================
+// SDK Threads
+// ============================================================================
+
+/// Scheduling policy of SDK threads.
+enum class ThreadPolicy {
+    Inherit,        // Whatever the creating thread has
+    Other,          // SCHED_OTHER
+    Batch,          // SCHED_BATCH (Linux)
+    Idle,           // SCHED_IDLE (Linux)
+    Fifo,           // SCHED_FIFO, real-time; needs privileges
+    RoundRobin,     // SCHED_RR, real-time; needs privileges
+};
+
+/// Called on an SDK thread with its name ("copilot-reader", ...).
+using ThreadHook = std::function<void(const std::string& name)>;
+
+/// How the threads the SDK creates are set up. Every thread is named
+/// (visible in top, perf and debuggers); affinity and policy are applied
+/// best effort, as the thread starts.
+struct ThreadOptions {
+    /// CPUs SDK threads may run on (Linux only; empty = inherit).
+    std::vector<int> cpuAffinity;
+
+    /// Scheduling policy (POSIX only) and, for Fifo and RoundRobin, priority.
+    ThreadPolicy policy = ThreadPolicy::Inherit;
+    int priority = 0;
+
+    /// Run on each SDK thread before it does any work, e.g. to register it
+    /// with a profiler or allocator, and right before it exits.
+    ThreadHook onThreadStart;
+    ThreadHook onThreadExit;
+};
+
 // ============================================================================
 // Client Options
 // ============================================================================
@@ -902,14 +1252,70 @@ struct CopilotClientOptions {
     /// Auto-start the CLI server on first use (default: true).
     bool autoStart = true;
 
-    /// Auto-restart the CLI server if it crashes (default: true).
+    /// Auto-restart the CLI server if it exits or hangs (default: true).
+    /// In-flight requests for read-only methods are replayed, others fail, and
+    /// live sessions are resumed with the configuration they were created with.
     bool autoRestart = true;
 
+    /// Delay before the first restart attempt; doubles after every failed
+    /// attempt up to maxRestartBackoffMs (default: 100).
+    int restartBackoffMs = 100;
+    int maxRestartBackoffMs = 5000;
+
+    /// Failed restart attempts in a row before the client gives up and
+    /// enters ConnectionState::Error (default: 5).
+    int maxRestartAttempts = 5;
+
+    /// Keep the last this many bytes of the CLI's stderr, see
+    /// CopilotClient::cliStderr() (default: 64 KiB; 0 = keep none).
+    size_t stderrBufferBytes = 64 * 1024;
+
+    /// Called on the supervisor thread with each line the CLI writes to stderr.
+    StderrSink onStderr;
+
+    /// How often the CLI's memory and CPU usage is sampled (default: 1000; 0 = never).
+    int processSampleIntervalMs = 1000;
+
+    /// Resource limits for the spawned CLI (none when unset).
+    std::optional<ProcessLimits> processLimits;
+
+    /// Affinity, scheduling and hooks for the threads the SDK creates.
+    ThreadOptions threads;
+
     /// GitHub token for authentication.
     std::optional<std::string> githubToken;
 
     /// Whether to use the logged-in user for authentication (default: true, false when githubToken is set).
     std::optional<bool> useLoggedInUser;
+
+    /// Admission control for session.send across all sessions (disabled when unset).
+    std::optional<AdmissionOptions> admission;
+
+    /// How long a lower priority class may wait while higher classes are
+    /// served, both for outbound messages and for admission (default: 500).
+    int priorityStarvationMs = 500;
+
+    /// Inbound "base64" strings at least this long are kept in the received
+    /// message buffer instead of event data, and exposed through
+    /// SessionEvent::payloads and SessionEvent::image() (default: 0 = disabled).
+    size_t payloadExtractionThreshold = 0;
+
+    /// Record every inbound and outbound frame to this journal file
+    /// (truncated on each start; empty = disabled).
+    std::string journalPath;
+
+    /// Replay a journal instead of starting or connecting to a CLI server.
+    std::optional<ReplayOptions> replay;
+
+    /// Persist status, the model list and the session list in this file.
+    /// On start, cached results are served at once and refreshed in the
+    /// background (empty = disabled).
+    std::string diskCachePath;
+
+    /// Ping the server in the background and detect a hung connection
+    /// (disabled when unset). With autoRestart, an unhealthy connection to a
+    /// spawned CLI server is torn down and started again.
+    std::optional<HealthOptions> health;
 };
 
 } // namespace copilot
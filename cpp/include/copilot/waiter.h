@@ -0,0 +1,52 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Microsoft Corporation. All rights reserved.
+ *--------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#ifndef __linux__
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace copilot {
+
+/// One-shot wake-up between a single signaller and a single waiter,
+/// reusable after reset(). The waiter parks on a futex on Linux (a mutex
+/// and condition variable elsewhere); signal() is one atomic exchange and
+/// makes a system call only if the waiter is parked.
+///
+/// Everything written before signal() is visible after a wait that
+/// returns true.
+class OneShotWaiter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// Arm for another round. Neither side may be using it.
+    void reset() { state_.store(kIdle, std::memory_order_relaxed); }
+
+    void signal();
+
+    /// Wait until signalled or 'deadline'. Returns false on timeout.
+    bool waitUntil(Clock::time_point deadline);
+
+private:
+    static constexpr uint32_t kIdle = 0;
+    static constexpr uint32_t kParked = 1;
+    static constexpr uint32_t kSignalled = 2;
+
+    void park(Clock::time_point deadline);
+    void wake();
+
+    std::atomic<uint32_t> state_{kIdle};
+#ifndef __linux__
+    std::mutex mutex_;
+    std::condition_variable cv_;
+#endif
+};
+
+} // namespace copilot
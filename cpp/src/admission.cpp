@@ -0,0 +1,274 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Microsoft Corporation. All rights reserved.
+ *--------------------------------------------------------------------------------------------*/
+
+#include "copilot/admission.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace copilot {
+
+using MillisecondsF = std::chrono::duration<double, std::milli>;
+
+// ============================================================================
+// Construction
+// ============================================================================
+
+AdmissionController::AdmissionController(const AdmissionOptions& options, int starvationMs)
+    : options_(options), starvationBound_(std::chrono::milliseconds(starvationMs)) {}
+
+// ============================================================================
+// Token Buckets
+// ============================================================================
+
+AdmissionController::TagState& AdmissionController::tagState(const std::string& tag) {
+    auto it = tags_.find(tag);
+    if (it != tags_.end()) return it->second;
+
+    TagState& state = tags_[tag];
+    auto limit = options_.tagLimits.find(tag);
+    state.limit = limit != options_.tagLimits.end() ? limit->second : options_.defaultTagLimit;
+    state.tokens = std::max(1.0, state.limit.burst);
+    state.lastRefill = Clock::now();
+    return state;
+}
+
+void AdmissionController::refill(TagState& state, Clock::time_point now) {
+    if (state.limit.ratePerSecond <= 0) return;
+
+    double elapsed = std::chrono::duration<double>(now - state.lastRefill).count();
+    state.tokens = std::min(std::max(1.0, state.limit.burst),
+                            state.tokens + elapsed * state.limit.ratePerSecond);
+    state.lastRefill = now;
+}
+
+// ============================================================================
+// Scheduling
+// ============================================================================
+
+/// Classes in the order schedule() serves them: the class whose oldest
+/// waiter has starved longest first (if any has passed the bound), then the
+/// rest from highest to lowest priority. Caller holds mutex_.
+std::array<size_t, kPriorityCount> AdmissionController::serviceOrder(Clock::time_point now) const {
+    std::array<size_t, kPriorityCount> order;
+    for (size_t cls = 0; cls < kPriorityCount; ++cls) order[cls] = cls;
+
+    size_t starved = kPriorityCount;
+    Clock::time_point starvedSince = now - starvationBound_;
+    for (size_t cls = 1; cls < kPriorityCount; ++cls) {
+        for (const auto& tag : readyTags_[cls]) {
+            Clock::time_point enqueuedAt = tags_.at(tag).waiters[cls].front()->enqueuedAt;
+            if (enqueuedAt <= starvedSince) {
+                starvedSince = enqueuedAt;
+                starved = cls;
+            }
+        }
+    }
+
+    if (starved < kPriorityCount) {
+        std::rotate(order.begin(), order.begin() + starved, order.begin() + starved + 1);
+    }
+    return order;
+}
+
+/// Admit the next waiter of class 'cls', taking tags round-robin and skipping
+/// tags that are out of tokens (nextRefill_ records when the first of them
+/// can go). Caller holds mutex_.
+/// @return true if a waiter was admitted.
+bool AdmissionController::admitOne(size_t cls, Clock::time_point now) {
+    auto& ready = readyTags_[cls];
+    for (size_t i = 0, rounds = ready.size(); i < rounds; ++i) {
+        std::string tag = std::move(ready.front());
+        ready.pop_front();
+        TagState& state = tags_[tag];
+
+        refill(state, now);
+        if (state.limit.ratePerSecond > 0 && state.tokens < 1) {
+            auto wait = std::chrono::duration<double>((1 - state.tokens) / state.limit.ratePerSecond);
+            nextRefill_ = std::min(nextRefill_,
+                                   now + std::chrono::duration_cast<Clock::duration>(wait));
+            ready.push_back(std::move(tag));
+            continue;
+        }
+        if (state.limit.ratePerSecond > 0) state.tokens -= 1;
+
+        state.waiters[cls].front()->admitted = true;
+        state.waiters[cls].pop_front();
+        ++inFlight_;
+        if (!state.waiters[cls].empty()) ready.push_back(std::move(tag));
+        return true;
+    }
+    return false;
+}
+
+/// Admit waiters while slots are free, re-evaluating the service order after
+/// every admission. Caller holds mutex_.
+/// @return true if any waiter was admitted.
+bool AdmissionController::schedule(Clock::time_point now) {
+    nextRefill_ = Clock::time_point::max();
+    bool admittedAny = false;
+
+    while (options_.maxInFlightTurns == 0 || inFlight_ < options_.maxInFlightTurns) {
+        bool admitted = false;
+        for (size_t cls : serviceOrder(now)) {
+            if (admitOne(cls, now)) {
+                admitted = true;
+                break;
+            }
+        }
+        if (!admitted) break;
+        admittedAny = true;
+    }
+    return admittedAny;
+}
+
+void AdmissionController::removeWaiter(const std::string& tag, size_t cls, Waiter* waiter) {
+    auto& waiters = tags_[tag].waiters[cls];
+    waiters.erase(std::remove(waiters.begin(), waiters.end(), waiter), waiters.end());
+    if (waiters.empty()) {
+        auto& ready = readyTags_[cls];
+        ready.erase(std::remove(ready.begin(), ready.end(), tag), ready.end());
+    }
+}
+
+// ============================================================================
+// Acquire / Release
+// ============================================================================
+
+AdmissionController::Ticket AdmissionController::acquire(const std::string& tag, Priority priority) {
+    return tryAcquire(tag, priority).value();
+}
+
+Result<AdmissionController::Ticket> AdmissionController::tryAcquire(const std::string& tag,
+                                                                    Priority priority) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    auto cls = static_cast<size_t>(priority);
+    auto enqueuedAt = Clock::now();
+    auto deadline = options_.maxQueueWaitMs > 0
+        ? enqueuedAt + std::chrono::milliseconds(options_.maxQueueWaitMs)
+        : Clock::time_point::max();
+    uint64_t generation = generation_;
+
+    Waiter waiter;
+    waiter.enqueuedAt = enqueuedAt;
+    TagState& state = tagState(tag);
+    TagAdmissionStats& classStats = priorityStats_[cls];
+    if (state.waiters[cls].empty()) readyTags_[cls].push_back(tag);
+    state.waiters[cls].push_back(&waiter);
+    state.stats.queued++;
+    classStats.queued++;
+
+    if (schedule(enqueuedAt)) cv_.notify_all();
+
+    while (!waiter.admitted) {
+        auto wakeAt = std::min(deadline, nextRefill_);
+        if (wakeAt == Clock::time_point::max()) {
+            cv_.wait(lock);
+        } else {
+            cv_.wait_until(lock, wakeAt);
+        }
+
+        if (generation != generation_) {
+            // reset() already dropped this waiter
+            for (auto* stats : {&state.stats, &classStats}) {
+                stats->queued--;
+                stats->rejected++;
+            }
+            return RpcError{RpcError::Kind::Stopped, 0, "Admission cancelled: client stopped", nullptr};
+        }
+
+        auto now = Clock::now();
+        if (schedule(now)) cv_.notify_all();
+        if (!waiter.admitted && now >= deadline) {
+            removeWaiter(tag, cls, &waiter);
+            for (auto* stats : {&state.stats, &classStats}) {
+                stats->queued--;
+                stats->rejected++;
+            }
+            return RpcError{RpcError::Kind::Timeout, 0,
+                            "Timeout after " + std::to_string(options_.maxQueueWaitMs) +
+                                "ms waiting for admission",
+                            nullptr};
+        }
+    }
+
+    auto admittedAt = Clock::now();
+    double queueMs = MillisecondsF(admittedAt - enqueuedAt).count();
+    for (auto* stats : {&state.stats, &classStats}) {
+        stats->queued--;
+        stats->inFlight++;
+        stats->admitted++;
+        stats->totalQueueTimeMs += queueMs;
+        stats->maxQueueTimeMs = std::max(stats->maxQueueTimeMs, queueMs);
+    }
+
+    return Ticket{++nextTicketId_, generation, tag, priority, admittedAt};
+}
+
+void AdmissionController::release(const Ticket& ticket, bool completed) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (ticket.generation != generation_) return;
+
+    auto now = Clock::now();
+    double serverMs = MillisecondsF(now - ticket.admittedAt).count();
+    --inFlight_;
+    for (auto* stats : {&tags_[ticket.tag].stats, &priorityStats_[static_cast<size_t>(ticket.priority)]}) {
+        stats->inFlight--;
+        if (completed) {
+            stats->completed++;
+            stats->totalServerTimeMs += serverMs;
+            stats->maxServerTimeMs = std::max(stats->maxServerTimeMs, serverMs);
+        }
+    }
+
+    // Wake waiters even if nobody was admitted: waits that were blocked on
+    // the in-flight limit must now re-arm on the next token refill
+    schedule(now);
+    cv_.notify_all();
+}
+
+void AdmissionController::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++generation_;
+    inFlight_ = 0;
+    for (auto& ready : readyTags_) ready.clear();
+    for (auto& [tag, state] : tags_) {
+        for (auto& waiters : state.waiters) waiters.clear();
+        state.stats.inFlight = 0;
+    }
+    for (auto& stats : priorityStats_) stats.inFlight = 0;
+    cv_.notify_all();
+}
+
+// ============================================================================
+// Stats
+// ============================================================================
+
+AdmissionStats AdmissionController::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    AdmissionStats result;
+    for (const auto& [tag, state] : tags_) {
+        const TagAdmissionStats& s = state.stats;
+        result.byTag[tag] = s;
+
+        TagAdmissionStats& t = result.total;
+        t.queued += s.queued;
+        t.inFlight += s.inFlight;
+        t.admitted += s.admitted;
+        t.completed += s.completed;
+        t.rejected += s.rejected;
+        t.totalQueueTimeMs += s.totalQueueTimeMs;
+        t.maxQueueTimeMs = std::max(t.maxQueueTimeMs, s.maxQueueTimeMs);
+        t.totalServerTimeMs += s.totalServerTimeMs;
+        t.maxServerTimeMs = std::max(t.maxServerTimeMs, s.maxServerTimeMs);
+    }
+    for (size_t cls = 0; cls < kPriorityCount; ++cls) {
+        result.byPriority[static_cast<Priority>(cls)] = priorityStats_[cls];
+    }
+    return result;
+}
+
+} // namespace copilot
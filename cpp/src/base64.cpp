@@ -0,0 +1,276 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Microsoft Corporation. All rights reserved.
+ *--------------------------------------------------------------------------------------------*/
+
+#include "copilot/base64.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <stdexcept>
+
+// The SSSE3 decoder is built on every x86 target and picked at run time,
+// unless the whole SDK is already compiled for SSSE3
+#if defined(__SSSE3__)
+#define COPILOT_BASE64_SSSE3 1
+#define COPILOT_TARGET_SSSE3
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define COPILOT_BASE64_SSSE3 1
+#define COPILOT_TARGET_SSSE3 __attribute__((target("ssse3")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define COPILOT_BASE64_SSSE3 1
+#define COPILOT_TARGET_SSSE3
+#include <intrin.h>
+#endif
+
+#ifdef COPILOT_BASE64_SSSE3
+#include <tmmintrin.h>
+#endif
+
+#ifdef _WIN32
+#include <io.h>
+#define COPILOT_WRITE(fd, buf, len) _write(fd, buf, static_cast<unsigned int>(len))
+#else
+#include <unistd.h>
+#define COPILOT_WRITE(fd, buf, len) ::write(fd, buf, len)
+#endif
+
+namespace copilot {
+
+static constexpr char kAlphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/// Sextet value of each character; 0xFF for characters outside the alphabet.
+static const std::array<uint8_t, 256> kDecodeTable = [] {
+    std::array<uint8_t, 256> table{};
+    table.fill(0xFF);
+    for (uint8_t i = 0; i < 64; ++i) {
+        table[static_cast<uint8_t>(kAlphabet[i])] = i;
+    }
+    return table;
+}();
+
+// ============================================================================
+// Sinks
+// ============================================================================
+
+ByteSink fdSink(int fd) {
+    return [fd](const uint8_t* data, size_t size) {
+        while (size > 0) {
+            auto n = COPILOT_WRITE(fd, data, size);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) throw std::runtime_error("Failed to write decoded data");
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+    };
+}
+
+ByteSink bufferSink(std::vector<uint8_t>& out) {
+    return [&out](const uint8_t* data, size_t size) {
+        out.insert(out.end(), data, data + size);
+    };
+}
+
+// ============================================================================
+// Decoding
+// ============================================================================
+
+#ifdef COPILOT_BASE64_SSSE3
+/// Whether the CPU running us has SSSE3; checked once.
+static bool cpuHasSsse3() {
+#if defined(__SSSE3__)
+    return true;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3");
+#endif
+}
+
+/// Lanes of 'c' between 'lo' and 'hi' inclusive.
+COPILOT_TARGET_SSSE3
+static inline __m128i inRange(__m128i c, char lo, char hi) {
+    return _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8(static_cast<char>(lo - 1))),
+                         _mm_cmplt_epi8(c, _mm_set1_epi8(static_cast<char>(hi + 1))));
+}
+
+/// Decode 16 characters into 12 bytes. Stores 16 bytes, so 'out' needs 4
+/// bytes of slack. Returns false if any character is outside the alphabet
+/// (including padding); the caller then falls back to the scalar loop.
+COPILOT_TARGET_SSSE3
+static bool decodeBlock16(const char* in, uint8_t* out) {
+    const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    const __m128i upper = inRange(c, 'A', 'Z');
+    const __m128i lower = inRange(c, 'a', 'z');
+    const __m128i digit = inRange(c, '0', '9');
+    const __m128i plus = _mm_cmpeq_epi8(c, _mm_set1_epi8('+'));
+    const __m128i slash = _mm_cmpeq_epi8(c, _mm_set1_epi8('/'));
+
+    __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, plus));
+    valid = _mm_or_si128(valid, slash);
+    if (_mm_movemask_epi8(valid) != 0xFFFF) return false;
+
+    // Character -> sextet is a per-class offset
+    __m128i shift = _mm_and_si128(upper, _mm_set1_epi8(-65));
+    shift = _mm_or_si128(shift, _mm_and_si128(lower, _mm_set1_epi8(-71)));
+    shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(4)));
+    shift = _mm_or_si128(shift, _mm_and_si128(plus, _mm_set1_epi8(19)));
+    shift = _mm_or_si128(shift, _mm_and_si128(slash, _mm_set1_epi8(16)));
+    const __m128i sextets = _mm_add_epi8(c, shift);
+
+    // Pack 4 sextets into 24 bits per lane, then gather the 3 bytes of each lane big-endian
+    const __m128i pairs = _mm_maddubs_epi16(sextets, _mm_set1_epi32(0x01400140));
+    const __m128i lanes = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+    const __m128i bytes = _mm_shuffle_epi8(
+        lanes, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), bytes);
+    return true;
+}
+#endif
+
+Base64Decoder::Base64Decoder(ByteSink sink, size_t bufferSize)
+    : sink_(std::move(sink)), blockSize_(std::max<size_t>(bufferSize, 48)) {
+    out_.resize(blockSize_ + 4);
+}
+
+void Base64Decoder::feed(std::string_view text) {
+    const char* p = text.data();
+    size_t n = text.size();
+
+    // Complete a group split across chunks
+    while (pendingSize_ > 0 && n > 0) {
+        pending_[pendingSize_++] = *p++;
+        --n;
+        if (pendingSize_ == 4) {
+            pendingSize_ = 0;
+            if (pending_[3] == '=') {
+                decodeFinalGroup(pending_);
+            } else {
+                decodeGroups(pending_, 1);
+            }
+        }
+    }
+    if (n == 0) return;
+    if (padded_) throw std::runtime_error("Invalid base64: data after padding");
+
+    // Padding may only end the last group
+    size_t groups = n / 4;
+    if (groups > 0 && p[groups * 4 - 1] == '=') {
+        decodeGroups(p, groups - 1);
+        decodeFinalGroup(p + (groups - 1) * 4);
+    } else {
+        decodeGroups(p, groups);
+    }
+
+    size_t rest = n % 4;
+    if (rest > 0 && padded_) throw std::runtime_error("Invalid base64: data after padding");
+    std::copy(p + groups * 4, p + n, pending_);
+    pendingSize_ = rest;
+}
+
+void Base64Decoder::finish() {
+    if (pendingSize_ > 0) throw std::runtime_error("Invalid base64: truncated input");
+    flush();
+}
+
+void Base64Decoder::decodeGroups(const char* in, size_t groups) {
+#ifdef COPILOT_BASE64_SSSE3
+    static const bool useSsse3 = cpuHasSsse3();
+#endif
+    size_t i = 0;
+    while (i < groups) {
+        size_t room = (blockSize_ - outSize_) / 3;
+        if (room == 0) {
+            flush();
+            continue;
+        }
+        size_t end = std::min(groups, i + room);
+        uint8_t* out = out_.data() + outSize_;
+
+#ifdef COPILOT_BASE64_SSSE3
+        if (useSsse3) {
+            for (; i + 4 <= end; i += 4, out += 12) {
+                if (!decodeBlock16(in + i * 4, out)) break;
+            }
+        }
+#endif
+        for (; i < end; ++i, out += 3) {
+            const auto* g = reinterpret_cast<const uint8_t*>(in + i * 4);
+            uint32_t a = kDecodeTable[g[0]], b = kDecodeTable[g[1]];
+            uint32_t c = kDecodeTable[g[2]], d = kDecodeTable[g[3]];
+            if ((a | b | c | d) & 0x80) throw std::runtime_error("Invalid base64 character");
+            uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+            out[0] = static_cast<uint8_t>(v >> 16);
+            out[1] = static_cast<uint8_t>(v >> 8);
+            out[2] = static_cast<uint8_t>(v);
+        }
+        outSize_ = static_cast<size_t>(out - out_.data());
+    }
+}
+
+/// Decode a group ending in '=' padding ("xx==" or "xxx=").
+void Base64Decoder::decodeFinalGroup(const char* group) {
+    const auto* g = reinterpret_cast<const uint8_t*>(group);
+    uint32_t a = kDecodeTable[g[0]], b = kDecodeTable[g[1]];
+    bool twoPad = g[2] == '=';
+    uint32_t c = twoPad ? 0 : kDecodeTable[g[2]];
+    if ((a | b | c) & 0x80) throw std::runtime_error("Invalid base64 character");
+
+    if (outSize_ + 2 > blockSize_) flush();
+    uint32_t v = (a << 18) | (b << 12) | (c << 6);
+    out_[outSize_++] = static_cast<uint8_t>(v >> 16);
+    if (!twoPad) out_[outSize_++] = static_cast<uint8_t>(v >> 8);
+    padded_ = true;
+}
+
+void Base64Decoder::flush() {
+    if (outSize_ == 0) return;
+    sink_(out_.data(), outSize_);
+    written_ += outSize_;
+    outSize_ = 0;
+}
+
+size_t base64Decode(std::string_view text, const ByteSink& sink) {
+    Base64Decoder decoder(sink);
+    decoder.feed(text);
+    decoder.finish();
+    return static_cast<size_t>(decoder.bytesWritten());
+}
+
+size_t base64DecodedSize(std::string_view text) {
+    size_t size = text.size() / 4 * 3;
+    if (!text.empty() && text.back() == '=') --size;
+    if (text.size() > 1 && text[text.size() - 2] == '=') --size;
+    return size;
+}
+
+// ============================================================================
+// Encoding
+// ============================================================================
+
+std::string base64Encode(const uint8_t* data, size_t size) {
+    std::string out((size + 2) / 3 * 4, '=');
+    char* o = &out[0];
+    size_t i = 0;
+    for (; i + 3 <= size; i += 3) {
+        uint32_t v = (uint32_t(data[i]) << 16) | (uint32_t(data[i + 1]) << 8) | data[i + 2];
+        *o++ = kAlphabet[v >> 18];
+        *o++ = kAlphabet[(v >> 12) & 0x3F];
+        *o++ = kAlphabet[(v >> 6) & 0x3F];
+        *o++ = kAlphabet[v & 0x3F];
+    }
+    if (i < size) {
+        uint32_t v = uint32_t(data[i]) << 16;
+        if (i + 1 < size) v |= uint32_t(data[i + 1]) << 8;
+        *o++ = kAlphabet[v >> 18];
+        *o++ = kAlphabet[(v >> 12) & 0x3F];
+        if (i + 1 < size) *o = kAlphabet[(v >> 6) & 0x3F];
+    }
+    return out;
+}
+
+} // namespace copilot
@@ -4,11 +4,19 @@
 
 #include "copilot/client.h"
 #include "copilot/sdk_protocol_version.h"
+#include "copilot/threads.h"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
 
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
@@ -16,8 +24,8 @@
 #include <io.h>
 #include <fcntl.h>
 #else
+#include <fcntl.h>
 #include <signal.h>
-#include <sys/wait.h>
 #include <unistd.h>
 #endif
 
@@ -46,11 +54,40 @@ CopilotClient::CopilotClient(const CopilotClientOptions& options)
         }
     }
 
+    // Replay stands in for the CLI server, whichever transport was configured
+    if (options_.replay) isExternalServer_ = false;
+
     // Check environment variable for CLI path
     const char* envPath = std::getenv("COPILOT_CLI_PATH");
     if (envPath && options_.cliPath == "copilot") {
         options_.cliPath = envPath;
     }
+
+    validateThreadOptions(options_.threads);
+
+    if (options_.admission) {
+        admission_ = std::make_unique<AdmissionController>(*options_.admission,
+                                                           options_.priorityStarvationMs);
+    }
+
+    if (options_.stderrBufferBytes > 0) {
+        stderrBuffer_ = std::make_shared<StderrBuffer>(options_.stderrBufferBytes);
+    }
+
+    if (options_.health) {
+        // Probes run only while connected, so they never see a half-built transport
+        health_ = std::make_unique<HealthMonitor>(*options_.health,
+            [this](std::chrono::milliseconds timeout) {
+                if (state_ != ConnectionState::Connected) return false;
+                rpcClient_->request("ping", {{"message", ""}}, Priority::Interactive, timeout);
+                return true;
+            },
+            [this](std::chrono::milliseconds bound) {
+                if (state_ != ConnectionState::Connected) return std::string();
+                return rpcClient_->stallReason(bound);
+            },
+            [this](const HealthEvent& event) { handleHealthChange(event); }, options_.threads);
+    }
 }
 
 CopilotClient::~CopilotClient() {
@@ -66,26 +103,133 @@ CopilotClient::~CopilotClient() {
 // ============================================================================
 
 void CopilotClient::start() {
-    if (state_ == ConnectionState::Connected) return;
+    startAsync().get();
+}
+
+std::shared_future<void> CopilotClient::startAsync() {
+    if (health_) health_->start();
+
+    std::lock_guard<std::mutex> lock(startMutex_);
+    ConnectionState state = state_;
+    if (startFuture_.valid() &&
+        (state == ConnectionState::Connecting || state == ConnectionState::Connected)) {
+        return startFuture_;
+    }
+
+    // Reap the thread of an earlier start that has finished
+    if (startThread_.joinable()) startThread_.join();
+
+    {
+        std::lock_guard<std::mutex> restartLock(restartMutex_);
+        stopping_ = false;
+    }
+    launchStart([this] { runStartup(); });
+    return startFuture_;
+}
 
+/// Run 'body' (a start or a recovery) on startThread_. Caller holds
+/// startMutex_ and has joined the previous start thread.
+void CopilotClient::launchStart(std::function<void()> body) {
+    auto promise = std::make_shared<std::promise<void>>();
+    startFuture_ = promise->get_future().share();
     state_ = ConnectionState::Connecting;
+    startThread_ = startThread(options_.threads, "copilot-start", [promise, body = std::move(body)] {
+        try {
+            body();
+            promise->set_value();
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    });
+}
+
+StartupTimings CopilotClient::startupTimings() const {
+    std::lock_guard<std::mutex> lock(timingsMutex_);
+    return startupTimings_;
+}
+
+void CopilotClient::runStartup() {
+    using Clock = std::chrono::steady_clock;
+    auto elapsedMs = [](Clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+    };
 
+    StartupTimings timings;
+    auto startedAt = Clock::now();
     try {
-        if (!isExternalServer_) {
+        // A start from Error: sessions still point at rpcClient_, so it is
+        // kept and moved to the new transport
+        bool reconnecting = rpcClient_ != nullptr;
+        if (reconnecting) detachTransport();
+
+        auto phaseAt = Clock::now();
+        if (options_.replay) {
+            startReplay();
+        } else if (!isExternalServer_) {
             startCLIServer();
         }
+        timings.spawnMs = elapsedMs(phaseAt);
+
+        phaseAt = Clock::now();
         connectToServer();
-        verifyProtocolVersion();
+        timings.connectMs = elapsedMs(phaseAt);
+
+        phaseAt = Clock::now();
+        verifyProtocolVersion(
+            rpcClient_->request("ping", {{"message", ""}}).get<PingResponse>());
+        timings.verifyMs = elapsedMs(phaseAt);
+        if (reconnecting) resumeSessions();
+
+        // A refresh left over from an earlier start finishes against this server
+        stopDiskCache();
+        if (!options_.diskCachePath.empty()) {
+            diskCache_ = std::make_unique<DiskCache>(options_.diskCachePath);
+            diskCache_->load();
+            diskCacheRevalidated_ = false;
+            revalidateThread_ = startThread(options_.threads, "copilot-cache", [this] { revalidateDiskCache(); });
+        }
+        timings.totalMs = elapsedMs(startedAt);
+        {
+            std::lock_guard<std::mutex> lock(timingsMutex_);
+            startupTimings_ = timings;
+        }
         state_ = ConnectionState::Connected;
     } catch (...) {
+        timings.totalMs = elapsedMs(startedAt);
+        {
+            std::lock_guard<std::mutex> lock(timingsMutex_);
+            startupTimings_ = timings;
+        }
         state_ = ConnectionState::Error;
         throw;
     }
 }
 
+/// Wait for a start in progress to finish and reap its thread, so stop()
+/// does not tear down a transport that is still being set up.
+void CopilotClient::joinStartup() {
+    std::shared_future<void> pending;
+    {
+        std::lock_guard<std::mutex> lock(startMutex_);
+        pending = startFuture_;
+    }
+    if (pending.valid()) pending.wait();
+
+    std::lock_guard<std::mutex> lock(startMutex_);
+    if (startThread_.joinable()) startThread_.join();
+}
+
 std::vector<std::string> CopilotClient::stop() {
     std::vector<std::string> errors;
 
+    // Stop health checks first so no restart begins during teardown
+    if (health_) health_->stop();
+    interruptRecovery();
+    joinStartup();
+
+    // Fail sends still waiting for admission before sessions free their slots
+    if (admission_) admission_->reset();
+
     // Destroy all active sessions
     std::vector<std::shared_ptr<CopilotSession>> sessionList;
     {
@@ -108,9 +252,15 @@ std::vector<std::string> CopilotClient::stop() {
         sessions_.clear();
     }
 
+    // End the replay stream, or the CLI process (only if we spawned it), so
+    // the reader thread sees EOF before the JSON-RPC client joins it
+    if (replayer_) replayer_->finish();
+    if (!isExternalServer_) stopServerProcess(true);
+
     // Stop JSON-RPC client
     if (rpcClient_) {
         rpcClient_->stop();
+        stopDiskCache();
         rpcClient_.reset();
     }
 
@@ -120,42 +270,36 @@ std::vector<std::string> CopilotClient::stop() {
         modelsCache_.reset();
     }
 
-    // Kill CLI process (only if we spawned it)
-    if (!isExternalServer_) {
-#ifdef _WIN32
-        if (processHandle_) {
-            TerminateProcess(processHandle_, 0);
-            CloseHandle(processHandle_);
-            processHandle_ = nullptr;
-        }
-        if (stdinWrite_) { CloseHandle(stdinWrite_); stdinWrite_ = nullptr; }
-        if (stdoutRead_) { CloseHandle(stdoutRead_); stdoutRead_ = nullptr; }
-#else
-        if (processPid_ > 0) {
-            kill(processPid_, SIGTERM);
-            int status;
-            waitpid(processPid_, &status, 0);
-            processPid_ = -1;
-        }
-        if (stdinWriteFd_ >= 0) { close(stdinWriteFd_); stdinWriteFd_ = -1; }
-        if (stdoutReadFd_ >= 0) { close(stdoutReadFd_); stdoutReadFd_ = -1; }
-#endif
-    }
+    if (!isExternalServer_) closeServerPipes();
+    replayer_.reset();
 
     state_ = ConnectionState::Disconnected;
     return errors;
 }
 
 void CopilotClient::forceStop() {
+    if (health_) health_->stop();
+    interruptRecovery();
+    joinStartup();
+
+    // Fail sends still waiting for admission
+    if (admission_) admission_->reset();
+
     // Clear sessions immediately
     {
         std::lock_guard<std::mutex> lock(sessionsMutex_);
         sessions_.clear();
     }
 
+    // End the replay stream, or the CLI process (only if we spawned it), so
+    // the reader thread sees EOF before the JSON-RPC client joins it
+    if (replayer_) replayer_->finish();
+    if (!isExternalServer_) stopServerProcess(false);
+
     // Stop JSON-RPC client
     if (rpcClient_) {
         rpcClient_->stop();
+        stopDiskCache();
         rpcClient_.reset();
     }
 
@@ -165,27 +309,8 @@ void CopilotClient::forceStop() {
         modelsCache_.reset();
     }
 
-    // Kill process
-    if (!isExternalServer_) {
-#ifdef _WIN32
-        if (processHandle_) {
-            TerminateProcess(processHandle_, 0);
-            CloseHandle(processHandle_);
-            processHandle_ = nullptr;
-        }
-        if (stdinWrite_) { CloseHandle(stdinWrite_); stdinWrite_ = nullptr; }
-        if (stdoutRead_) { CloseHandle(stdoutRead_); stdoutRead_ = nullptr; }
-#else
-        if (processPid_ > 0) {
-            kill(processPid_, SIGKILL);
-            int status;
-            waitpid(processPid_, &status, WNOHANG);
-            processPid_ = -1;
-        }
-        if (stdinWriteFd_ >= 0) { close(stdinWriteFd_); stdinWriteFd_ = -1; }
-        if (stdoutReadFd_ >= 0) { close(stdoutReadFd_); stdoutReadFd_ = -1; }
-#endif
-    }
+    if (!isExternalServer_) closeServerPipes();
+    replayer_.reset();
 
     state_ = ConnectionState::Disconnected;
 }
@@ -195,14 +320,29 @@ void CopilotClient::forceStop() {
 // ============================================================================
 
 void CopilotClient::ensureConnected() {
-    if (rpcClient_) return;
-    if (options_.autoStart) {
-        start();
+    if (state_ == ConnectionState::Connected) return;
+    if (options_.autoStart || state_ == ConnectionState::Connecting) {
+        // Joins a start already in progress instead of racing it
+        startAsync().get();
     } else {
         throw std::runtime_error("Client not connected. Call start() first.");
     }
 }
 
+/// Like ensureConnected(), but never starts the client: waits for a start in
+/// progress and throws if the client is not connected afterwards.
+void CopilotClient::requireConnected() {
+    if (state_ == ConnectionState::Connected) return;
+
+    std::shared_future<void> pending;
+    {
+        std::lock_guard<std::mutex> lock(startMutex_);
+        if (state_ == ConnectionState::Connecting) pending = startFuture_;
+    }
+    if (pending.valid()) pending.get();
+    if (state_ != ConnectionState::Connected) throw std::runtime_error("Client not connected");
+}
+
 std::shared_ptr<CopilotSession> CopilotClient::createSession(const SessionConfig& config) {
     ensureConnected();
 
@@ -213,7 +353,10 @@ std::shared_ptr<CopilotSession> CopilotClient::createSession(const SessionConfig
     std::string wp = result.value("workspacePath", "");
 
     auto session = std::shared_ptr<CopilotSession>(
-        new CopilotSession(sid, rpcClient_.get(), wp));
+        new CopilotSession(sid, rpcClient_.get(), wp, admission_.get(), config.tag,
+                           config.priority));
+    session->resumeParams_ = params;
+    session->resumeParams_["sessionId"] = sid;
 
     session->registerTools(config.tools);
     if (config.onPermissionRequest) {
@@ -245,7 +388,10 @@ std::shared_ptr<CopilotSession> CopilotClient::resumeSession(
     std::string wp = result.value("workspacePath", "");
 
     auto session = std::shared_ptr<CopilotSession>(
-        new CopilotSession(sid, rpcClient_.get(), wp));
+        new CopilotSession(sid, rpcClient_.get(), wp, admission_.get(), config.tag,
+                           config.priority));
+    session->resumeParams_ = params;
+    session->resumeParams_["sessionId"] = sid;
 
     session->registerTools(config.tools);
     if (config.onPermissionRequest) {
@@ -275,32 +421,31 @@ ConnectionState CopilotClient::getState() const {
 // ============================================================================
 
 PingResponse CopilotClient::ping(const std::string& message) {
-    if (!rpcClient_) throw std::runtime_error("Client not connected");
+    requireConnected();
     auto result = rpcClient_->request("ping", {{"message", message}});
     return result.get<PingResponse>();
 }
 
 GetStatusResponse CopilotClient::getStatus() {
-    if (!rpcClient_) throw std::runtime_error("Client not connected");
-    auto result = rpcClient_->request("status.get", nlohmann::json::object());
-    return result.get<GetStatusResponse>();
+    requireConnected();
+    return cachedRequest("status.get").get<GetStatusResponse>();
 }
 
 GetAuthStatusResponse CopilotClient::getAuthStatus() {
-    if (!rpcClient_) throw std::runtime_error("Client not connected");
+    requireConnected();
     auto result = rpcClient_->request("auth.getStatus", nlohmann::json::object());
     return result.get<GetAuthStatusResponse>();
 }
 
 std::vector<ModelInfo> CopilotClient::listModels() {
-    if (!rpcClient_) throw std::runtime_error("Client not connected");
+    requireConnected();
 
     std::lock_guard<std::mutex> lock(modelsCacheMutex_);
     if (modelsCache_) {
         return *modelsCache_;
     }
 
-    auto result = rpcClient_->request("models.list", nlohmann::json::object());
+    auto result = cachedRequest("models.list");
     std::vector<ModelInfo> models;
     if (result.contains("models")) {
         models = result["models"].get<std::vector<ModelInfo>>();
@@ -310,7 +455,7 @@ std::vector<ModelInfo> CopilotClient::listModels() {
 }
 
 std::optional<std::string> CopilotClient::getLastSessionId() {
-    if (!rpcClient_) throw std::runtime_error("Client not connected");
+    requireConnected();
     auto result = rpcClient_->request("session.getLastId", nlohmann::json::object());
     if (result.contains("sessionId") && !result["sessionId"].is_null()) {
         return result["sessionId"].get<std::string>();
@@ -319,7 +464,7 @@ std::optional<std::string> CopilotClient::getLastSessionId() {
 }
 
 void CopilotClient::deleteSession(const std::string& sessionId) {
-    if (!rpcClient_) throw std::runtime_error("Client not connected");
+    requireConnected();
     auto result = rpcClient_->request("session.delete", {{"sessionId", sessionId}});
     bool success = result.value("success", false);
     if (!success) {
@@ -331,8 +476,8 @@ void CopilotClient::deleteSession(const std::string& sessionId) {
 }
 
 std::vector<SessionMetadata> CopilotClient::listSessions() {
-    if (!rpcClient_) throw std::runtime_error("Client not connected");
-    auto result = rpcClient_->request("session.list", nlohmann::json::object());
+    requireConnected();
+    auto result = cachedRequest("session.list");
     std::vector<SessionMetadata> sessions;
     if (result.contains("sessions")) {
         sessions = result["sessions"].get<std::vector<SessionMetadata>>();
@@ -341,7 +486,7 @@ std::vector<SessionMetadata> CopilotClient::listSessions() {
 }
 
 std::optional<std::string> CopilotClient::getForegroundSessionId() {
-    if (!rpcClient_) throw std::runtime_error("Client not connected");
+    requireConnected();
     auto result = rpcClient_->request("session.getForeground", nlohmann::json::object());
     if (result.contains("sessionId") && !result["sessionId"].is_null()) {
         return result["sessionId"].get<std::string>();
@@ -350,7 +495,7 @@ std::optional<std::string> CopilotClient::getForegroundSessionId() {
 }
 
 void CopilotClient::setForegroundSessionId(const std::string& sessionId) {
-    if (!rpcClient_) throw std::runtime_error("Client not connected");
+    requireConnected();
     auto result = rpcClient_->request("session.setForeground", {{"sessionId", sessionId}});
     bool success = result.value("success", false);
     if (!success) {
@@ -390,12 +535,559 @@ std::function<void()> CopilotClient::onLifecycle(const std::string& eventType,
     };
 }
 
+// ============================================================================
+// Admission Control
+// ============================================================================
+
+AdmissionStats CopilotClient::admissionStats() const {
+    return admission_ ? admission_->stats() : AdmissionStats{};
+}
+
+std::map<Priority, PriorityLatencyStats> CopilotClient::rpcLatencyStats() const {
+    return rpcClient_ ? rpcClient_->priorityStats() : std::map<Priority, PriorityLatencyStats>{};
+}
+
+// ============================================================================
+// Connection Health
+// ============================================================================
+
+std::function<void()> CopilotClient::onHealth(HealthHandler handler) {
+    std::lock_guard<std::mutex> lock(healthMutex_);
+    uint64_t id = nextHealthId_++;
+    healthHandlers_.push_back({id, std::move(handler)});
+    return [this, id]() {
+        std::lock_guard<std::mutex> lock(healthMutex_);
+        healthHandlers_.erase(
+            std::remove_if(healthHandlers_.begin(), healthHandlers_.end(),
+                [id](const HealthEntry& e) { return e.id == id; }),
+            healthHandlers_.end());
+    };
+}
+
+HealthStats CopilotClient::healthStats() const {
+    return health_ ? health_->stats() : HealthStats{};
+}
+
+/// Runs on the monitor thread. A spawned server that turned unhealthy is
+/// restarted if autoRestart is set; otherwise pending requests fail at once
+/// and the hung server is ended, so the next start finds nothing left over.
+void CopilotClient::handleHealthChange(const HealthEvent& event) {
+    std::vector<HealthHandler> handlers;
+    {
+        std::lock_guard<std::mutex> lock(healthMutex_);
+        for (const auto& entry : healthHandlers_) handlers.push_back(entry.fn);
+    }
+    for (const auto& handler : handlers) {
+        try {
+            handler(event);
+        } catch (...) {}
+    }
+
+    if (event.healthy || state_ != ConnectionState::Connected) return;
+    if (canRestart()) {
+        beginRecovery("Connection unhealthy: " + event.reason);
+        health_->recordRestart();
+    } else {
+        std::string reason = "Connection unhealthy: " + event.reason;
+        rpcClient_->failPending(reason);
+        if (!isExternalServer_) {
+            // Held off a start until the old process, reader and pipes are gone
+            std::lock_guard<std::mutex> lock(startMutex_);
+            detachTransport();
+            rpcClient_->releaseHeld();
+        }
+        state_ = ConnectionState::Error;
+    }
+}
+
+// ============================================================================
+// Crash Recovery
+// ============================================================================
+
+namespace {
+
+// Read-only methods that are safe to send again after a restart
+bool isReplayableMethod(const std::string& method) {
+    static const char* const kMethods[] = {
+        "ping", "status.get", "auth.getStatus", "models.list", "session.list",
+        "session.getLastId", "session.getMessages", "session.getForeground",
+    };
+    return std::find(std::begin(kMethods), std::end(kMethods), method) != std::end(kMethods);
+}
+
+// Bound on each request that restores the connection, so a replacement
+// server that hangs counts as a failed attempt
+constexpr std::chrono::seconds kRecoveryRequestTimeout{10};
+
+// How long a stopping CLI gets to exit after each signal
+constexpr std::chrono::milliseconds kStopGracePeriod{5000};
+
+} // namespace
+
+RestartStats CopilotClient::restartStats() const {
+    std::lock_guard<std::mutex> lock(restartMutex_);
+    return restartStats_;
+}
+
+bool CopilotClient::canRestart() const {
+    return options_.autoRestart && !isExternalServer_ && !options_.replay;
+}
+
+bool CopilotClient::isStopping() const {
+    std::lock_guard<std::mutex> lock(restartMutex_);
+    return stopping_;
+}
+
+/// Runs on the reader thread when the server closes the stream.
+void CopilotClient::handleConnectionClosed() {
+    connectionLost("Connection to the CLI server was closed");
+}
+
+/// Runs on the supervisor thread once the spawned CLI has been reaped.
+/// Usually beats the reader to EOF, and names the exit code or signal.
+void CopilotClient::handleProcessExit(const ProcessExit& exit) {
+    {
+        std::lock_guard<std::mutex> lock(processMutex_);
+        lastExit_ = exit;
+    }
+    // During startup the reader handles it: rpcClient_ may not exist yet
+    if (state_ != ConnectionState::Connected) return;
+
+    std::string reason = "CLI server exited";
+    if (exit.exitCode) reason += " with code " + std::to_string(*exit.exitCode);
+    if (exit.signal) reason += " on signal " + std::to_string(*exit.signal);
+    connectionLost(reason);
+}
+
+void CopilotClient::connectionLost(const std::string& reason) {
+    // Lost under a recovery in progress: its own requests time out. During
+    // stop the process is ended on purpose.
+    if (recovering_ || isStopping()) return;
+
+    if (state_ == ConnectionState::Connected && canRestart()) {
+        beginRecovery(reason);
+        return;
+    }
+    // Nothing will answer; during startup this fails the version check
+    if (state_ == ConnectionState::Connected) state_ = ConnectionState::Error;
+    rpcClient_->failPending(reason);
+}
+
+/// Start recovering on startThread_. Calls made meanwhile wait for it as
+/// they would for a start.
+void CopilotClient::beginRecovery(const std::string& reason) {
+    std::lock_guard<std::mutex> lock(startMutex_);
+    if (state_ != ConnectionState::Connected) return;
+    if (startThread_.joinable()) startThread_.join();
+    recovering_ = true;
+    launchStart([this, reason] { recoverConnection(reason); });
+}
+
+/// Replace the spawned CLI server. The old process is killed first (it may
+/// be hung) so the reader sees EOF and no write stays blocked on it. The
+/// JsonRpcClient is kept, so sessions and handlers stay valid; requests are
+/// held until the new server is verified and the sessions are resumed.
+void CopilotClient::recoverConnection(const std::string& reason) {
+    using Clock = std::chrono::steady_clock;
+    auto detectedAt = Clock::now();
+
+    stopServerProcess(false);
+    size_t lost = rpcClient_->suspend(isReplayableMethod);
+    closeServerPipes();
+    {
+        std::lock_guard<std::mutex> lock(restartMutex_);
+        restartStats_.failedRequests += lost;
+        restartStats_.lastReason = reason;
+    }
+
+    int backoffMs = options_.restartBackoffMs;
+    for (int attempt = 1;; ++attempt) {
+        if (!waitRestartBackoff(backoffMs)) {
+            recovering_ = false;
+            state_ = ConnectionState::Error;
+            rpcClient_->failPending("Client stopped while restarting the CLI server",
+                                    RpcError::Kind::Stopped);
+            throw std::runtime_error("Client stopped while restarting the CLI server");
+        }
+        try {
+            startCLIServer();
+            int readFd, writeFd;
+            openTransport(readFd, writeFd);
+            rpcClient_->reattach(readFd, writeFd);
+            verifyProtocolVersion(rpcClient_->recoveryRequest(
+                "ping", {{"message", ""}}, kRecoveryRequestTimeout).get<PingResponse>());
+            resumeSessions();
+            break;
+        } catch (const std::exception& e) {
+            stopServerProcess(false);
+            rpcClient_->suspend(isReplayableMethod);
+            closeServerPipes();
+            {
+                std::lock_guard<std::mutex> lock(restartMutex_);
+                restartStats_.failedAttempts++;
+            }
+            if (attempt >= options_.maxRestartAttempts) {
+                recovering_ = false;
+                state_ = ConnectionState::Error;
+                rpcClient_->failPending(std::string("CLI server could not be restarted: ") + e.what());
+                rpcClient_->releaseHeld();
+                throw;
+            }
+            backoffMs = std::min(backoffMs * 2, options_.maxRestartBackoffMs);
+        }
+    }
+
+    size_t replayed = rpcClient_->releaseHeld();
+    {
+        std::lock_guard<std::mutex> lock(restartMutex_);
+        restartStats_.restarts++;
+        restartStats_.lastRecoveryMs =
+            std::chrono::duration<double, std::milli>(Clock::now() - detectedAt).count();
+        restartStats_.replayedRequests += replayed;
+    }
+    recovering_ = false;
+    state_ = ConnectionState::Connected;
+}
+
+/// session.resume every live session on the new server. A session that
+/// cannot be resumed, and every turn that was in progress, gets a
+/// session.error event.
+void CopilotClient::resumeSessions() {
+    std::vector<std::shared_ptr<CopilotSession>> live;
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex_);
+        for (auto& [id, session] : sessions_) live.push_back(session);
+    }
+
+    auto errorEvent = [](const std::string& message) {
+        SessionEvent event;
+        event.type = "session.error";
+        event.data = {{"errorType", "connection"}, {"message", message}};
+        return event;
+    };
+
+    uint64_t resumed = 0;
+    for (auto& session : live) {
+        try {
+            rpcClient_->recoveryRequest("session.resume", session->resumeParams_,
+                                        kRecoveryRequestTimeout);
+            resumed++;
+        } catch (const std::exception& e) {
+            {
+                std::lock_guard<std::mutex> lock(sessionsMutex_);
+                sessions_.erase(session->sessionId);
+            }
+            session->dispatchEvent(errorEvent(
+                std::string("Session could not be resumed after a CLI restart: ") + e.what()));
+            continue;
+        }
+        if (session->turnActive_) {
+            session->dispatchEvent(errorEvent("CLI server restarted; the turn in progress was lost"));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(restartMutex_);
+    restartStats_.resumedSessions += resumed;
+}
+
+/// Sleep before a restart attempt. Returns false if the client is stopping.
+bool CopilotClient::waitRestartBackoff(int ms) {
+    std::unique_lock<std::mutex> lock(restartMutex_);
+    restartStats_.lastBackoffMs = ms;
+    restartCv_.wait_for(lock, std::chrono::milliseconds(ms), [this] { return stopping_; });
+    return !stopping_;
+}
+
+void CopilotClient::interruptRecovery() {
+    {
+        std::lock_guard<std::mutex> lock(restartMutex_);
+        stopping_ = true;
+    }
+    restartCv_.notify_all();
+}
+
+/// End the spawned CLI and wait until it has been reaped: SIGTERM with a
+/// grace period when 'graceful', otherwise SIGKILL at once.
+void CopilotClient::stopServerProcess(bool graceful) {
+#ifdef _WIN32
+    (void)graceful;
+    if (processHandle_) {
+        TerminateProcess(processHandle_, 0);
+        WaitForSingleObject(processHandle_, static_cast<DWORD>(kStopGracePeriod.count()));
+        CloseHandle(processHandle_);
+        processHandle_ = nullptr;
+    }
+#else
+    std::unique_ptr<ProcessSupervisor> supervisor;
+    {
+        std::lock_guard<std::mutex> lock(processMutex_);
+        supervisor = std::move(supervisor_);
+    }
+    if (supervisor) {
+        if (!graceful || !supervisor->signal(SIGTERM) || !supervisor->waitForExit(kStopGracePeriod)) {
+            supervisor->signal(SIGKILL);
+            supervisor->waitForExit(kStopGracePeriod);
+        }
+        auto stats = supervisor->stats();
+        std::lock_guard<std::mutex> lock(processMutex_);
+        if (stats.lastExit) lastExit_ = stats.lastExit;
+    }
+    processPid_ = -1;
+#endif
+}
+
+ProcessStats CopilotClient::processStats() const {
+    std::lock_guard<std::mutex> lock(processMutex_);
+    ProcessStats stats;
+#ifndef _WIN32
+    if (supervisor_) stats = supervisor_->stats();
+#endif
+    if (!stats.lastExit) stats.lastExit = lastExit_;
+    return stats;
+}
+
+std::string CopilotClient::cliStderr() const {
+    return stderrBuffer_ ? stderrBuffer_->contents() : std::string();
+}
+
+void CopilotClient::closeServerPipes() {
+#ifdef _WIN32
+    if (stdinWrite_) { CloseHandle(stdinWrite_); stdinWrite_ = nullptr; }
+    if (stdoutRead_) { CloseHandle(stdoutRead_); stdoutRead_ = nullptr; }
+#else
+    if (stdinWriteFd_ >= 0) { close(stdinWriteFd_); stdinWriteFd_ = -1; }
+    if (stdoutReadFd_ >= 0) { close(stdoutReadFd_); stdoutReadFd_ = -1; }
+#endif
+}
+
+// ============================================================================
+// Batch Prompts
+// ============================================================================
+
+/// Read the items completed by earlier runs. Each checkpoint line is a JSON
+/// object {"index", "content", "attempts", "latencyMs"}; a torn last line from
+/// an interrupted run is skipped and its item is sent again.
+static std::map<size_t, BatchItemResult> loadBatchCheckpoint(const std::string& path, size_t count) {
+    std::map<size_t, BatchItemResult> done;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty()) continue;
+        try {
+            auto j = nlohmann::json::parse(line);
+            BatchItemResult result;
+            result.index = j.at("index").get<size_t>();
+            if (result.index >= count) continue;
+            result.success = true;
+            result.content = j.value("content", "");
+            result.attempts = j.value("attempts", 1);
+            result.latencyMs = j.value("latencyMs", 0.0);
+            result.fromCheckpoint = true;
+            done[result.index] = std::move(result);
+        } catch (const nlohmann::json::exception&) {
+            // Skip malformed line
+        }
+    }
+    return done;
+}
+
+BatchSummary CopilotClient::runBatch(const std::vector<MessageOptions>& prompts,
+                                     const SessionConfig& config, size_t concurrency,
+                                     BatchResultHandler onResult, const BatchOptions& options) {
+    using Clock = std::chrono::steady_clock;
+    auto startedAt = Clock::now();
+    BatchSummary summary;
+
+    std::map<size_t, BatchItemResult> done;
+    std::ofstream checkpoint;
+    if (!options.checkpointPath.empty()) {
+        done = loadBatchCheckpoint(options.checkpointPath, prompts.size());
+        checkpoint.open(options.checkpointPath, std::ios::app);
+        if (!checkpoint) {
+            throw std::runtime_error("Failed to open checkpoint file: " + options.checkpointPath);
+        }
+    }
+
+    // Results are counted, checkpointed and handed to onResult one at a time
+    std::mutex resultMutex;
+    std::exception_ptr handlerError;
+    std::atomic<bool> stopping{false};
+    auto report = [&](const BatchItemResult& result) {
+        std::lock_guard<std::mutex> lock(resultMutex);
+        if (handlerError) return;
+        if (result.fromCheckpoint) {
+            summary.fromCheckpoint++;
+        } else if (result.success) {
+            summary.succeeded++;
+            if (checkpoint.is_open()) {
+                nlohmann::json line = {
+                    {"index", result.index},
+                    {"content", result.content},
+                    {"attempts", result.attempts},
+                    {"latencyMs", result.latencyMs}
+                };
+                checkpoint << line.dump() << '\n' << std::flush;
+            }
+        } else {
+            summary.failed++;
+        }
+        try {
+            if (onResult) onResult(result);
+        } catch (...) {
+            handlerError = std::current_exception();
+            stopping = true;
+        }
+    };
+
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < prompts.size(); ++i) {
+        auto it = done.find(i);
+        if (it != done.end()) {
+            report(it->second);
+        } else {
+            pending.push_back(i);
+        }
+    }
+
+    // Create the pool up front so session.create failures reach the caller
+    std::vector<std::shared_ptr<CopilotSession>> pool;
+    auto retire = [&](const std::shared_ptr<CopilotSession>& session) {
+        try {
+            session->destroy();
+        } catch (...) {
+            // Best-effort cleanup
+        }
+        std::lock_guard<std::mutex> lock(sessionsMutex_);
+        sessions_.erase(session->sessionId);
+    };
+    auto releasePool = [&] {
+        for (auto& session : pool) {
+            if (session) retire(session);
+        }
+    };
+    size_t poolSize = handlerError ? 0 : std::min(std::max<size_t>(concurrency, 1), pending.size());
+    try {
+        for (size_t i = 0; i < poolSize; ++i) pool.push_back(createSession(config));
+    } catch (...) {
+        releasePool();
+        throw;
+    }
+
+    // Counts the session.idle/session.error events of one pool slot, so a
+    // timed-out turn is seen to end before its session takes another prompt
+    struct Settled {
+        std::mutex mutex;
+        std::condition_variable cv;
+        uint64_t count = 0;
+    };
+    auto watch = [](CopilotSession& session, const std::shared_ptr<Settled>& settled) {
+        session.on([settled](const SessionEvent& event) {
+            if (event.type != "session.idle" && event.type != "session.error") return;
+            std::lock_guard<std::mutex> lock(settled->mutex);
+            settled->count++;
+            settled->cv.notify_all();
+        });
+    };
+    std::exception_ptr poolError;
+
+    std::atomic<size_t> next{0};
+    auto worker = [&](std::shared_ptr<CopilotSession>& session) {
+        auto settled = std::make_shared<Settled>();
+        watch(*session, settled);
+
+        // Abort the timed-out turn and wait for it to end, so its late events
+        // cannot complete the next prompt; a session that stays busy is
+        // replaced. False if no replacement could be created.
+        auto settle = [&](uint64_t before) {
+            try {
+                session->abort();
+            } catch (...) {
+                // Best-effort abort; the wait below decides
+            }
+            {
+                std::unique_lock<std::mutex> lock(settled->mutex);
+                if (settled->cv.wait_for(lock, std::chrono::milliseconds(options.timeoutMs),
+                                         [&] { return settled->count > before; })) {
+                    return true;
+                }
+            }
+            retire(session);
+            session.reset();
+            try {
+                session = createSession(config);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(resultMutex);
+                if (!poolError) poolError = std::current_exception();
+                stopping = true;
+                return false;
+            }
+            watch(*session, settled);
+            return true;
+        };
+
+        for (size_t slot; !stopping && (slot = next++) < pending.size();) {
+            BatchItemResult result;
+            result.index = pending[slot];
+            auto itemStart = Clock::now();
+
+            for (int attempt = 1;; ++attempt) {
+                result.attempts = attempt;
+                uint64_t before;
+                {
+                    std::lock_guard<std::mutex> lock(settled->mutex);
+                    before = settled->count;
+                }
+                bool timedOut = false;
+                try {
+                    auto reply = session->trySendAndWait(prompts[result.index], options.timeoutMs);
+                    if (reply) {
+                        if (*reply && (*reply)->data.contains("content") &&
+                            (*reply)->data["content"].is_string()) {
+                            result.content = (*reply)->data["content"].get<std::string>();
+                        }
+                        result.success = true;
+                        break;
+                    }
+                    result.error = reply.error().what();
+                    timedOut = reply.error().kind == RpcError::Kind::Timeout;
+                } catch (const std::exception& e) {
+                    result.error = e.what();
+                }
+                if (timedOut && !settle(before)) break;
+                if (attempt >= options.maxAttempts || stopping) break;
+
+                int shift = std::min(attempt - 1, 10);
+                std::this_thread::sleep_for(std::chrono::milliseconds(
+                    static_cast<int64_t>(options.retryDelayMs) << shift));
+            }
+
+            if (result.success) result.error.clear();
+            result.latencyMs = std::chrono::duration<double, std::milli>(Clock::now() - itemStart).count();
+            report(result);
+            if (!session) break;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (auto& session : pool) {
+        workers.push_back(startThread(options_.threads, "copilot-batch",
+                                      [&worker, &session] { worker(session); }));
+    }
+    for (auto& t : workers) t.join();
+    releasePool();
+
+    if (handlerError) std::rethrow_exception(handlerError);
+    if (poolError) std::rethrow_exception(poolError);
+
+    summary.elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - startedAt).count();
+    return summary;
+}
+
 // ============================================================================
 // Protocol Version Verification
 // ============================================================================
 
-void CopilotClient::verifyProtocolVersion() {
-    auto response = ping();
+void CopilotClient::verifyProtocolVersion(const PingResponse& response) {
     if (!response.protocolVersion) {
         throw std::runtime_error(
             "SDK protocol version mismatch: SDK expects version " +
@@ -413,6 +1105,60 @@ void CopilotClient::verifyProtocolVersion() {
     }
 }
 
+// ============================================================================
+// Disk Cache
+// ============================================================================
+
+/// Result of a parameterless request. With a disk cache, the cached result is
+/// served until the background refresh has run; live results are stored.
+nlohmann::json CopilotClient::cachedRequest(const std::string& method) {
+    if (diskCache_ && !diskCacheRevalidated_) {
+        if (auto cached = diskCache_->get(method)) return *cached;
+    }
+    auto result = rpcClient_->request(method, nlohmann::json::object());
+    if (diskCache_) diskCache_->put(method, result);
+    return result;
+}
+
+/// Refresh the cached results loaded on start. Runs on revalidateThread_ at
+/// batch priority so it does not hold up the caller's own requests.
+void CopilotClient::revalidateDiskCache() {
+    try {
+        bool hadModels = diskCache_->get("models.list").has_value();
+        bool hadSessions = diskCache_->get("session.list").has_value();
+
+        auto status = rpcClient_->request("status.get", nlohmann::json::object(), Priority::Batch);
+        diskCache_->setCliVersion(status.value("version", ""));
+        diskCache_->put("status.get", status);
+
+        // Only refresh what earlier runs asked for
+        if (hadModels) {
+            auto result = rpcClient_->request("models.list", nlohmann::json::object(), Priority::Batch);
+            diskCache_->put("models.list", result);
+            std::vector<ModelInfo> models;
+            if (result.contains("models")) {
+                models = result["models"].get<std::vector<ModelInfo>>();
+            }
+            std::lock_guard<std::mutex> lock(modelsCacheMutex_);
+            modelsCache_ = std::move(models);
+        }
+        if (hadSessions) {
+            auto result = rpcClient_->request("session.list", nlohmann::json::object(), Priority::Batch);
+            diskCache_->put("session.list", result);
+        }
+    } catch (...) {
+        // Stopped or failed; later live calls refresh the cache instead
+    }
+    diskCacheRevalidated_ = true;
+}
+
+/// Join the refresh thread. Called after rpcClient_->stop() has failed its
+/// outstanding requests.
+void CopilotClient::stopDiskCache() {
+    if (revalidateThread_.joinable()) revalidateThread_.join();
+    diskCache_.reset();
+}
+
 // ============================================================================
 // Process Spawning
 // ============================================================================
@@ -446,6 +1192,9 @@ void CopilotClient::startCLIServer() {
     }
 
 #ifdef _WIN32
+    if (options_.processLimits) {
+        throw std::runtime_error("processLimits are not supported on Windows");
+    }
     // Windows: CreateProcess with pipes
     SECURITY_ATTRIBUTES sa;
     sa.nLength = sizeof(SECURITY_ATTRIBUTES);
@@ -526,6 +1275,9 @@ void CopilotClient::startCLIServer() {
 
 #else
     // POSIX: fork + exec with pipes
+    std::optional<LaunchLimits> limits;
+    if (options_.processLimits) limits.emplace(*options_.processLimits);
+
     int stdinPipe[2];
     int stdoutPipe[2];
     int stderrPipe[2];
@@ -553,6 +1305,17 @@ void CopilotClient::startCLIServer() {
         close(stdoutPipe[1]);
         close(stderrPipe[1]);
 
+        if (limits) {
+            if (const char* failure = limits->apply()) {
+                const char prefix[] = "copilot-sdk: ";
+                ssize_t ignored = write(STDERR_FILENO, prefix, sizeof(prefix) - 1);
+                ignored = write(STDERR_FILENO, failure, strlen(failure));
+                ignored = write(STDERR_FILENO, "\n", 1);
+                (void)ignored;
+                _exit(126);
+            }
+        }
+
         if (!options_.cwd.empty()) {
             if (chdir(options_.cwd.c_str()) != 0) {
                 _exit(1);
@@ -578,21 +1341,48 @@ void CopilotClient::startCLIServer() {
     }
 
     // Parent process
+    // A write to a CLI that has exited must fail with EPIPE, not terminate
+    // the application, so the connection can be recovered
+    struct sigaction pipeAction {};
+    if (sigaction(SIGPIPE, nullptr, &pipeAction) == 0 && pipeAction.sa_handler == SIG_DFL) {
+        signal(SIGPIPE, SIG_IGN);
+    }
+
     close(stdinPipe[0]);   // Close read end of stdin
     close(stdoutPipe[1]);  // Close write end of stdout
-    close(stderrPipe[0]);  // Close read end of stderr (don't read it)
-    close(stderrPipe[1]);  // Close write end too
+    close(stderrPipe[1]);  // Close write end of stderr
+
+    // Keep later children (a restarted CLI among them) from holding our ends open
+    fcntl(stdinPipe[1], F_SETFD, FD_CLOEXEC);
+    fcntl(stdoutPipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(stderrPipe[0], F_SETFD, FD_CLOEXEC);
 
     processPid_ = pid;
     stdinWriteFd_ = stdinPipe[1];
     stdoutReadFd_ = stdoutPipe[0];
 
+    // The supervisor reaps the process and drains its stderr
+    std::lock_guard<std::mutex> lock(processMutex_);
+    supervisor_ = std::make_unique<ProcessSupervisor>(
+        pid, stderrPipe[0], stderrBuffer_, options_.onStderr, options_.processSampleIntervalMs,
+        options_.processLimits ? options_.processLimits->cgroup : std::string(),
+        [this](const ProcessExit& exit) { handleProcessExit(exit); }, options_.threads);
+
 #endif
 }
 
-void CopilotClient::connectToServer() {
-    int readFd, writeFd;
+void CopilotClient::startReplay() {
+#ifdef _WIN32
+    throw std::runtime_error("Journal replay is not supported on Windows");
+#else
+    replayer_ = std::make_unique<JournalReplayer>(*options_.replay, options_.threads);
+    stdoutReadFd_ = replayer_->readFd();
+    stdinWriteFd_ = replayer_->writeFd();
+#endif
+}
 
+/// File descriptors of the CLI server's stdout and stdin.
+void CopilotClient::openTransport(int& readFd, int& writeFd) {
 #ifdef _WIN32
     readFd = _open_osfhandle(reinterpret_cast<intptr_t>(stdoutRead_), 0);
     writeFd = _open_osfhandle(reinterpret_cast<intptr_t>(stdinWrite_), 0);
@@ -603,21 +1393,53 @@ void CopilotClient::connectToServer() {
     readFd = stdoutReadFd_;
     writeFd = stdinWriteFd_;
 #endif
+}
+
+void CopilotClient::connectToServer() {
+    int readFd, writeFd;
+    openTransport(readFd, writeFd);
+
+    if (rpcClient_) {
+        // Reconnecting after detachTransport(); handlers are already in place
+        rpcClient_->reattach(readFd, writeFd);
+        rpcClient_->releaseHeld();
+        return;
+    }
 
-    rpcClient_ = std::make_unique<JsonRpcClient>(readFd, writeFd);
+    rpcClient_ = std::make_unique<JsonRpcClient>(readFd, writeFd, options_.threads);
+    rpcClient_->setPriorityStarvationMs(options_.priorityStarvationMs);
+    rpcClient_->setPayloadExtraction(options_.payloadExtractionThreshold);
+    if (!options_.journalPath.empty()) {
+        rpcClient_->setJournal(std::make_shared<JournalWriter>(options_.journalPath, options_.threads));
+    }
     setupHandlers();
+    rpcClient_->setCloseHandler([this] { handleConnectionClosed(); });
     rpcClient_->start();
 }
 
+/// Take down the transport a connection in Error left behind, keeping
+/// rpcClient_ itself: sessions hold raw pointers to it. The server (or replay
+/// stream) is ended first so the reader sees EOF; requests still waiting on
+/// the old connection fail, and new ones are held until connectToServer().
+void CopilotClient::detachTransport() {
+    if (replayer_) replayer_->finish();
+    if (!isExternalServer_) stopServerProcess(false);
+    rpcClient_->suspend([](const std::string&) { return false; });
+    rpcClient_->failPending("Connection to the CLI server was lost");
+    if (!isExternalServer_) closeServerPipes();
+    replayer_.reset();
+}
+
 // ============================================================================
 // Handler Setup
 // ============================================================================
 
 void CopilotClient::setupHandlers() {
     // session.event - notification (no response expected)
-    rpcClient_->setRequestHandler("session.event",
-        [this](const nlohmann::json& params) -> std::pair<nlohmann::json, std::optional<JsonRpcError>> {
-            handleSessionEvent(params);
+    rpcClient_->setPayloadRequestHandler("session.event",
+        [this](const nlohmann::json& params, const std::vector<Base64Span>& payloads)
+            -> std::pair<nlohmann::json, std::optional<JsonRpcError>> {
+            handleSessionEvent(params, payloads);
             return {nullptr, std::nullopt};
         });
 
@@ -649,11 +1471,13 @@ void CopilotClient::setupHandlers() {
 // Server Request Handlers
 // ============================================================================
 
-void CopilotClient::handleSessionEvent(const nlohmann::json& params) {
+void CopilotClient::handleSessionEvent(const nlohmann::json& params,
+                                       const std::vector<Base64Span>& payloads) {
     if (!params.contains("sessionId") || !params.contains("event")) return;
 
     std::string sid = params["sessionId"].get<std::string>();
     SessionEvent event = params["event"].get<SessionEvent>();
+    event.payloads = payloads;
 
     std::shared_ptr<CopilotSession> session;
     {
@@ -694,7 +1518,7 @@ CopilotClient::handleToolCall(const nlohmann::json& params) {
     std::string toolName = params.value("toolName", "");
 
     if (sid.empty() || toolCallId.empty() || toolName.empty()) {
-        return {nullptr, JsonRpcError{-32602, "Invalid tool call payload"}};
+        return {nullptr, JsonRpcError{-32602, "Invalid tool call payload", nullptr}};
     }
 
     std::shared_ptr<CopilotSession> session;
@@ -705,7 +1529,7 @@ CopilotClient::handleToolCall(const nlohmann::json& params) {
     }
 
     if (!session) {
-        return {nullptr, JsonRpcError{-32602, "Unknown session " + sid}};
+        return {nullptr, JsonRpcError{-32602, "Unknown session " + sid, nullptr}};
     }
 
     auto handler = session->getToolHandler(toolName);
@@ -728,7 +1552,7 @@ std::pair<nlohmann::json, std::optional<JsonRpcError>>
 CopilotClient::handlePermissionRequest(const nlohmann::json& params) {
     std::string sid = params.value("sessionId", "");
     if (sid.empty() || !params.contains("permissionRequest")) {
-        return {nullptr, JsonRpcError{-32602, "Invalid permission request payload"}};
+        return {nullptr, JsonRpcError{-32602, "Invalid permission request payload", nullptr}};
     }
 
     std::shared_ptr<CopilotSession> session;
@@ -739,7 +1563,7 @@ CopilotClient::handlePermissionRequest(const nlohmann::json& params) {
     }
 
     if (!session) {
-        return {nullptr, JsonRpcError{-32602, "Session not found: " + sid}};
+        return {nullptr, JsonRpcError{-32602, "Session not found: " + sid, nullptr}};
     }
 
     try {
@@ -751,7 +1575,7 @@ CopilotClient::handlePermissionRequest(const nlohmann::json& params) {
     } catch (...) {
         nlohmann::json response;
         response["result"] = PermissionRequestResult{
-            "denied-no-approval-rule-and-could-not-request-from-user"};
+            "denied-no-approval-rule-and-could-not-request-from-user", std::nullopt};
         return {response, std::nullopt};
     }
 }
@@ -762,7 +1586,7 @@ CopilotClient::handleUserInputRequest(const nlohmann::json& params) {
     std::string question = params.value("question", "");
 
     if (sid.empty() || question.empty()) {
-        return {nullptr, JsonRpcError{-32602, "Invalid user input request payload"}};
+        return {nullptr, JsonRpcError{-32602, "Invalid user input request payload", nullptr}};
     }
 
     std::shared_ptr<CopilotSession> session;
@@ -773,7 +1597,7 @@ CopilotClient::handleUserInputRequest(const nlohmann::json& params) {
     }
 
     if (!session) {
-        return {nullptr, JsonRpcError{-32602, "Session not found: " + sid}};
+        return {nullptr, JsonRpcError{-32602, "Session not found: " + sid, nullptr}};
     }
 
     try {
@@ -785,7 +1609,7 @@ CopilotClient::handleUserInputRequest(const nlohmann::json& params) {
         auto response = session->handleUserInputRequest(req);
         return {response, std::nullopt};
     } catch (const std::exception& e) {
-        return {nullptr, JsonRpcError{-32603, e.what()}};
+        return {nullptr, JsonRpcError{-32603, e.what(), nullptr}};
     }
 }
 
@@ -795,7 +1619,7 @@ CopilotClient::handleHooksInvoke(const nlohmann::json& params) {
     std::string hookType = params.value("hookType", "");
 
     if (sid.empty() || hookType.empty()) {
-        return {nullptr, JsonRpcError{-32602, "Invalid hooks invoke payload"}};
+        return {nullptr, JsonRpcError{-32602, "Invalid hooks invoke payload", nullptr}};
     }
 
     std::shared_ptr<CopilotSession> session;
@@ -806,7 +1630,7 @@ CopilotClient::handleHooksInvoke(const nlohmann::json& params) {
     }
 
     if (!session) {
-        return {nullptr, JsonRpcError{-32602, "Session not found: " + sid}};
+        return {nullptr, JsonRpcError{-32602, "Session not found: " + sid, nullptr}};
     }
 
     nlohmann::json input = params.contains("input") ? params["input"] : nlohmann::json::object();
@@ -0,0 +1,168 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Microsoft Corporation. All rights reserved.
+ *--------------------------------------------------------------------------------------------*/
+
+#include "copilot/disk_cache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string_view>
+#include <vector>
+
+#include "copilot/sdk_protocol_version.h"
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace copilot {
+
+static constexpr int kCacheFormat = 1;
+
+DiskCache::DiskCache(std::string path) : path_(std::move(path)) {}
+
+// ============================================================================
+// Load
+// ============================================================================
+
+/// Parse the cache document from a mapped (or read) file image.
+static std::optional<nlohmann::json> parseCacheFile(std::string_view text) {
+    auto doc = nlohmann::json::parse(text.begin(), text.end(), nullptr, false);
+    if (doc.is_discarded() || !doc.is_object()) return std::nullopt;
+    if (doc.value("format", 0) != kCacheFormat) return std::nullopt;
+    if (doc.value("protocolVersion", 0) != SDK_PROTOCOL_VERSION) return std::nullopt;
+    return doc;
+}
+
+bool DiskCache::load() {
+    std::optional<nlohmann::json> doc;
+
+#ifdef _WIN32
+    std::FILE* file = std::fopen(path_.c_str(), "rb");
+    if (!file) return false;
+    std::string text;
+    char chunk[16 * 1024];
+    for (size_t n; (n = std::fread(chunk, 1, sizeof(chunk), file)) > 0;) {
+        text.append(chunk, n);
+    }
+    std::fclose(file);
+    doc = parseCacheFile(text);
+#else
+    int fd = ::open(path_.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) return false;
+    doc = parseCacheFile(std::string_view(static_cast<const char*>(mapping), size));
+    munmap(mapping, size);
+#endif
+
+    if (!doc) return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    cliVersion_ = doc->value("cliVersion", "");
+    entries_.clear();
+    if (doc->contains("entries") && (*doc)["entries"].is_object()) {
+        for (auto& [method, entry] : (*doc)["entries"].items()) {
+            if (entry.is_object() && entry.contains("result")) {
+                entries_[method] = std::move(entry);
+            }
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// Access
+// ============================================================================
+
+std::string DiskCache::cliVersion() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cliVersion_;
+}
+
+void DiskCache::setCliVersion(const std::string& version) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (version == cliVersion_) return;
+
+    // Entries stored before any version was known belong to this CLI
+    if (!cliVersion_.empty()) entries_.clear();
+    cliVersion_ = version;
+    save();
+}
+
+std::optional<nlohmann::json> DiskCache::get(const std::string& method) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(method);
+    if (it == entries_.end()) return std::nullopt;
+    return it->second.at("result");
+}
+
+void DiskCache::put(const std::string& method, const nlohmann::json& result) {
+    auto storedAt = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Live calls after revalidation mostly return what is already cached;
+    // only a changed result is worth rewriting and fsyncing the file for
+    auto it = entries_.find(method);
+    if (it != entries_.end() && it->second.at("result") == result) return;
+
+    entries_[method] = {{"result", result}, {"storedAt", storedAt}};
+    save();
+}
+
+// ============================================================================
+// Save
+// ============================================================================
+
+/// Write the document to a temporary file next to the cache and rename it
+/// over the cache, so readers see either the old or the new file. Called
+/// with mutex_ held.
+bool DiskCache::save() {
+    nlohmann::json doc = {
+        {"format", kCacheFormat},
+        {"protocolVersion", SDK_PROTOCOL_VERSION},
+        {"cliVersion", cliVersion_},
+        {"entries", entries_}
+    };
+    std::string text = doc.dump();
+
+#ifdef _WIN32
+    std::string tmpPath = path_ + ".tmp" + std::to_string(_getpid());
+#else
+    std::string tmpPath = path_ + ".tmp" + std::to_string(getpid());
+#endif
+    std::FILE* file = std::fopen(tmpPath.c_str(), "wb");
+    if (!file) return false;
+
+    bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+    ok = std::fflush(file) == 0 && ok;
+#ifndef _WIN32
+    ok = fsync(fileno(file)) == 0 && ok;
+#endif
+    std::fclose(file);
+
+#ifdef _WIN32
+    // rename() does not replace an existing file on Windows
+    if (ok) std::remove(path_.c_str());
+#endif
+    if (!ok || std::rename(tmpPath.c_str(), path_.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace copilot
@@ -0,0 +1,138 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Microsoft Corporation. All rights reserved.
+ *--------------------------------------------------------------------------------------------*/
+
+#include "copilot/health.h"
+#include "copilot/threads.h"
+
+#include <algorithm>
+#include <exception>
+
+namespace copilot {
+
+namespace {
+constexpr double kLatencyEwmaAlpha = 0.2;
+}
+
+// ============================================================================
+// Construction / Lifecycle
+// ============================================================================
+
+HealthMonitor::HealthMonitor(const HealthOptions& options, Probe probe, StallCheck stallCheck,
+                             HealthHandler onChange, ThreadOptions threads)
+    : options_(options), probe_(std::move(probe)), stallCheck_(std::move(stallCheck)),
+      onChange_(std::move(onChange)), threads_(std::move(threads)) {}
+
+HealthMonitor::~HealthMonitor() {
+    stop();
+}
+
+void HealthMonitor::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return;
+    running_ = true;
+    thread_ = startThread(threads_, "copilot-health", [this] { run(); });
+}
+
+void HealthMonitor::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+void HealthMonitor::recordRestart() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.restarts++;
+    stats_.consecutiveFailures = 0;
+}
+
+HealthStats HealthMonitor::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+// ============================================================================
+// Monitor Loop
+// ============================================================================
+
+void HealthMonitor::run() {
+    auto interval = std::chrono::milliseconds(std::max(1, options_.intervalMs));
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        if (cv_.wait_for(lock, interval, [this] { return !running_; })) break;
+        lock.unlock();
+        check();
+        lock.lock();
+    }
+}
+
+/// One round: a stalled transport is unhealthy at once (a ping would only
+/// queue behind it); otherwise ping and count a failure on error or timeout.
+void HealthMonitor::check() {
+    std::string stall = stallCheck_(std::chrono::milliseconds(options_.stallMs));
+    if (!stall.empty()) {
+        recordFailure(stall, true);
+        return;
+    }
+
+    auto sentAt = Clock::now();
+    try {
+        if (!probe_(std::chrono::milliseconds(options_.timeoutMs))) return;
+    } catch (const std::exception& e) {
+        recordFailure(e.what(), false);
+        return;
+    } catch (...) {
+        recordFailure("ping failed", false);
+        return;
+    }
+    recordLatency(std::chrono::duration<double, std::milli>(Clock::now() - sentAt).count());
+}
+
+void HealthMonitor::recordLatency(double ms) {
+    bool recovered;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.pings++;
+        stats_.lastLatencyMs = ms;
+        stats_.ewmaLatencyMs = stats_.pings == 1
+            ? ms : kLatencyEwmaAlpha * ms + (1 - kLatencyEwmaAlpha) * stats_.ewmaLatencyMs;
+        stats_.maxLatencyMs = std::max(stats_.maxLatencyMs, ms);
+        auto bucket = std::lower_bound(kHealthLatencyBoundsMs.begin(), kHealthLatencyBoundsMs.end(), ms);
+        stats_.latencyHistogram[bucket - kHealthLatencyBoundsMs.begin()]++;
+        stats_.consecutiveFailures = 0;
+        recovered = !stats_.healthy;
+        stats_.healthy = true;
+    }
+    if (recovered) report(true, "");
+}
+
+void HealthMonitor::recordFailure(const std::string& reason, bool immediate) {
+    bool turnedUnhealthy;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.failures++;
+        stats_.consecutiveFailures++;
+        turnedUnhealthy = stats_.healthy &&
+            (immediate || stats_.consecutiveFailures >= options_.failureThreshold);
+        if (turnedUnhealthy) stats_.healthy = false;
+    }
+    if (turnedUnhealthy) report(false, reason);
+}
+
+void HealthMonitor::report(bool healthy, const std::string& reason) {
+    if (!onChange_) return;
+    HealthEvent event;
+    event.healthy = healthy;
+    event.reason = reason;
+    event.stats = stats();
+    try {
+        onChange_(event);
+    } catch (...) {
+        // Keep monitoring regardless of the handler
+    }
+}
+
+} // namespace copilot
@@ -0,0 +1,386 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Microsoft Corporation. All rights reserved.
+ *--------------------------------------------------------------------------------------------*/
+
+#include "copilot/journal.h"
+#include "copilot/threads.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#define COPILOT_READ(fd, buf, len)  _read(fd, buf, static_cast<unsigned int>(len))
+#define COPILOT_WRITE(fd, buf, len) _write(fd, buf, static_cast<unsigned int>(len))
+#define COPILOT_CLOSE(fd)           _close(fd)
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define COPILOT_READ(fd, buf, len)  ::read(fd, buf, len)
+#define COPILOT_WRITE(fd, buf, len) ::write(fd, buf, len)
+#define COPILOT_CLOSE(fd)           ::close(fd)
+#endif
+
+namespace copilot {
+
+static constexpr char kJournalMagic[8] = {'C', 'P', 'J', 'R', 'N', 'L', '\0', '\0'};
+static constexpr uint32_t kJournalVersion = 1;
+
+static size_t paddedSize(size_t size) {
+    return (size + 7) & ~size_t(7);
+}
+
+// ============================================================================
+// JournalWriter
+// ============================================================================
+
+JournalWriter::JournalWriter(const std::string& path, const ThreadOptions& threads) {
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) {
+        throw std::runtime_error("Failed to open journal " + path + ": " + std::strerror(errno));
+    }
+
+    start_ = std::chrono::steady_clock::now();
+    JournalFileHeader header{};
+    std::memcpy(header.magic, kJournalMagic, sizeof(header.magic));
+    header.version = kJournalVersion;
+    header.headerSize = sizeof(JournalFileHeader);
+    header.startUnixNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    std::fwrite(&header, sizeof(header), 1, file_);
+
+    thread_ = startThread(threads, "copilot-journal", [this] { run(); });
+}
+
+JournalWriter::~JournalWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closing_ = true;
+    }
+    cv_.notify_one();
+    if (thread_.joinable()) thread_.join();
+    std::fclose(file_);
+}
+
+void JournalWriter::append(JournalDirection direction, const char* data, size_t size) {
+    JournalRecordHeader record{};
+    record.size = static_cast<uint32_t>(size);
+    record.direction = static_cast<uint8_t>(direction);
+    record.offsetNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start_).count());
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t at = batch_.size();
+        batch_.resize(at + sizeof(record) + paddedSize(size));
+        std::memcpy(batch_.data() + at, &record, sizeof(record));
+        std::memcpy(batch_.data() + at + sizeof(record), data, size);
+    }
+    cv_.notify_one();
+}
+
+void JournalWriter::run() {
+    std::vector<char> writing;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this] { return closing_ || !batch_.empty(); });
+        if (batch_.empty() && closing_) return;
+
+        // Write outside the lock so append() never waits on the disk
+        writing.swap(batch_);
+        lock.unlock();
+        std::fwrite(writing.data(), 1, writing.size(), file_);
+        std::fflush(file_);
+        writing.clear();
+        lock.lock();
+    }
+}
+
+// ============================================================================
+// JournalReader
+// ============================================================================
+
+JournalReader::JournalReader(const std::string& path) {
+#ifdef _WIN32
+    int fd = _open(path.c_str(), _O_RDONLY | _O_BINARY);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+#endif
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open journal " + path + ": " + std::strerror(errno));
+    }
+
+#ifndef _WIN32
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            data_ = static_cast<const char*>(mapping);
+            size_ = static_cast<size_t>(st.st_size);
+            mapped_ = true;
+        }
+    }
+#endif
+    if (!mapped_) {
+        char chunk[64 * 1024];
+        for (int n; (n = static_cast<int>(COPILOT_READ(fd, chunk, sizeof(chunk)))) > 0;) {
+            buffer_.insert(buffer_.end(), chunk, chunk + n);
+        }
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+    }
+    COPILOT_CLOSE(fd);
+
+    if (size_ < sizeof(JournalFileHeader) ||
+        std::memcmp(header().magic, kJournalMagic, sizeof(kJournalMagic)) != 0 ||
+        header().version != kJournalVersion) {
+#ifndef _WIN32
+        if (mapped_) munmap(const_cast<char*>(data_), size_);
+#endif
+        throw std::runtime_error("Not a journal file: " + path);
+    }
+    rewind();
+}
+
+JournalReader::~JournalReader() {
+#ifndef _WIN32
+    if (mapped_) {
+        munmap(const_cast<char*>(data_), size_);
+        mapped_ = false;
+    }
+#endif
+}
+
+const JournalFileHeader& JournalReader::header() const {
+    return *reinterpret_cast<const JournalFileHeader*>(data_);
+}
+
+void JournalReader::rewind() {
+    position_ = header().headerSize;
+}
+
+bool JournalReader::next(JournalRecord& record) {
+    if (position_ + sizeof(JournalRecordHeader) > size_) return false;
+
+    const auto* header = reinterpret_cast<const JournalRecordHeader*>(data_ + position_);
+    size_t bodyAt = position_ + sizeof(JournalRecordHeader);
+    if (bodyAt + header->size > size_) return false;
+
+    record.direction = static_cast<JournalDirection>(header->direction);
+    record.offset = std::chrono::nanoseconds(header->offsetNs);
+    record.body = std::string_view(data_ + bodyAt, header->size);
+    position_ = bodyAt + paddedSize(header->size);
+    return true;
+}
+
+// ============================================================================
+// JournalReplayer
+// ============================================================================
+
+JournalReplayer::JournalReplayer(const ReplayOptions& options, const ThreadOptions& threads)
+    : options_(options), reader_(options.journalPath) {
+    // Index recorded requests so their responses can be matched to live ones
+    JournalRecord record;
+    while (reader_.next(record)) {
+        if (record.direction != JournalDirection::Outbound) continue;
+        try {
+            auto msg = nlohmann::json::parse(record.body);
+            if (!msg.contains("method") || !msg.contains("id") || !msg["id"].is_string()) continue;
+            std::string method = msg["method"].get<std::string>();
+            MethodState& state = methods_[method];
+            recordedRequests_[msg["id"].get<std::string>()] = {method, state.recorded++};
+        } catch (const nlohmann::json::exception&) {
+            // Skip malformed frame
+        }
+    }
+    for (auto& [method, state] : methods_) {
+        state.replies.assign(state.recorded, Reply::Pending);
+    }
+    reader_.rewind();
+
+    int feed[2], drain[2];
+#ifdef _WIN32
+    if (_pipe(feed, 1 << 16, _O_BINARY) != 0) throw std::runtime_error("Failed to create replay pipe");
+    if (_pipe(drain, 1 << 16, _O_BINARY) != 0) {
+#else
+    if (pipe(feed) != 0) throw std::runtime_error("Failed to create replay pipe");
+    if (pipe(drain) != 0) {
+#endif
+        COPILOT_CLOSE(feed[0]);
+        COPILOT_CLOSE(feed[1]);
+        throw std::runtime_error("Failed to create replay pipe");
+    }
+    clientReadFd_ = feed[0];
+    feedFd_ = feed[1];
+    drainFd_ = drain[0];
+    clientWriteFd_ = drain[1];
+
+    feedThread_ = startThread(threads, "copilot-rfeed", [this] { feedLoop(); });
+    drainThread_ = startThread(threads, "copilot-rdrain", [this] { drainLoop(); });
+}
+
+JournalReplayer::~JournalReplayer() {
+    finish();
+    if (drainThread_.joinable()) drainThread_.join();
+    COPILOT_CLOSE(drainFd_);
+}
+
+void JournalReplayer::finish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (feedThread_.joinable()) feedThread_.join();
+
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    if (feedFd_ >= 0) {
+        COPILOT_CLOSE(feedFd_);
+        feedFd_ = -1;
+    }
+}
+
+void JournalReplayer::feedLoop() {
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    std::chrono::nanoseconds base{-1};
+
+    JournalRecord record;
+    while (reader_.next(record)) {
+        if (record.direction != JournalDirection::Inbound) continue;
+        if (base.count() < 0) base = record.offset;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (options_.speed > 0) {
+            auto due = start + std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double, std::nano>((record.offset - base).count() / options_.speed));
+            if (cv_.wait_until(lock, due, [this] { return stopping_; })) return;
+        }
+        if (stopping_) return;
+
+        std::string body(record.body);
+        nlohmann::json msg;
+        try {
+            msg = nlohmann::json::parse(record.body);
+        } catch (const nlohmann::json::exception&) {
+            // Replay malformed frame verbatim
+        }
+
+        // A response to a recorded request waits for the client's matching request
+        auto recorded = msg.is_object() && !msg.contains("method") && msg.contains("id") &&
+                        msg["id"].is_string()
+            ? recordedRequests_.find(msg["id"].get<std::string>())
+            : recordedRequests_.end();
+        if (recorded != recordedRequests_.end()) {
+            MethodState& state = methods_[recorded->second.method];
+            size_t ordinal = recorded->second.ordinal;
+            bool matched = cv_.wait_for(lock, std::chrono::milliseconds(options_.matchTimeoutMs),
+                [&] { return stopping_ || state.liveIds.size() > ordinal; });
+            if (stopping_) return;
+
+            if (!matched) {
+                // Delivered unmatched (the client ignores unknown IDs); a later
+                // request with this ordinal gets a synthetic reply instead
+                state.replies[ordinal] = Reply::Synthetic;
+            } else if (state.replies[ordinal] == Reply::Pending) {
+                state.replies[ordinal] = Reply::Recorded;
+                msg["id"] = state.liveIds[ordinal];
+                body = msg.dump();
+            }
+        }
+        lock.unlock();
+
+        writeFrame(body);
+    }
+
+    // Live requests whose recorded responses never came still need a reply
+    std::vector<std::string> unanswered;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fed_ = true;
+        for (auto& [method, state] : methods_) {
+            for (size_t i = 0; i < state.liveIds.size() && i < state.recorded; ++i) {
+                if (state.replies[i] != Reply::Pending) continue;
+                state.replies[i] = Reply::Synthetic;
+                unanswered.push_back(state.liveIds[i]);
+            }
+        }
+    }
+    for (const auto& id : unanswered) replySynthetic(id);
+}
+
+/// Read a Content-Length framed message from 'fd'. Returns false on EOF.
+static bool readFrame(int fd, std::string& body) {
+    std::string header;
+    char c;
+    while (header.size() < 4 || header.compare(header.size() - 4, 4, "\r\n\r\n") != 0) {
+        if (COPILOT_READ(fd, &c, 1) <= 0) return false;
+        header += c;
+    }
+
+    size_t length = 0;
+    auto at = header.find("Content-Length:");
+    if (at != std::string::npos) length = std::strtoul(header.c_str() + at + 15, nullptr, 10);
+
+    body.resize(length);
+    for (size_t got = 0; got < length;) {
+        auto n = COPILOT_READ(fd, &body[got], length - got);
+        if (n <= 0) return false;
+        got += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void JournalReplayer::drainLoop() {
+    std::string body;
+    while (readFrame(drainFd_, body)) {
+        nlohmann::json msg;
+        try {
+            msg = nlohmann::json::parse(body);
+        } catch (const nlohmann::json::exception&) {
+            continue;
+        }
+        if (!msg.contains("method") || !msg.contains("id") || !msg["id"].is_string()) continue;
+
+        std::string id = msg["id"].get<std::string>();
+        bool synthetic;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            MethodState& state = methods_[msg["method"].get<std::string>()];
+            size_t ordinal = state.liveIds.size();
+            state.liveIds.push_back(id);
+            synthetic = fed_ || ordinal >= state.recorded || state.replies[ordinal] != Reply::Pending;
+            if (synthetic && ordinal < state.recorded) state.replies[ordinal] = Reply::Synthetic;
+        }
+        cv_.notify_all();
+
+        if (synthetic) replySynthetic(id);
+    }
+}
+
+void JournalReplayer::replySynthetic(const std::string& id) {
+    nlohmann::json response = {
+        {"jsonrpc", "2.0"},
+        {"id", id},
+        {"result", nlohmann::json::object()}
+    };
+    writeFrame(response.dump());
+}
+
+void JournalReplayer::writeFrame(const std::string& body) {
+    std::string frame = "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    if (feedFd_ < 0) return;
+    for (size_t written = 0; written < frame.size();) {
+        auto n = COPILOT_WRITE(feedFd_, frame.data() + written, frame.size() - written);
+        if (n <= 0) return;
+        written += static_cast<size_t>(n);
+    }
+}
+
+} // namespace copilot
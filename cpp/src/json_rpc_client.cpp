@@ -3,12 +3,15 @@
  *--------------------------------------------------------------------------------------------*/
 
 #include "copilot/json_rpc_client.h"
+#include "copilot/threads.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
 #include <random>
 #include <sstream>
 #include <stdexcept>
+#include <string_view>
 #include <vector>
 
 #ifdef _WIN32
@@ -27,8 +30,8 @@ namespace copilot {
 // Construction / Destruction
 // ============================================================================
 
-JsonRpcClient::JsonRpcClient(int readFd, int writeFd)
-    : readFd_(readFd), writeFd_(writeFd) {}
+JsonRpcClient::JsonRpcClient(int readFd, int writeFd, ThreadOptions threads)
+    : readFd_(readFd), writeFd_(writeFd), threads_(std::move(threads)) {}
 
 JsonRpcClient::~JsonRpcClient() {
     stop();
@@ -41,7 +44,7 @@ JsonRpcClient::~JsonRpcClient() {
 void JsonRpcClient::start() {
     if (running_.load()) return;
     running_.store(true);
-    readerThread_ = std::thread(&JsonRpcClient::readLoop, this);
+    readerThread_ = startThread(threads_, "copilot-reader", [this] { readLoop(); });
 }
 
 void JsonRpcClient::stop() {
@@ -54,15 +57,13 @@ void JsonRpcClient::stop() {
         readerThread_.join();
     }
 
-    // Fail any pending requests
+    failPending("client stopped", RpcError::Kind::Stopped);
+}
+
+void JsonRpcClient::failPending(const std::string& reason, RpcError::Kind kind) {
     std::lock_guard<std::mutex> lock(pendingMutex_);
     for (auto& [id, pending] : pendingRequests_) {
-        try {
-            pending->promise.set_exception(
-                std::make_exception_ptr(std::runtime_error("client stopped")));
-        } catch (...) {
-            // Promise may already be satisfied
-        }
+        failLocked(*pending, RpcError{kind, 0, reason, nullptr});
     }
     pendingRequests_.clear();
 }
@@ -74,62 +75,244 @@ void JsonRpcClient::stop() {
 void JsonRpcClient::setRequestHandler(const std::string& method, RequestHandler handler) {
     std::lock_guard<std::mutex> lock(handlerMutex_);
     if (handler) {
-        requestHandlers_[method] = std::move(handler);
+        requestHandlers_[method] = {
+            [handler = std::move(handler)](const nlohmann::json& params, const std::vector<Base64Span>&) {
+                return handler(params);
+            },
+            false};
+    } else {
+        requestHandlers_.erase(method);
+    }
+}
+
+void JsonRpcClient::setPayloadRequestHandler(const std::string& method, PayloadRequestHandler handler) {
+    std::lock_guard<std::mutex> lock(handlerMutex_);
+    if (handler) {
+        requestHandlers_[method] = {std::move(handler), true};
     } else {
         requestHandlers_.erase(method);
     }
 }
 
+void JsonRpcClient::setPayloadExtraction(size_t minSize) {
+    payloadThreshold_.store(minSize);
+}
+
+void JsonRpcClient::setJournal(std::shared_ptr<JournalWriter> journal) {
+    journal_ = std::move(journal);
+}
+
+void JsonRpcClient::setCloseHandler(std::function<void()> handler) {
+    closeHandler_ = std::move(handler);
+}
+
 // ============================================================================
 // Request / Notify
 // ============================================================================
 
-nlohmann::json JsonRpcClient::request(const std::string& method, const nlohmann::json& params) {
-    auto requestId = generateUUID();
+nlohmann::json JsonRpcClient::request(const std::string& method, const nlohmann::json& params,
+                                      Priority priority, std::chrono::milliseconds timeout) {
+    return requestImpl(method, params, priority, timeout, false).value();
+}
 
-    auto pending = std::make_shared<PendingRequest>();
-    auto future = pending->promise.get_future();
+Result<nlohmann::json> JsonRpcClient::tryRequest(const std::string& method, const nlohmann::json& params,
+                                                 Priority priority, std::chrono::milliseconds timeout) {
+    return requestImpl(method, params, priority, timeout, false);
+}
 
-    {
-        std::lock_guard<std::mutex> lock(pendingMutex_);
-        pendingRequests_[requestId] = pending;
-    }
+nlohmann::json JsonRpcClient::recoveryRequest(const std::string& method, const nlohmann::json& params,
+                                              std::chrono::milliseconds timeout) {
+    return requestImpl(method, params, Priority::Interactive, timeout, true).value();
+}
 
-    // Build and send request
-    nlohmann::json msg = {
+Result<nlohmann::json> JsonRpcClient::requestImpl(const std::string& method, const nlohmann::json& params,
+                                          Priority priority, std::chrono::milliseconds timeout,
+                                          bool bypassHold) {
+    auto requestId = generateUUID();
+    auto queuedAt = Clock::now();
+    auto deadline = timeout.count() > 0 ? queuedAt + timeout : Clock::time_point::max();
+
+    // Build request; kept with the pending entry so it can be sent again
+    nlohmann::json message = {
         {"jsonrpc", "2.0"},
         {"id", requestId},
         {"method", method},
         {"params", params}
     };
 
-    try {
-        sendMessage(msg);
-    } catch (...) {
+    PendingRequest* pending;
+    {
+        // stop() fails everything registered before it clears the map; a
+        // request registered after that must not wait for a response
         std::lock_guard<std::mutex> lock(pendingMutex_);
-        pendingRequests_.erase(requestId);
-        throw;
+        if (!running_.load()) return RpcError{RpcError::Kind::Stopped, 0, "client stopped", nullptr};
+        pending = acquirePendingLocked();
+        pending->message = std::move(message);
+        pending->priority = priority;
+        pendingRequests_[requestId] = pending;
     }
 
-    // Wait for response
-    nlohmann::json result = future.get();
+    // Returns the slot to the pool however this call ends
+    struct SlotGuard {
+        JsonRpcClient* client;
+        PendingRequest* pending;
+        ~SlotGuard() { client->releasePending(pending); }
+    } slotGuard{this, pending};
 
-    // Clean up
-    {
+    // While held, the request stays pending and releaseHeld() sends it
+    auto sent = sendMessage(pending->message, priority, deadline, &pending->written, bypassHold);
+    if (!sent) {
         std::lock_guard<std::mutex> lock(pendingMutex_);
         pendingRequests_.erase(requestId);
+        return sent.error();
+    }
+
+    // Wait for response. The slot left the map when its outcome was set, so
+    // a timed-out request still in the map is removed here.
+    if (!pending->done.waitUntil(deadline)) {
+        std::lock_guard<std::mutex> lock(pendingMutex_);
+        if (pendingRequests_.erase(requestId) == 1) {
+            return RpcError{RpcError::Kind::Timeout, 0, "Request timed out: " + method, nullptr};
+        }
+    }
+    if (pending->error) return std::move(*pending->error);
+    nlohmann::json result = std::move(pending->result);
+
+    double roundTripMs = std::chrono::duration<double, std::milli>(Clock::now() - queuedAt).count();
+    {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        PriorityLatencyStats& stats = latencyStats_[static_cast<size_t>(priority)];
+        stats.requests++;
+        stats.totalRoundTripMs += roundTripMs;
+        stats.maxRoundTripMs = std::max(stats.maxRoundTripMs, roundTripMs);
     }
 
     return result;
 }
 
-void JsonRpcClient::notify(const std::string& method, const nlohmann::json& params) {
+void JsonRpcClient::notify(const std::string& method, const nlohmann::json& params,
+                           Priority priority) {
     nlohmann::json msg = {
         {"jsonrpc", "2.0"},
         {"method", method},
         {"params", params}
     };
-    sendMessage(msg);
+    auto sent = sendMessage(msg, priority);
+    if (!sent.value()) throw std::runtime_error("Connection to the CLI server was lost");
+}
+
+// ============================================================================
+// Priorities
+// ============================================================================
+
+void JsonRpcClient::setPriorityStarvationMs(int ms) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    starvationBound_ = std::chrono::milliseconds(ms);
+}
+
+std::map<Priority, PriorityLatencyStats> JsonRpcClient::priorityStats() const {
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    std::map<Priority, PriorityLatencyStats> result;
+    for (size_t cls = 0; cls < kPriorityCount; ++cls) {
+        result[static_cast<Priority>(cls)] = latencyStats_[cls];
+    }
+    return result;
+}
+
+// ============================================================================
+// Reconnection
+// ============================================================================
+
+size_t JsonRpcClient::suspend(const std::function<bool(const std::string& method)>& isReplayable) {
+    // Taking the gate waits out a write in progress on the old transport.
+    // Its descriptors are forgotten, so once the caller closes them a write
+    // after releaseHeld() fails instead of reaching a reused descriptor
+    acquireWrite(Priority::Interactive, Clock::time_point::max());
+    held_ = true;
+    writeFd_ = -1;
+    releaseWrite();
+
+    if (readerThread_.joinable()) readerThread_.join();
+    readFd_ = -1;
+
+    size_t lost = 0;
+    std::lock_guard<std::mutex> lock(pendingMutex_);
+    for (auto it = pendingRequests_.begin(); it != pendingRequests_.end();) {
+        PendingRequest* pending = it->second;
+        if (!pending->written.load()) {
+            ++it;
+        } else if (isReplayable(pending->message["method"].get<std::string>())) {
+            pending->written.store(false);
+            ++it;
+        } else {
+            it = pendingRequests_.erase(it);
+            failLocked(*pending, RpcError{RpcError::Kind::ConnectionLost, 0,
+                                          "Connection to the CLI server was lost", nullptr});
+            lost++;
+        }
+    }
+    return lost;
+}
+
+void JsonRpcClient::reattach(int readFd, int writeFd) {
+    acquireWrite(Priority::Interactive, Clock::time_point::max());
+    readFd_ = readFd;
+    writeFd_ = writeFd;
+    releaseWrite();
+
+    readerThread_ = startThread(threads_, "copilot-reader", [this] { readLoop(); });
+}
+
+size_t JsonRpcClient::releaseHeld() {
+    acquireWrite(Priority::Interactive, Clock::time_point::max());
+    held_ = false;
+    releaseWrite();
+
+    // Each slot is referenced so its requester cannot recycle it mid-send
+    std::vector<std::pair<std::string, PendingRequest*>> unsent;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex_);
+        for (auto& [id, pending] : pendingRequests_) {
+            if (pending->written.load()) continue;
+            pending->refs.fetch_add(1, std::memory_order_relaxed);
+            unsent.emplace_back(id, pending);
+        }
+    }
+
+    size_t sent = 0;
+    for (auto& [id, pending] : unsent) {
+        // A request whose own sender got there first is skipped
+        auto result = sendMessage(pending->message, pending->priority, Clock::time_point::max(),
+                                  &pending->written);
+        if (result) {
+            sent++;
+        } else {
+            std::lock_guard<std::mutex> lock(pendingMutex_);
+            if (pendingRequests_.erase(id) == 1) failLocked(*pending, result.error());
+        }
+        releasePending(pending);
+    }
+    return sent;
+}
+
+// ============================================================================
+// Stall Detection
+// ============================================================================
+
+std::string JsonRpcClient::stallReason(std::chrono::milliseconds bound) const {
+    auto now = Clock::now().time_since_epoch().count();
+    auto limit = std::chrono::duration_cast<Clock::duration>(bound).count();
+    auto describe = [&](const char* what, Clock::rep startedAt) {
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            Clock::duration(now - startedAt)).count();
+        return std::string(what) + " stalled for " + std::to_string(ms) + " ms";
+    };
+
+    Clock::rep writeAt = writeStartedAt_.load();
+    if (writeAt != 0 && now - writeAt > limit) return describe("write", writeAt);
+    Clock::rep frameAt = frameStartedAt_.load();
+    if (frameAt != 0 && now - frameAt > limit) return describe("read", frameAt);
+    return {};
 }
 
 // ============================================================================
@@ -159,7 +342,59 @@ static bool readLine(int fd, std::string& out) {
     }
 }
 
+static bool isJsonSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/// Cut "base64" string values of at least minSize characters out of a message
+/// body. Returns the rest of the JSON text with each value replaced by
+/// {"$payload": index}, or an empty string if nothing was cut. Values with
+/// escape sequences are left in place.
+static std::string extractPayloads(const std::shared_ptr<std::vector<char>>& body, size_t minSize,
+                                   std::vector<Base64Span>& payloads) {
+    static constexpr std::string_view kKey = "\"base64\"";
+    std::string_view text(body->data(), body->size());
+    std::string skeleton;
+    size_t copied = 0;
+
+    for (size_t pos = text.find(kKey); pos != std::string_view::npos; pos = text.find(kKey, pos + 1)) {
+        // An escaped quote means the match is inside a string
+        if (pos > 0 && text[pos - 1] == '\\') continue;
+
+        size_t i = pos + kKey.size();
+        while (i < text.size() && isJsonSpace(text[i])) ++i;
+        if (i >= text.size() || text[i] != ':') continue;
+        ++i;
+        while (i < text.size() && isJsonSpace(text[i])) ++i;
+        if (i >= text.size() || text[i] != '"') continue;
+
+        size_t start = i + 1;
+        size_t end = text.find('"', start);
+        if (end == std::string_view::npos) break;
+        pos = end;
+        if (end - start < minSize || text.substr(start, end - start).find('\\') != std::string_view::npos) {
+            continue;
+        }
+
+        skeleton.append(text.data() + copied, i - copied);
+        skeleton += "{\"$payload\":" + std::to_string(payloads.size()) + "}";
+        payloads.push_back({body, start, end - start});
+        copied = end + 1;
+    }
+
+    if (payloads.empty()) return {};
+    skeleton.append(text.data() + copied, text.size() - copied);
+    return skeleton;
+}
+
 void JsonRpcClient::readLoop() {
+    readMessages();
+
+    // The server closed the stream; stop() clears running_ before it returns
+    if (running_.load() && closeHandler_) closeHandler_();
+}
+
+void JsonRpcClient::readMessages() {
     while (running_.load()) {
         // Read headers until blank line
         int contentLength = 0;
@@ -182,19 +417,37 @@ void JsonRpcClient::readLoop() {
 
         if (contentLength <= 0) continue;
 
-        // Read the message body
-        std::vector<char> body(contentLength);
-        if (!readFull(readFd_, body.data(), contentLength)) {
+        // Read the message body. Only reading and parsing a frame the server has
+        // started count towards a stall; handlers may take as long as they like
+        frameStartedAt_.store(Clock::now().time_since_epoch().count());
+        auto body = std::make_shared<std::vector<char>>(contentLength);
+        if (!readFull(readFd_, body->data(), contentLength)) {
+            frameStartedAt_.store(0);
             return; // EOF or error
         }
+        if (journal_) journal_->append(JournalDirection::Inbound, body->data(), body->size());
 
-        // Parse JSON
+        // Parse JSON, leaving large base64 values in the body buffer
         try {
-            auto msg = nlohmann::json::parse(body.begin(), body.end());
-            handleIncoming(msg);
+            std::vector<Base64Span> payloads;
+            size_t threshold = payloadThreshold_.load();
+            std::string skeleton;
+            if (threshold > 0 && body->size() >= threshold) {
+                skeleton = extractPayloads(body, threshold, payloads);
+            }
+            auto msg = payloads.empty() ? nlohmann::json::parse(body->begin(), body->end())
+                                        : nlohmann::json::parse(skeleton);
+            if (!payloads.empty() && !wantsPayloads(msg)) {
+                // Only payload handlers understand {"$payload": n}; parse the values back in
+                payloads.clear();
+                msg = nlohmann::json::parse(body->begin(), body->end());
+            }
+            frameStartedAt_.store(0);
+            handleIncoming(msg, payloads);
         } catch (const nlohmann::json::exception&) {
             // Malformed JSON, skip
         }
+        frameStartedAt_.store(0);
     }
 }
 
@@ -202,10 +455,10 @@ void JsonRpcClient::readLoop() {
 // Message Dispatch
 // ============================================================================
 
-void JsonRpcClient::handleIncoming(const nlohmann::json& msg) {
+void JsonRpcClient::handleIncoming(const nlohmann::json& msg, const std::vector<Base64Span>& payloads) {
     // Is it a request/notification from server? (has "method")
     if (msg.contains("method")) {
-        handleRequest(msg);
+        handleRequest(msg, payloads);
         return;
     }
 
@@ -216,6 +469,16 @@ void JsonRpcClient::handleIncoming(const nlohmann::json& msg) {
     }
 }
 
+/// Whether 'msg' is a request for a method registered with setPayloadRequestHandler().
+bool JsonRpcClient::wantsPayloads(const nlohmann::json& msg) {
+    auto method = msg.find("method");
+    if (method == msg.end() || !method->is_string()) return false;
+
+    std::lock_guard<std::mutex> lock(handlerMutex_);
+    auto it = requestHandlers_.find(method->get_ref<const std::string&>());
+    return it != requestHandlers_.end() && it->second.wantsPayloads;
+}
+
 void JsonRpcClient::handleResponse(const nlohmann::json& msg) {
     std::string id;
     if (msg["id"].is_string()) {
@@ -224,43 +487,92 @@ void JsonRpcClient::handleResponse(const nlohmann::json& msg) {
         return; // Non-string IDs not supported
     }
 
-    std::shared_ptr<PendingRequest> pending;
-    {
-        std::lock_guard<std::mutex> lock(pendingMutex_);
-        auto it = pendingRequests_.find(id);
-        if (it == pendingRequests_.end()) return;
-        pending = it->second;
-    }
-
+    // The outcome is built before taking the lock; an error stays a value
+    std::optional<RpcError> error;
+    nlohmann::json result = nullptr;
     if (msg.contains("error") && !msg["error"].is_null()) {
         auto& err = msg["error"];
-        std::string errMsg = "JSON-RPC Error";
-        if (err.contains("code")) errMsg += " " + std::to_string(err["code"].get<int>());
-        if (err.contains("message")) errMsg += ": " + err["message"].get<std::string>();
-        try {
-            pending->promise.set_exception(
-                std::make_exception_ptr(std::runtime_error(errMsg)));
-        } catch (...) {}
+        error.emplace();
+        error->kind = RpcError::Kind::Server;
+        error->code = err.value("code", 0);
+        error->message = err.value("message", std::string());
+        if (err.contains("data")) error->data = err["data"];
+    } else if (msg.contains("result")) {
+        result = msg["result"];
+    }
+
+    std::lock_guard<std::mutex> lock(pendingMutex_);
+    auto it = pendingRequests_.find(id);
+    if (it == pendingRequests_.end()) return;
+    PendingRequest* pending = it->second;
+    pendingRequests_.erase(it);
+    if (error) {
+        failLocked(*pending, std::move(*error));
     } else {
-        nlohmann::json result = nullptr;
-        if (msg.contains("result")) result = msg["result"];
-        try {
-            pending->promise.set_value(std::move(result));
-        } catch (...) {}
+        completeLocked(*pending, std::move(result));
+    }
+}
+
+// ============================================================================
+// Pending Request Slots
+// ============================================================================
+
+namespace {
+// Idle slots kept for reuse; a burst beyond this frees its extra slots
+constexpr size_t kMaxFreePending = 256;
+}
+
+JsonRpcClient::PendingRequest* JsonRpcClient::acquirePendingLocked() {
+    std::unique_ptr<PendingRequest> slot;
+    if (freePending_.empty()) {
+        slot = std::make_unique<PendingRequest>();
+    } else {
+        slot = std::move(freePending_.back());
+        freePending_.pop_back();
     }
+    slot->refs.store(1, std::memory_order_relaxed);
+    return slot.release();
 }
 
-void JsonRpcClient::handleRequest(const nlohmann::json& msg) {
+/// Drop one reference; the last one returns the slot to the pool. Taking
+/// pendingMutex_ also waits out a completer still signalling it.
+void JsonRpcClient::releasePending(PendingRequest* pending) {
+    if (pending->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+    std::unique_ptr<PendingRequest> slot(pending);
+    nlohmann::json message = std::move(slot->message);
+    nlohmann::json result = std::move(slot->result);
+
+    std::lock_guard<std::mutex> lock(pendingMutex_);
+    if (freePending_.size() >= kMaxFreePending) return;
+    slot->message = nullptr;
+    slot->result = nullptr;
+    slot->error.reset();
+    slot->written.store(false, std::memory_order_relaxed);
+    slot->done.reset();
+    freePending_.push_back(std::move(slot));
+}
+
+void JsonRpcClient::completeLocked(PendingRequest& pending, nlohmann::json result) {
+    pending.result = std::move(result);
+    pending.done.signal();
+}
+
+void JsonRpcClient::failLocked(PendingRequest& pending, RpcError error) {
+    pending.error = std::move(error);
+    pending.done.signal();
+}
+
+void JsonRpcClient::handleRequest(const nlohmann::json& msg, const std::vector<Base64Span>& payloads) {
     std::string method = msg["method"].get<std::string>();
     nlohmann::json params = msg.contains("params") ? msg["params"] : nlohmann::json::object();
     bool isCall = msg.contains("id") && !msg["id"].is_null();
 
-    RequestHandler handler;
+    PayloadRequestHandler handler;
     {
         std::lock_guard<std::mutex> lock(handlerMutex_);
         auto it = requestHandlers_.find(method);
         if (it != requestHandlers_.end()) {
-            handler = it->second;
+            handler = it->second.handler;
         }
     }
 
@@ -274,17 +586,18 @@ void JsonRpcClient::handleRequest(const nlohmann::json& msg) {
     if (!isCall) {
         // Notification: run synchronously on reader thread
         try {
-            handler(params);
+            handler(params, payloads);
         } catch (...) {}
         return;
     }
 
     // Request: run in detached thread to avoid blocking the reader
     nlohmann::json requestId = msg["id"];
-    std::thread([this, handler = std::move(handler), params = std::move(params),
-                 requestId = std::move(requestId)]() {
+    startThread(threads_, "copilot-handler",
+                [this, handler = std::move(handler), params = std::move(params),
+                 requestId = std::move(requestId), payloads]() {
         try {
-            auto [result, error] = handler(params);
+            auto [result, error] = handler(params, payloads);
             if (error) {
                 sendErrorResponse(requestId, error->code, error->message);
             } else {
@@ -302,19 +615,102 @@ void JsonRpcClient::handleRequest(const nlohmann::json& msg) {
 // Message Sending
 // ============================================================================
 
-void JsonRpcClient::sendMessage(const nlohmann::json& msg) {
+/// Wait for the write gate. Uncontended writers take it directly; otherwise
+/// the writer queues in its class and releaseWrite() hands the gate over.
+/// Returns false if the gate is not handed over by 'deadline'.
+bool JsonRpcClient::acquireWrite(Priority priority, Clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(writeMutex_);
+    if (!writing_) {
+        writing_ = true;
+        return true;
+    }
+
+    WriteWaiter waiter;
+    waiter.enqueuedAt = Clock::now();
+    auto& queue = writeQueues_[static_cast<size_t>(priority)];
+    queue.push_back(&waiter);
+    if (deadline == Clock::time_point::max()) {
+        writeCv_.wait(lock, [&] { return waiter.granted; });
+    } else if (!writeCv_.wait_until(lock, deadline, [&] { return waiter.granted; })) {
+        queue.erase(std::find(queue.begin(), queue.end(), &waiter));
+        return false;
+    }
+    return true;
+}
+
+/// Hand the write gate to the next writer: the oldest waiter of a lower
+/// class that has passed the starvation bound, else the head of the highest
+/// non-empty class.
+void JsonRpcClient::releaseWrite() {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+
+    size_t next = kPriorityCount;
+    Clock::time_point starvedSince = Clock::now() - starvationBound_;
+    for (size_t cls = 1; cls < kPriorityCount; ++cls) {
+        auto& queue = writeQueues_[cls];
+        if (!queue.empty() && queue.front()->enqueuedAt <= starvedSince) {
+            starvedSince = queue.front()->enqueuedAt;
+            next = cls;
+        }
+    }
+    for (size_t cls = 0; next == kPriorityCount && cls < kPriorityCount; ++cls) {
+        if (!writeQueues_[cls].empty()) next = cls;
+    }
+
+    if (next == kPriorityCount) {
+        writing_ = false;
+        return;
+    }
+    writeQueues_[next].front()->granted = true;
+    writeQueues_[next].pop_front();
+    writeCv_.notify_all();
+}
+
+/// Write one message. Returns false, without writing, while requests are
+/// held (unless 'bypassHold'). When 'written' is given it is claimed under
+/// the gate, and a message another sender has already claimed is skipped.
+Result<bool> JsonRpcClient::sendMessage(const nlohmann::json& msg, Priority priority,
+                                Clock::time_point deadline, std::atomic<bool>* written,
+                                bool bypassHold) {
     std::string body = msg.dump();
     std::string header = "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n";
 
-    std::lock_guard<std::mutex> lock(writeMutex_);
+    auto queuedAt = Clock::now();
+    if (!acquireWrite(priority, deadline)) {
+        return RpcError{RpcError::Kind::Timeout, 0, "Timed out waiting to write", nullptr};
+    }
+    double queueMs = std::chrono::duration<double, std::milli>(Clock::now() - queuedAt).count();
+    {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        PriorityLatencyStats& stats = latencyStats_[static_cast<size_t>(priority)];
+        stats.messages++;
+        stats.totalQueueTimeMs += queueMs;
+        stats.maxQueueTimeMs = std::max(stats.maxQueueTimeMs, queueMs);
+    }
+
+    struct WriteGate {
+        JsonRpcClient* client;
+        ~WriteGate() {
+            client->writeStartedAt_.store(0);
+            client->releaseWrite();
+        }
+    } gate{this};
+    if (held_ && !bypassHold) return false;
+    if (written && written->exchange(true)) return true;
+    writeStartedAt_.store(Clock::now().time_since_epoch().count());
+
+    // Journaled under the gate so records keep the order of the stream
+    if (journal_) journal_->append(JournalDirection::Outbound, body.data(), body.size());
+
     auto headerWritten = COPILOT_WRITE(writeFd_, header.c_str(), header.size());
     if (headerWritten < 0) {
-        throw std::runtime_error("Failed to write message header");
+        return RpcError{RpcError::Kind::ConnectionLost, 0, "Failed to write message header", nullptr};
     }
     auto bodyWritten = COPILOT_WRITE(writeFd_, body.c_str(), body.size());
     if (bodyWritten < 0) {
-        throw std::runtime_error("Failed to write message body");
+        return RpcError{RpcError::Kind::ConnectionLost, 0, "Failed to write message body", nullptr};
     }
+    return true;
 }
 
 void JsonRpcClient::sendResponse(const nlohmann::json& id, const nlohmann::json& result) {
@@ -348,9 +744,9 @@ void JsonRpcClient::sendErrorResponse(const nlohmann::json& id, int code, const
 // ============================================================================
 
 std::string JsonRpcClient::generateUUID() {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_int_distribution<uint32_t> dist(0, 0xFFFFFFFF);
+    // Per thread: requests are issued from many threads at once
+    thread_local std::mt19937 gen(std::random_device{}());
+    std::uniform_int_distribution<uint32_t> dist(0, 0xFFFFFFFF);
 
     uint32_t a = dist(gen);
     uint32_t b = dist(gen);
@@ -0,0 +1,273 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Microsoft Corporation. All rights reserved.
+ *--------------------------------------------------------------------------------------------*/
+
+#include "copilot/json_stream.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace copilot {
+
+// ============================================================================
+// Handler Registration
+// ============================================================================
+
+void JsonStreamParser::onValue(ValueHandler handler) {
+    valueHandlers_.push_back(std::move(handler));
+}
+
+void JsonStreamParser::onElement(const std::string& arrayPointer, ElementHandler handler) {
+    elementHandlers_[arrayPointer].push_back(std::move(handler));
+}
+
+void JsonStreamParser::onDocument(DocumentHandler handler) {
+    documentHandlers_.push_back(std::move(handler));
+}
+
+// ============================================================================
+// Input
+// ============================================================================
+
+void JsonStreamParser::feed(std::string_view chunk) {
+    if (failed()) return;
+    for (char c : chunk) {
+        consume(c);
+        ++offset_;
+    }
+}
+
+void JsonStreamParser::finish() {
+    if (failed()) return;
+    if (lex_ == Lex::Literal) completeLiteral();
+    if (!done_) fail("unexpected end of input");
+}
+
+void JsonStreamParser::reset() {
+    stack_.clear();
+    rootExpect_ = Expect::Value;
+    lex_ = Lex::None;
+    token_.clear();
+    document_ = nullptr;
+    done_ = false;
+    error_.clear();
+    offset_ = 0;
+}
+
+nlohmann::json JsonStreamParser::partial() const {
+    if (done_) return document_;
+    if (stack_.empty()) return nullptr;
+
+    // Nest each open container into the one enclosing it
+    nlohmann::json result = stack_.back().value;
+    for (size_t i = stack_.size() - 1; i-- > 0;) {
+        nlohmann::json parent = stack_[i].value;
+        if (parent.is_object()) {
+            parent[stack_[i].key] = std::move(result);
+        } else {
+            parent.push_back(std::move(result));
+        }
+        result = std::move(parent);
+    }
+    return result;
+}
+
+// ============================================================================
+// Lexing
+// ============================================================================
+
+static bool isLiteralChar(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           c == '-' || c == '+' || c == '.';
+}
+
+void JsonStreamParser::consume(char c) {
+    switch (lex_) {
+        case Lex::String:
+            if (c == '\\') {
+                lex_ = Lex::Escape;
+            } else if (c == '"') {
+                completeString();
+                return;
+            }
+            token_ += c;
+            return;
+        case Lex::Escape:
+            // Escapes (including \uXXXX) are decoded when the string closes
+            lex_ = Lex::String;
+            token_ += c;
+            return;
+        case Lex::Literal:
+            if (isLiteralChar(c)) {
+                token_ += c;
+                return;
+            }
+            completeLiteral();
+            break;
+        case Lex::None:
+            break;
+    }
+    structural(c);
+}
+
+void JsonStreamParser::structural(char c) {
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r') return;
+
+    Expect& exp = expect();
+    bool inObject = !stack_.empty() && stack_.back().value.is_object();
+    bool empty = !stack_.empty() && stack_.back().empty;
+
+    switch (c) {
+        case '{':
+        case '[':
+            if (exp != Expect::Value) break;
+            openContainer(c == '{' ? nlohmann::json::object() : nlohmann::json::array());
+            return;
+        case '}':
+            if (!inObject || !(exp == Expect::CommaOrEnd || (exp == Expect::Key && empty))) break;
+            closeContainer();
+            return;
+        case ']':
+            if (stack_.empty() || inObject ||
+                !(exp == Expect::CommaOrEnd || (exp == Expect::Value && empty))) break;
+            closeContainer();
+            return;
+        case ',':
+            if (exp != Expect::CommaOrEnd || stack_.empty()) break;
+            exp = inObject ? Expect::Key : Expect::Value;
+            return;
+        case ':':
+            if (exp != Expect::Colon) break;
+            exp = Expect::Value;
+            return;
+        case '"':
+            if (exp != Expect::Value && exp != Expect::Key) break;
+            lex_ = Lex::String;
+            tokenIsKey_ = exp == Expect::Key;
+            token_.clear();
+            return;
+        default:
+            if (exp != Expect::Value || !isLiteralChar(c)) break;
+            lex_ = Lex::Literal;
+            token_.assign(1, c);
+            return;
+    }
+    fail(std::string("unexpected '") + c + "'");
+}
+
+// ============================================================================
+// Values
+// ============================================================================
+
+/// Run a user handler. Errors are ignored so the rest of the chunk is still parsed.
+template <typename Handler, typename... Args>
+static void invoke(const Handler& handler, Args&&... args) {
+    try {
+        handler(std::forward<Args>(args)...);
+    } catch (...) {
+        // Ignore handler errors
+    }
+}
+
+JsonStreamParser::Expect& JsonStreamParser::expect() {
+    return stack_.empty() ? rootExpect_ : stack_.back().expect;
+}
+
+/// JSON Pointer of the value about to be added to the innermost container.
+std::string JsonStreamParser::childPointer() const {
+    if (stack_.empty()) return "";
+    const Frame& frame = stack_.back();
+    if (frame.value.is_array()) {
+        return frame.pointer + "/" + std::to_string(frame.value.size());
+    }
+    std::string escaped;
+    for (char c : frame.key) {
+        if (c == '~') escaped += "~0";
+        else if (c == '/') escaped += "~1";
+        else escaped += c;
+    }
+    return frame.pointer + "/" + escaped;
+}
+
+void JsonStreamParser::openContainer(nlohmann::json container) {
+    Frame frame;
+    frame.pointer = childPointer();
+    frame.expect = container.is_object() ? Expect::Key : Expect::Value;
+    frame.value = std::move(container);
+    stack_.push_back(std::move(frame));
+}
+
+void JsonStreamParser::closeContainer() {
+    nlohmann::json value = std::move(stack_.back().value);
+    stack_.pop_back();
+    completeValue(std::move(value));
+}
+
+void JsonStreamParser::completeString() {
+    lex_ = Lex::None;
+    std::string text;
+    try {
+        text = nlohmann::json::parse("\"" + token_ + "\"").get<std::string>();
+    } catch (const nlohmann::json::exception&) {
+        fail("invalid string");
+    }
+    token_.clear();
+
+    if (tokenIsKey_) {
+        stack_.back().key = std::move(text);
+        stack_.back().expect = Expect::Colon;
+    } else {
+        completeValue(std::move(text));
+    }
+}
+
+void JsonStreamParser::completeLiteral() {
+    lex_ = Lex::None;
+    nlohmann::json value;
+    try {
+        value = nlohmann::json::parse(token_);
+    } catch (const nlohmann::json::exception&) {
+        fail("invalid literal '" + token_ + "'");
+    }
+    token_.clear();
+    completeValue(std::move(value));
+}
+
+void JsonStreamParser::completeValue(nlohmann::json value) {
+    if (stack_.empty()) {
+        document_ = std::move(value);
+        rootExpect_ = Expect::End;
+        done_ = true;
+        for (const auto& handler : documentHandlers_) invoke(handler, document_);
+        return;
+    }
+
+    std::string pointer = childPointer();
+    Frame& frame = stack_.back();
+    frame.expect = Expect::CommaOrEnd;
+    frame.empty = false;
+
+    const nlohmann::json* stored;
+    if (frame.value.is_object()) {
+        stored = &(frame.value[frame.key] = std::move(value));
+    } else {
+        frame.value.push_back(std::move(value));
+        stored = &frame.value.back();
+    }
+
+    for (const auto& handler : valueHandlers_) invoke(handler, pointer, *stored);
+    if (frame.value.is_array()) {
+        auto it = elementHandlers_.find(frame.pointer);
+        if (it != elementHandlers_.end()) {
+            for (const auto& handler : it->second) invoke(handler, frame.value.size() - 1, *stored);
+        }
+    }
+}
+
+[[noreturn]] void JsonStreamParser::fail(const std::string& message) {
+    lex_ = Lex::None;
+    error_ = "JSON stream parse error at offset " + std::to_string(offset_) + ": " + message;
+    throw std::runtime_error(error_);
+}
+
+} // namespace copilot
@@ -4,6 +4,7 @@
 
 #include "copilot/session.h"
 
+#include <algorithm>
 #include <stdexcept>
 
 namespace copilot {
@@ -13,8 +14,11 @@ namespace copilot {
 // ============================================================================
 
 CopilotSession::CopilotSession(const std::string& sessionId, JsonRpcClient* client,
-                                const std::string& workspacePath)
-    : sessionId(sessionId), client_(client), workspacePath_(workspacePath) {}
+                                const std::string& workspacePath,
+                                AdmissionController* admission, const std::string& tag,
+                                Priority priority)
+    : sessionId(sessionId), client_(client), workspacePath_(workspacePath),
+      admission_(admission), tag_(tag), priority_(priority) {}
 
 std::string CopilotSession::workspacePath() const {
     return workspacePath_;
@@ -25,6 +29,10 @@ std::string CopilotSession::workspacePath() const {
 // ============================================================================
 
 std::string CopilotSession::send(const MessageOptions& options) {
+    return trySend(options).value();
+}
+
+Result<std::string> CopilotSession::trySend(const MessageOptions& options) {
     nlohmann::json params = {
         {"sessionId", sessionId},
         {"prompt", options.prompt}
@@ -41,17 +49,73 @@ std::string CopilotSession::send(const MessageOptions& options) {
     if (options.imageOptions) {
         params["imageOptions"] = *options.imageOptions;
     }
+    Priority priority = options.priority.value_or(priority_);
+
+    // Set before sending: the session.idle ending this turn can arrive before
+    // request() returns
+    if (!admission_) {
+        turnActive_ = true;
+        try {
+            auto result = client_->tryRequest("session.send", params, priority);
+            if (result) return result->value("messageId", "");
+            turnActive_ = false;
+            return result.error();
+        } catch (...) {
+            turnActive_ = false;
+            throw;
+        }
+    }
+
+    // Track the ticket before sending: the session.idle ending this turn can
+    // arrive before request() returns
+    auto admitted = admission_->tryAcquire(tag_, priority);
+    if (!admitted) return admitted.error();
+    const AdmissionController::Ticket& ticket = *admitted;
+    {
+        std::lock_guard<std::mutex> lock(admissionMutex_);
+        admissionTickets_.push_back(ticket);
+    }
+
+    // The turn never started: free its slot unless session.idle already did
+    auto abandonTurn = [&] {
+        turnActive_ = false;
+        bool held = false;
+        {
+            std::lock_guard<std::mutex> lock(admissionMutex_);
+            auto it = std::find_if(admissionTickets_.begin(), admissionTickets_.end(),
+                [&](const AdmissionController::Ticket& t) { return t.id == ticket.id; });
+            if (it != admissionTickets_.end()) {
+                admissionTickets_.erase(it);
+                held = true;
+            }
+        }
+        if (held) admission_->release(ticket, false);
+    };
 
-    auto result = client_->request("session.send", params);
-    return result.value("messageId", "");
+    turnActive_ = true;
+    try {
+        auto result = client_->tryRequest("session.send", params, priority);
+        if (result) return result->value("messageId", "");
+        abandonTurn();
+        return result.error();
+    } catch (...) {
+        abandonTurn();
+        throw;
+    }
 }
 
 std::optional<SessionEvent> CopilotSession::sendAndWait(const MessageOptions& options, int timeoutMs) {
+    return trySendAndWait(options, timeoutMs).value();
+}
+
+Result<std::optional<SessionEvent>> CopilotSession::trySendAndWait(const MessageOptions& options,
+                                                                   int timeoutMs) {
     std::mutex mtx;
     std::condition_variable cv;
     bool idle = false;
     bool errorOccurred = false;
     std::string errorMessage;
+    nlohmann::json errorData;
     std::optional<SessionEvent> lastAssistantMessage;
 
     // Register handler BEFORE sending to avoid race condition
@@ -64,6 +128,7 @@ std::optional<SessionEvent> CopilotSession::sendAndWait(const MessageOptions& op
             cv.notify_one();
         } else if (event.type == "session.error") {
             errorOccurred = true;
+            errorData = event.data;
             if (event.data.contains("message")) {
                 errorMessage = event.data["message"].get<std::string>();
             } else {
@@ -73,30 +138,29 @@ std::optional<SessionEvent> CopilotSession::sendAndWait(const MessageOptions& op
         }
     });
 
-    try {
-        send(options);
-
-        std::unique_lock<std::mutex> lock(mtx);
-        bool completed = cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&] {
-            return idle || errorOccurred;
-        });
-
-        off(handlerId);
+    // Unsubscribes however this call ends
+    struct Subscription {
+        CopilotSession* session;
+        uint64_t id;
+        ~Subscription() { session->off(id); }
+    } subscription{this, handlerId};
 
-        if (!completed) {
-            throw std::runtime_error("Timeout after " + std::to_string(timeoutMs) +
-                                     "ms waiting for session.idle");
-        }
+    auto sent = trySend(options);
+    if (!sent) return sent.error();
 
-        if (errorOccurred) {
-            throw std::runtime_error("Session error: " + errorMessage);
-        }
+    std::unique_lock<std::mutex> lock(mtx);
+    bool completed = cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&] {
+        return idle || errorOccurred;
+    });
 
-        return lastAssistantMessage;
-    } catch (...) {
-        off(handlerId);
-        throw;
+    if (!completed) {
+        return RpcError{RpcError::Kind::Timeout, 0,
+                        "Timeout after " + std::to_string(timeoutMs) + "ms waiting for session.idle",
+                        nullptr};
     }
+    if (errorOccurred) return RpcError{RpcError::Kind::Session, 0, errorMessage, errorData};
+
+    return lastAssistantMessage;
 }
 
 // ============================================================================
@@ -125,7 +189,26 @@ void CopilotSession::off(uint64_t handlerId) {
         handlers_.end());
 }
 
+void CopilotSession::releaseAdmissions(bool completed) {
+    if (!admission_) return;
+
+    std::vector<AdmissionController::Ticket> tickets;
+    {
+        std::lock_guard<std::mutex> lock(admissionMutex_);
+        tickets.swap(admissionTickets_);
+    }
+    for (const auto& ticket : tickets) {
+        admission_->release(ticket, completed);
+    }
+}
+
 void CopilotSession::dispatchEvent(const SessionEvent& event) {
+    // Idle or error ends every turn sent so far
+    if (event.type == "session.idle" || event.type == "session.error") {
+        turnActive_ = false;
+        releaseAdmissions(true);
+    }
+
     // Take a snapshot of handlers under lock
     std::vector<HandlerEntry> snapshot;
     {
@@ -144,6 +227,32 @@ void CopilotSession::dispatchEvent(const SessionEvent& event) {
     }
 }
 
+// ============================================================================
+// Streaming JSON
+// ============================================================================
+
+uint64_t CopilotSession::streamJson(std::shared_ptr<JsonStreamParser> parser) {
+    auto messageId = std::make_shared<std::string>();
+    return on([parser, messageId](const SessionEvent& event) {
+        if (event.type != "assistant.message_delta" && event.type != "assistant.message") return;
+
+        std::string id = event.data.value("messageId", "");
+        bool started = id == *messageId;
+        if (!started) {
+            *messageId = id;
+            parser->reset();
+        }
+
+        if (event.type == "assistant.message_delta") {
+            parser->feed(event.data.value("deltaContent", ""));
+        } else {
+            // Parse whole if no deltas were streamed for this message
+            if (!started) parser->feed(event.data.value("content", ""));
+            parser->finish();
+        }
+    });
+}
+
 // ============================================================================
 // Tool Registration
 // ============================================================================
@@ -182,13 +291,13 @@ PermissionRequestResult CopilotSession::handlePermissionRequest(const Permission
     }
 
     if (!handler) {
-        return {"denied-no-approval-rule-and-could-not-request-from-user"};
+        return {"denied-no-approval-rule-and-could-not-request-from-user", std::nullopt};
     }
 
     try {
         return handler(request, sessionId);
     } catch (...) {
-        return {"denied-no-approval-rule-and-could-not-request-from-user"};
+        return {"denied-no-approval-rule-and-could-not-request-from-user", std::nullopt};
     }
 }
 
@@ -272,7 +381,7 @@ nlohmann::json CopilotSession::handleHooksInvoke(const std::string& hookType,
 // ============================================================================
 
 std::vector<SessionEvent> CopilotSession::getMessages() {
-    auto result = client_->request("session.getMessages", {{"sessionId", sessionId}});
+    auto result = client_->request("session.getMessages", {{"sessionId", sessionId}}, priority_);
     std::vector<SessionEvent> events;
     if (result.contains("events")) {
         for (const auto& e : result["events"]) {
@@ -283,7 +392,14 @@ std::vector<SessionEvent> CopilotSession::getMessages() {
 }
 
 void CopilotSession::destroy() {
-    client_->request("session.destroy", {{"sessionId", sessionId}});
+    try {
+        client_->request("session.destroy", {{"sessionId", sessionId}}, priority_);
+    } catch (...) {
+        // The session's turns are over either way; don't leak their tickets
+        releaseAdmissions(false);
+        throw;
+    }
+    releaseAdmissions(false);
 
     // Clear all handlers
     {
@@ -305,7 +421,7 @@ void CopilotSession::destroy() {
 }
 
 void CopilotSession::abort() {
-    client_->request("session.abort", {{"sessionId", sessionId}});
+    client_->request("session.abort", {{"sessionId", sessionId}}, priority_);
 }
 
 } // namespace copilot
@@ -0,0 +1,506 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Microsoft Corporation. All rights reserved.
+ *--------------------------------------------------------------------------------------------*/
+
+#include "copilot/supervisor.h"
+#include "copilot/threads.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace copilot {
+
+// ============================================================================
+// StderrBuffer
+// ============================================================================
+
+StderrBuffer::StderrBuffer(size_t capacity) : ring_(capacity) {}
+
+void StderrBuffer::append(const char* data, size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t capacity = ring_.size();
+    if (capacity == 0 || size == 0) return;
+
+    // Only the tail of an oversized chunk can survive
+    if (size >= capacity) {
+        data += size - capacity;
+        size = capacity;
+        start_ = 0;
+        size_ = 0;
+    }
+
+    size_t end = (start_ + size_) % capacity;
+    size_t first = std::min(size, capacity - end);
+    std::memcpy(ring_.data() + end, data, first);
+    std::memcpy(ring_.data(), data + first, size - first);
+
+    size_ += size;
+    if (size_ > capacity) {
+        start_ = (start_ + size_ - capacity) % capacity;
+        size_ = capacity;
+    }
+}
+
+std::string StderrBuffer::contents() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string out;
+    out.reserve(size_);
+    size_t first = std::min(size_, ring_.size() - start_);
+    out.append(ring_.data() + start_, first);
+    out.append(ring_.data(), size_ - first);
+    return out;
+}
+
+#ifndef _WIN32
+
+// ============================================================================
+// Exit Notification
+// ============================================================================
+
+namespace {
+
+// Without a pidfd, SIGCHLD wakes every registered supervisor through the
+// write end of its wake pipe. Slots hold the descriptor plus one (0 = free).
+constexpr int kMaxChildWatchers = 64;
+std::atomic<int> gChildWatchers[kMaxChildWatchers];
+struct sigaction gPreviousChildAction;
+std::once_flag gChildHandlerInstalled;
+
+void onChildSignal(int sig, siginfo_t* info, void* context) {
+    int savedErrno = errno;
+    for (auto& slot : gChildWatchers) {
+        int fd = slot.load() - 1;
+        if (fd >= 0) {
+            ssize_t ignored = ::write(fd, "c", 1);
+            (void)ignored;
+        }
+    }
+    errno = savedErrno;
+
+    // Keep the application's own handler working
+    if (gPreviousChildAction.sa_flags & SA_SIGINFO) {
+        if (gPreviousChildAction.sa_sigaction) gPreviousChildAction.sa_sigaction(sig, info, context);
+    } else if (gPreviousChildAction.sa_handler != SIG_DFL && gPreviousChildAction.sa_handler != SIG_IGN) {
+        gPreviousChildAction.sa_handler(sig);
+    }
+}
+
+/// Returns the slot, or -1 if all are taken (the supervisor then polls).
+int registerChildWatcher(int wakeFd) {
+    std::call_once(gChildHandlerInstalled, [] {
+        struct sigaction action {};
+        action.sa_sigaction = onChildSignal;
+        action.sa_flags = SA_SIGINFO | SA_RESTART | SA_NOCLDSTOP;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGCHLD, &action, &gPreviousChildAction);
+    });
+    for (int slot = 0; slot < kMaxChildWatchers; ++slot) {
+        int expected = 0;
+        if (gChildWatchers[slot].compare_exchange_strong(expected, wakeFd + 1)) return slot;
+    }
+    return -1;
+}
+
+int openPidfd(int pid) {
+#if defined(__linux__) && defined(SYS_pidfd_open)
+    return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#else
+    (void)pid;
+    return -1;
+#endif
+}
+
+void setNonBlocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+constexpr int kFallbackPollMs = 100;    // Neither a pidfd nor a SIGCHLD slot
+constexpr int kStderrGraceMs = 200;     // After exit, how long to wait for the rest of stderr
+
+} // namespace
+
+// ============================================================================
+// LaunchLimits
+// ============================================================================
+
+namespace {
+
+uint64_t clampToHardLimit(int resource, uint64_t value) {
+    struct rlimit current {};
+    if (getrlimit(resource, &current) != 0 || current.rlim_max == RLIM_INFINITY) return value;
+    return std::min<uint64_t>(value, current.rlim_max);
+}
+
+bool setBothLimits(int resource, uint64_t value) {
+    struct rlimit limit {};
+    limit.rlim_cur = static_cast<rlim_t>(value);
+    limit.rlim_max = static_cast<rlim_t>(value);
+    return setrlimit(resource, &limit) == 0;
+}
+
+} // namespace
+
+LaunchLimits::LaunchLimits(const ProcessLimits& limits) : nice_(limits.nice) {
+    // Both limits are lowered: the CLI would otherwise raise its soft
+    // NOFILE limit to the hard one at startup
+    if (limits.addressSpaceBytes) {
+        addressSpaceBytes_ = clampToHardLimit(RLIMIT_AS, *limits.addressSpaceBytes);
+    }
+    if (limits.openFiles) openFiles_ = clampToHardLimit(RLIMIT_NOFILE, *limits.openFiles);
+
+#ifdef __linux__
+    for (int cpu : limits.cpuAffinity) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            throw std::runtime_error("Invalid CPU in cpuAffinity: " + std::to_string(cpu));
+        }
+    }
+    cpuAffinity_ = limits.cpuAffinity;
+
+    if (!limits.cgroup.empty()) {
+        cgroupProcs_ = limits.cgroup + "/cgroup.procs";
+        if (access(cgroupProcs_.c_str(), W_OK) != 0) {
+            throw std::runtime_error("Cannot place the CLI in cgroup " + limits.cgroup + ": " +
+                                     std::strerror(errno));
+        }
+    }
+#else
+    if (!limits.cpuAffinity.empty()) {
+        throw std::runtime_error("cpuAffinity is only supported on Linux");
+    }
+    if (!limits.cgroup.empty()) throw std::runtime_error("cgroup placement is only supported on Linux");
+#endif
+}
+
+const char* LaunchLimits::apply() const {
+    // First, so the cgroup accounts for everything the CLI allocates. "0"
+    // moves the writing process.
+    if (!cgroupProcs_.empty()) {
+        int fd = open(cgroupProcs_.c_str(), O_WRONLY);
+        bool placed = fd >= 0 && ::write(fd, "0", 1) == 1;
+        if (fd >= 0) close(fd);
+        if (!placed) return "failed to join the cgroup";
+    }
+    if (addressSpaceBytes_ && !setBothLimits(RLIMIT_AS, *addressSpaceBytes_)) {
+        return "failed to set RLIMIT_AS";
+    }
+    if (openFiles_ && !setBothLimits(RLIMIT_NOFILE, *openFiles_)) return "failed to set RLIMIT_NOFILE";
+    if (nice_ && setpriority(PRIO_PROCESS, 0, *nice_) != 0) return "failed to set the nice level";
+#ifdef __linux__
+    if (!cpuAffinity_.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpuAffinity_) CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) return "failed to set the CPU affinity";
+    }
+#endif
+    return nullptr;
+}
+
+// ============================================================================
+// ProcessSupervisor
+// ============================================================================
+
+ProcessSupervisor::ProcessSupervisor(int pid, int stderrFd, std::shared_ptr<StderrBuffer> buffer,
+                                     StderrSink sink, int sampleIntervalMs, std::string cgroup,
+                                     ExitHandler onExit, const ThreadOptions& threads)
+    : pid_(pid), stderrFd_(stderrFd), buffer_(std::move(buffer)), sink_(std::move(sink)),
+      sampleIntervalMs_(sampleIntervalMs), cgroup_(std::move(cgroup)), onExit_(std::move(onExit)) {
+    stats_.pid = pid;
+    stats_.running = true;
+
+    if (pipe(wakeFds_) != 0) {
+        close(stderrFd_);
+        throw std::runtime_error("Failed to create supervisor pipe");
+    }
+    setNonBlocking(wakeFds_[0]);
+    setNonBlocking(wakeFds_[1]);
+    setNonBlocking(stderrFd_);
+
+    pidfd_ = openPidfd(pid);
+    if (pidfd_ < 0) watcherSlot_ = registerChildWatcher(wakeFds_[1]);
+
+    thread_ = startThread(threads, "copilot-superv", [this] { run(); });
+}
+
+ProcessSupervisor::~ProcessSupervisor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    ssize_t ignored = ::write(wakeFds_[1], "s", 1);
+    (void)ignored;
+    if (thread_.joinable()) thread_.join();
+
+    if (watcherSlot_ >= 0) gChildWatchers[watcherSlot_].store(0);
+    if (pidfd_ >= 0) close(pidfd_);
+    if (stderrFd_ >= 0) close(stderrFd_);
+    close(wakeFds_[0]);
+    close(wakeFds_[1]);
+}
+
+bool ProcessSupervisor::signal(int sig) {
+    // Reaping happens under the same lock, so the PID cannot have been reused
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (exit_) return false;
+#if defined(__linux__) && defined(SYS_pidfd_send_signal)
+    if (pidfd_ >= 0) return syscall(SYS_pidfd_send_signal, pidfd_, sig, nullptr, 0) == 0;
+#endif
+    return ::kill(pid_, sig) == 0;
+}
+
+bool ProcessSupervisor::waitForExit(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return exitCv_.wait_for(lock, timeout, [this] { return exit_.has_value(); });
+}
+
+ProcessStats ProcessSupervisor::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+// ============================================================================
+// Supervisor Loop
+// ============================================================================
+
+void ProcessSupervisor::run() {
+    using Clock = std::chrono::steady_clock;
+    auto msUntil = [](Clock::time_point at) {
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(at - Clock::now()).count();
+        return static_cast<int>(std::max<decltype(ms)>(ms, 0));
+    };
+
+    bool exited = false;
+    Clock::time_point stderrDeadline;
+    Clock::time_point nextSample = Clock::now();
+
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) return;
+        }
+
+        // Without a pidfd, check after every wakeup (SIGCHLD may predate registration)
+        if (!exited && pidfd_ < 0 && reap()) {
+            exited = true;
+            stderrDeadline = Clock::now() + std::chrono::milliseconds(kStderrGraceMs);
+        }
+        if (exited && (stderrFd_ < 0 || Clock::now() >= stderrDeadline)) break;
+
+        if (!exited && sampleIntervalMs_ > 0 && Clock::now() >= nextSample) {
+            sample();
+            if (!cgroup_.empty()) sampleCgroup();
+            nextSample = Clock::now() + std::chrono::milliseconds(sampleIntervalMs_);
+        }
+
+        int timeout = -1;
+        if (exited) {
+            timeout = msUntil(stderrDeadline);
+        } else if (sampleIntervalMs_ > 0) {
+            timeout = msUntil(nextSample);
+        }
+        if (!exited && pidfd_ < 0 && watcherSlot_ < 0) {
+            timeout = timeout < 0 ? kFallbackPollMs : std::min(timeout, kFallbackPollMs);
+        }
+
+        pollfd fds[3];
+        nfds_t count = 0;
+        fds[count++] = {wakeFds_[0], POLLIN, 0};
+        int pidfdIndex = -1;
+        int stderrIndex = -1;
+        if (!exited && pidfd_ >= 0) {
+            pidfdIndex = static_cast<int>(count);
+            fds[count++] = {pidfd_, POLLIN, 0};
+        }
+        if (stderrFd_ >= 0) {
+            stderrIndex = static_cast<int>(count);
+            fds[count++] = {stderrFd_, POLLIN, 0};
+        }
+
+        if (poll(fds, count, timeout) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        if (fds[0].revents) {
+            char discard[64];
+            while (::read(wakeFds_[0], discard, sizeof(discard)) > 0) {}
+        }
+        if (stderrIndex >= 0 && fds[stderrIndex].revents) drainStderr();
+        if (pidfdIndex >= 0 && fds[pidfdIndex].revents && reap()) {
+            exited = true;
+            stderrDeadline = Clock::now() + std::chrono::milliseconds(kStderrGraceMs);
+        }
+    }
+
+    if (!exited) return;
+    if (!partialLine_.empty() && sink_) sink_(partialLine_);
+    partialLine_.clear();
+
+    ProcessExit exit;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) return;
+        exit = *exit_;
+    }
+    if (onExit_) onExit_(exit);
+}
+
+/// Reap the process if it has exited. Returns true once it has been reaped.
+bool ProcessSupervisor::reap() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (exit_) return true;
+
+        int status = 0;
+        struct rusage usage {};
+        pid_t reaped = wait4(pid_, &status, WNOHANG, &usage);
+        if (reaped == 0 || (reaped < 0 && errno == EINTR)) return false;
+
+        // reaped < 0: the process was reaped elsewhere (SIGCHLD ignored), so
+        // its status is unknown
+        ProcessExit exit;
+        exit.pid = pid_;
+        if (reaped == pid_) {
+            if (WIFEXITED(status)) exit.exitCode = WEXITSTATUS(status);
+            if (WIFSIGNALED(status)) exit.signal = WTERMSIG(status);
+            exit.userCpuMs = usage.ru_utime.tv_sec * 1000.0 + usage.ru_utime.tv_usec / 1000.0;
+            exit.systemCpuMs = usage.ru_stime.tv_sec * 1000.0 + usage.ru_stime.tv_usec / 1000.0;
+#ifdef __APPLE__
+            exit.maxRssBytes = static_cast<uint64_t>(usage.ru_maxrss);
+#else
+            exit.maxRssBytes = static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+        }
+        exit_ = exit;
+        stats_.running = false;
+        stats_.lastExit = exit;
+    }
+    exitCv_.notify_all();
+    return true;
+}
+
+void ProcessSupervisor::drainStderr() {
+    char chunk[4096];
+    while (true) {
+        ssize_t n = ::read(stderrFd_, chunk, sizeof(chunk));
+        if (n > 0) {
+            emitLines(chunk, static_cast<size_t>(n));
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        if (n < 0 && errno == EINTR) continue;
+
+        // End of stream (or error): the process and its children closed stderr
+        close(stderrFd_);
+        stderrFd_ = -1;
+        return;
+    }
+}
+
+void ProcessSupervisor::emitLines(const char* data, size_t size) {
+    if (buffer_) buffer_->append(data, size);
+    if (!sink_) return;
+
+    const char* end = data + size;
+    while (data < end) {
+        const char* newline = static_cast<const char*>(std::memchr(data, '\n', end - data));
+        if (!newline) {
+            partialLine_.append(data, end);
+            return;
+        }
+        partialLine_.append(data, newline);
+        if (!partialLine_.empty() && partialLine_.back() == '\r') partialLine_.pop_back();
+        try {
+            sink_(partialLine_);
+        } catch (...) {}
+        partialLine_.clear();
+        data = newline + 1;
+    }
+}
+
+/// Read resident memory from /proc/<pid>/statm and CPU time from
+/// /proc/<pid>/stat. No-op where /proc is not available.
+void ProcessSupervisor::sample() {
+    char path[64];
+    std::snprintf(path, sizeof(path), "/proc/%d/statm", pid_);
+    FILE* file = std::fopen(path, "r");
+    if (!file) return;
+    unsigned long totalPages = 0;
+    unsigned long residentPages = 0;
+    int fields = std::fscanf(file, "%lu %lu", &totalPages, &residentPages);
+    std::fclose(file);
+    if (fields != 2) return;
+
+    std::snprintf(path, sizeof(path), "/proc/%d/stat", pid_);
+    file = std::fopen(path, "r");
+    if (!file) return;
+    char line[1024];
+    bool read = std::fgets(line, sizeof(line), file) != nullptr;
+    std::fclose(file);
+    if (!read) return;
+
+    // The command name may contain spaces; fields resume after its ')'
+    const char* rest = std::strrchr(line, ')');
+    unsigned long userTicks = 0;
+    unsigned long systemTicks = 0;
+    if (!rest || std::sscanf(rest + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+                             &userTicks, &systemTicks) != 2) {
+        return;
+    }
+
+    double msPerTick = 1000.0 / static_cast<double>(sysconf(_SC_CLK_TCK));
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.rssBytes = static_cast<uint64_t>(residentPages) * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    stats_.userCpuMs = userTicks * msPerTick;
+    stats_.systemCpuMs = systemTicks * msPerTick;
+}
+
+/// Memory and CPU of the whole cgroup, which includes the CLI's children.
+void ProcessSupervisor::sampleCgroup() {
+    unsigned long long memoryBytes = 0;
+    unsigned long long cpuUsec = 0;
+
+    FILE* file = std::fopen((cgroup_ + "/memory.current").c_str(), "r");
+    if (file) {
+        if (std::fscanf(file, "%llu", &memoryBytes) != 1) memoryBytes = 0;
+        std::fclose(file);
+    }
+    file = std::fopen((cgroup_ + "/cpu.stat").c_str(), "r");
+    if (file) {
+        char key[64];
+        unsigned long long value = 0;
+        while (std::fscanf(file, "%63s %llu", key, &value) == 2) {
+            if (std::strcmp(key, "usage_usec") == 0) {
+                cpuUsec = value;
+                break;
+            }
+        }
+        std::fclose(file);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.cgroupMemoryBytes = memoryBytes;
+    stats_.cgroupCpuMs = cpuUsec / 1000.0;
+}
+
+#endif // !_WIN32
+
+} // namespace copilot
@@ -0,0 +1,128 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Microsoft Corporation. All rights reserved.
+ *--------------------------------------------------------------------------------------------*/
+
+#include "copilot/threads.h"
+
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace copilot {
+
+namespace {
+
+#ifndef _WIN32
+/// The sched.h policy, or -1 when the thread keeps the inherited one.
+int nativePolicy(ThreadPolicy policy) {
+    switch (policy) {
+        case ThreadPolicy::Inherit: return -1;
+        case ThreadPolicy::Other: return SCHED_OTHER;
+#ifdef __linux__
+        case ThreadPolicy::Batch: return SCHED_BATCH;
+        case ThreadPolicy::Idle: return SCHED_IDLE;
+#else
+        case ThreadPolicy::Batch:
+        case ThreadPolicy::Idle: return -1;
+#endif
+        case ThreadPolicy::Fifo: return SCHED_FIFO;
+        case ThreadPolicy::RoundRobin: return SCHED_RR;
+    }
+    return -1;
+}
+#endif
+
+void setCurrentThreadName(const char* name) {
+#if defined(__linux__)
+    pthread_setname_np(pthread_self(), name);
+#elif defined(__APPLE__)
+    pthread_setname_np(name);
+#elif defined(_WIN32)
+    std::wstring wide(name, name + std::char_traits<char>::length(name));
+    SetThreadDescription(GetCurrentThread(), wide.c_str());
+#else
+    (void)name;
+#endif
+}
+
+/// Failures (e.g. a real-time policy without privileges) leave the thread
+/// as it was: a misconfigured host must not stop the SDK from working.
+void applyThreadOptions(const ThreadOptions& options) {
+#ifdef __linux__
+    if (!options.cpuAffinity.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : options.cpuAffinity) CPU_SET(cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+#endif
+#ifndef _WIN32
+    int policy = nativePolicy(options.policy);
+    if (policy >= 0) {
+        sched_param param {};
+        param.sched_priority = (policy == SCHED_FIFO || policy == SCHED_RR) ? options.priority : 0;
+        pthread_setschedparam(pthread_self(), policy, &param);
+    }
+#endif
+}
+
+} // namespace
+
+std::thread startThread(const ThreadOptions& options, const char* name, std::function<void()> body) {
+    return std::thread([options, name, body = std::move(body)] {
+        setCurrentThreadName(name);
+        applyThreadOptions(options);
+        if (options.onThreadStart) options.onThreadStart(name);
+
+        // Runs the exit hook however the body ends
+        struct ExitHook {
+            const ThreadOptions& options;
+            const char* name;
+            ~ExitHook() {
+                if (options.onThreadExit) options.onThreadExit(name);
+            }
+        } exitHook{options, name};
+        body();
+    });
+}
+
+void validateThreadOptions(const ThreadOptions& options) {
+#ifdef __linux__
+    for (int cpu : options.cpuAffinity) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            throw std::runtime_error("Invalid CPU in threads.cpuAffinity: " + std::to_string(cpu));
+        }
+    }
+#else
+    if (!options.cpuAffinity.empty()) {
+        throw std::runtime_error("threads.cpuAffinity is only supported on Linux");
+    }
+#endif
+
+#ifdef _WIN32
+    if (options.policy != ThreadPolicy::Inherit) {
+        throw std::runtime_error("threads.policy is not supported on Windows");
+    }
+#else
+    int policy = nativePolicy(options.policy);
+    if (options.policy != ThreadPolicy::Inherit && policy < 0) {
+        throw std::runtime_error("threads.policy is not supported on this platform");
+    }
+    if (policy == SCHED_FIFO || policy == SCHED_RR) {
+        if (options.priority < sched_get_priority_min(policy) ||
+            options.priority > sched_get_priority_max(policy)) {
+            throw std::runtime_error("threads.priority is out of range: " +
+                                     std::to_string(options.priority));
+        }
+    }
+#endif
+}
+
+} // namespace copilot
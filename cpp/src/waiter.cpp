@@ -0,0 +1,84 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Microsoft Corporation. All rights reserved.
+ *--------------------------------------------------------------------------------------------*/
+
+#include "copilot/waiter.h"
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace copilot {
+
+#ifdef __linux__
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) &&
+              std::atomic<uint32_t>::is_always_lock_free,
+              "futex needs a plain 32-bit atomic");
+#endif
+
+void OneShotWaiter::signal() {
+    if (state_.exchange(kSignalled, std::memory_order_acq_rel) == kParked) wake();
+}
+
+bool OneShotWaiter::waitUntil(Clock::time_point deadline) {
+    uint32_t state = kIdle;
+    if (!state_.compare_exchange_strong(state, kParked, std::memory_order_acq_rel)) {
+        return true;   // Already signalled
+    }
+    while (true) {
+        park(deadline);
+        if (state_.load(std::memory_order_acquire) == kSignalled) return true;
+        if (Clock::now() >= deadline) {
+            // Unpark, unless the signal won the race
+            state = kParked;
+            return !state_.compare_exchange_strong(state, kIdle, std::memory_order_acq_rel);
+        }
+    }
+}
+
+#ifdef __linux__
+
+/// Sleep while the state is still kParked. Returns on a wake, a timeout, a
+/// signal or a spurious wake-up; the caller re-checks.
+void OneShotWaiter::park(Clock::time_point deadline) {
+    timespec timeout {};
+    timespec* timeoutPtr = nullptr;
+    if (deadline != Clock::time_point::max()) {
+        auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - Clock::now());
+        if (remaining.count() <= 0) return;
+        timeout.tv_sec = static_cast<time_t>(remaining.count() / 1000000000);
+        timeout.tv_nsec = static_cast<long>(remaining.count() % 1000000000);
+        timeoutPtr = &timeout;
+    }
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&state_), FUTEX_WAIT_PRIVATE, kParked,
+            timeoutPtr, nullptr, 0);
+}
+
+void OneShotWaiter::wake() {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&state_), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+
+#else
+
+void OneShotWaiter::park(Clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto signalled = [this] { return state_.load(std::memory_order_acquire) == kSignalled; };
+    if (deadline == Clock::time_point::max()) {
+        cv_.wait(lock, signalled);
+    } else {
+        cv_.wait_until(lock, deadline, signalled);
+    }
+}
+
+void OneShotWaiter::wake() {
+    // Taking the mutex orders the notify after the waiter's predicate check
+    std::lock_guard<std::mutex> lock(mutex_);
+    cv_.notify_one();
+}
+
+#endif
+
+} // namespace copilot